@@ -0,0 +1,62 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include "counters.h"
+
+namespace Bench {
+struct Result {
+  std::string name;
+  long iterations{0};
+  double nsPerOp{0.0};
+  double syscallsPerOp{0.0};
+  double allocationsPerOp{0.0};
+};
+
+// Whether the benchmark named 'name' was selected on the command line
+bool Enabled(const std::string& name);
+
+void Report(const Result& result);
+
+// Run 'op' repeatedly for at least 'minSeconds' (after one warm-up call)
+// and report the mean time, syscalls and allocations per call
+template <typename Op>
+Result Run(const std::string& name, Op&& op, double minSeconds = 0.5) {
+  using Clock = std::chrono::steady_clock;
+  Result result;
+  result.name = name;
+  if (!Enabled(name)) {
+    return result;
+  }
+  op();
+
+  std::uint64_t syscalls = SyscallCount();
+  std::uint64_t allocations = AllocationCount();
+  auto start = Clock::now();
+  std::chrono::duration<double> elapsed{0};
+  do {
+    op();
+    ++result.iterations;
+    elapsed = Clock::now() - start;
+  } while (elapsed.count() < minSeconds);
+
+  result.nsPerOp = 1e9 * elapsed.count() / result.iterations;
+  result.syscallsPerOp =
+      (double)(SyscallCount() - syscalls) / result.iterations;
+  result.allocationsPerOp =
+      (double)(AllocationCount() - allocations) / result.iterations;
+  Report(result);
+  return result;
+}
+
+// Individual benchmark suites
+void ParserBenchmarks();
+void CpuBenchmarks();
+void PidsBenchmarks();
+void RefreshScalingBenchmarks();
+};  // namespace Bench
+
+#endif
@@ -0,0 +1,196 @@
+#include "counters.h"
+
+#include <dirent.h>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdarg>
+#include <cstdlib>
+#include <new>
+
+namespace {
+std::atomic<std::uint64_t> syscalls{0};
+std::atomic<std::uint64_t> allocations{0};
+
+void CountSyscall() { syscalls.fetch_add(1, std::memory_order_relaxed); }
+
+// The libc definition of 'name', looked up once
+template <typename Function>
+Function Next(Function& cache, const char* name) {
+  if (cache == nullptr) {
+    cache = reinterpret_cast<Function>(dlsym(RTLD_NEXT, name));
+  }
+  return cache;
+}
+
+void* Allocate(std::size_t size) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  void* pointer = std::malloc((size == 0) ? 1 : size);
+  if (pointer == nullptr) {
+    throw std::bad_alloc();
+  }
+  return pointer;
+}
+
+void* AllocateAligned(std::size_t size, std::align_val_t alignment) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  void* pointer = nullptr;
+  if (posix_memalign(&pointer,
+                     std::max(sizeof(void*), (std::size_t)alignment),
+                     (size == 0) ? 1 : size) != 0) {
+    throw std::bad_alloc();
+  }
+  return pointer;
+}
+}  // namespace
+
+std::uint64_t Bench::SyscallCount() {
+  return syscalls.load(std::memory_order_relaxed);
+}
+
+std::uint64_t Bench::AllocationCount() {
+  return allocations.load(std::memory_order_relaxed);
+}
+
+// libc wrappers
+
+extern "C" {
+int open(const char* path, int flags, ...) {
+  static int (*next)(const char*, int, ...);
+  mode_t mode{0};
+  if (flags & (O_CREAT | O_TMPFILE)) {
+    va_list args;
+    va_start(args, flags);
+    mode = va_arg(args, mode_t);
+    va_end(args);
+  }
+  CountSyscall();
+  return Next(next, "open")(path, flags, mode);
+}
+
+int openat(int directory, const char* path, int flags, ...) {
+  static int (*next)(int, const char*, int, ...);
+  mode_t mode{0};
+  if (flags & (O_CREAT | O_TMPFILE)) {
+    va_list args;
+    va_start(args, flags);
+    mode = va_arg(args, mode_t);
+    va_end(args);
+  }
+  CountSyscall();
+  return Next(next, "openat")(directory, path, flags, mode);
+}
+
+ssize_t read(int fd, void* buffer, size_t size) {
+  static ssize_t (*next)(int, void*, size_t);
+  CountSyscall();
+  return Next(next, "read")(fd, buffer, size);
+}
+
+ssize_t pread(int fd, void* buffer, size_t size, off_t offset) {
+  static ssize_t (*next)(int, void*, size_t, off_t);
+  CountSyscall();
+  return Next(next, "pread")(fd, buffer, size, offset);
+}
+
+ssize_t write(int fd, const void* buffer, size_t size) {
+  static ssize_t (*next)(int, const void*, size_t);
+  CountSyscall();
+  return Next(next, "write")(fd, buffer, size);
+}
+
+int close(int fd) {
+  static int (*next)(int);
+  CountSyscall();
+  return Next(next, "close")(fd);
+}
+
+int stat(const char* path, struct stat* st) noexcept {
+  static int (*next)(const char*, struct stat*);
+  CountSyscall();
+  return Next(next, "stat")(path, st);
+}
+
+int fstat(int fd, struct stat* st) noexcept {
+  static int (*next)(int, struct stat*);
+  CountSyscall();
+  return Next(next, "fstat")(fd, st);
+}
+
+int fstatat(int directory, const char* path, struct stat* st,
+            int flags) noexcept {
+  static int (*next)(int, const char*, struct stat*, int);
+  CountSyscall();
+  return Next(next, "fstatat")(directory, path, st, flags);
+}
+
+ssize_t getdents64(int fd, void* buffer, size_t size) noexcept {
+  static ssize_t (*next)(int, void*, size_t);
+  CountSyscall();
+  return Next(next, "getdents64")(fd, buffer, size);
+}
+
+long syscall(long number, ...) noexcept {
+  static long (*next)(long, ...);
+  va_list args;
+  va_start(args, number);
+  long a[6];
+  for (long& arg : a) {
+    arg = va_arg(args, long);
+  }
+  va_end(args);
+  CountSyscall();
+  return Next(next, "syscall")(number, a[0], a[1], a[2], a[3], a[4], a[5]);
+}
+}
+
+// Global allocation functions
+
+void* operator new(std::size_t size) { return Allocate(size); }
+void* operator new[](std::size_t size) { return Allocate(size); }
+void* operator new(std::size_t size, std::align_val_t alignment) {
+  return AllocateAligned(size, alignment);
+}
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+  return AllocateAligned(size, alignment);
+}
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+  try {
+    return Allocate(size);
+  } catch (const std::bad_alloc&) {
+    return nullptr;
+  }
+}
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+  try {
+    return Allocate(size);
+  } catch (const std::bad_alloc&) {
+    return nullptr;
+  }
+}
+
+void operator delete(void* pointer) noexcept { std::free(pointer); }
+void operator delete[](void* pointer) noexcept { std::free(pointer); }
+void operator delete(void* pointer, std::size_t) noexcept {
+  std::free(pointer);
+}
+void operator delete[](void* pointer, std::size_t) noexcept {
+  std::free(pointer);
+}
+void operator delete(void* pointer, std::align_val_t) noexcept {
+  std::free(pointer);
+}
+void operator delete[](void* pointer, std::align_val_t) noexcept {
+  std::free(pointer);
+}
+void operator delete(void* pointer, std::size_t, std::align_val_t) noexcept {
+  std::free(pointer);
+}
+void operator delete[](void* pointer, std::size_t,
+                       std::align_val_t) noexcept {
+  std::free(pointer);
+}
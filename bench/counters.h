@@ -0,0 +1,23 @@
+#ifndef BENCH_COUNTERS_H
+#define BENCH_COUNTERS_H
+
+#include <cstdint>
+
+/*
+Process-wide event counts, for per-operation figures in benchmark results.
+
+Syscalls are counted by interposing the libc wrappers the monitor calls
+(open/openat/read/pread/write/close, the stat family, getdents64 and
+syscall()) in the benchmark executable: monitor_core is linked statically,
+so its calls bind to the wrappers defined here, which count and forward to
+libc. Syscalls libc makes internally (e.g. from readdir() or fopen()) go
+uncounted.
+
+Allocations are counted by replacing the global operator new.
+*/
+namespace Bench {
+std::uint64_t SyscallCount();
+std::uint64_t AllocationCount();
+};  // namespace Bench
+
+#endif
@@ -0,0 +1,28 @@
+#include <string>
+
+#include "bench.h"
+#include "cpu_set.h"
+#include "linux_parser.h"
+
+using std::to_string;
+
+// CpuSet::Update() on many-core readings, each tick adding a different
+// amount of time to every state of every core
+void Bench::CpuBenchmarks() {
+  for (size_t numCores : {8, 64, 256}) {
+    LinuxParser::CoreTimes cores;
+    cores.Resize(numCores);
+    CpuSet cpus;
+    unsigned long long tick{0};
+    Run("CpuSet::Update [" + to_string(numCores) + " cores]",
+        [&cores, &cpus, &tick]() {
+          ++tick;
+          for (auto& state : cores.times) {
+            for (size_t core = 0; core < state.size(); ++core) {
+              state[core] += 1 + ((tick + core) & 3);
+            }
+          }
+          cpus.Update(cores);
+        });
+  }
+}
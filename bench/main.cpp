@@ -0,0 +1,80 @@
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+
+namespace {
+bool json{false};
+std::string filter;
+std::vector<Bench::Result> results;
+
+// Print a JSON string (benchmark names only use printable ASCII)
+void PrintJsonString(const std::string& text) {
+  std::putchar('"');
+  for (char c : text) {
+    if ((c == '"') || (c == '\\')) {
+      std::putchar('\\');
+    }
+    std::putchar(c);
+  }
+  std::putchar('"');
+}
+
+void PrintJson() {
+  std::printf("[\n");
+  for (size_t i = 0; i < results.size(); ++i) {
+    const Bench::Result& result = results[i];
+    std::printf("  {\"name\": ");
+    PrintJsonString(result.name);
+    std::printf(
+        ", \"iterations\": %ld, \"ns_per_op\": %.1f, "
+        "\"syscalls_per_op\": %.2f, \"allocs_per_op\": %.2f}%s\n",
+        result.iterations, result.nsPerOp, result.syscallsPerOp,
+        result.allocationsPerOp, (i + 1 < results.size()) ? "," : "");
+  }
+  std::printf("]\n");
+}
+}  // namespace
+
+bool Bench::Enabled(const std::string& name) {
+  return filter.empty() || (name.find(filter) != std::string::npos);
+}
+
+// The table goes to stderr when stdout is reserved for JSON
+void Bench::Report(const Result& result) {
+  results.push_back(result);
+  std::fprintf(json ? stderr : stdout,
+               "%-52s %9ld iters %12.1f ns/op %8.2f sys/op %8.2f allocs/op\n",
+               result.name.c_str(), result.iterations, result.nsPerOp,
+               result.syscallsPerOp, result.allocationsPerOp);
+  std::fflush(json ? stderr : stdout);
+}
+
+int main(int argc, char* argv[]) {
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--json") == 0) {
+      json = true;
+    } else if (argv[i][0] != '-') {
+      filter = argv[i];
+    } else {
+      std::fprintf(stderr,
+                   "Usage: %s [--json] [FILTER]\n"
+                   "  --json  print the results as JSON on stdout\n"
+                   "  FILTER  only run benchmarks whose name contains "
+                   "FILTER\n",
+                   argv[0]);
+      return 1;
+    }
+  }
+
+  Bench::ParserBenchmarks();
+  Bench::CpuBenchmarks();
+  Bench::PidsBenchmarks();
+  Bench::RefreshScalingBenchmarks();
+
+  if (json) {
+    PrintJson();
+  }
+}
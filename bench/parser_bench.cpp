@@ -0,0 +1,85 @@
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "linux_parser.h"
+#include "procfs_data_source.h"
+#include "users.h"
+
+using std::string;
+using std::vector;
+
+// One benchmark per LinuxParser entry point, reading the live /proc (and
+// this process's own /proc/<pid>), plus the parsers alone on in-memory
+// copies of the same files
+void Bench::ParserBenchmarks() {
+  ProcfsDataSource source;
+  const int pid = getpid();
+  vector<char> buffer;
+
+  // System-wide files
+  LinuxParser::MeminfoSnapshot meminfo;
+  Run("LinuxParser::ReadMeminfo",
+      [&source, &meminfo]() { LinuxParser::ReadMeminfo(source, meminfo); });
+  vector<char> meminfoFile;
+  source.ReadFile(kProcMeminfo_, meminfoFile);
+  Run("LinuxParser::ParseMeminfo [in memory]", [&meminfoFile, &meminfo]() {
+    LinuxParser::ParseMeminfo(meminfoFile.data(), meminfoFile.size(),
+                              meminfo);
+  });
+
+  LinuxParser::StatSnapshot stat;
+  Run("LinuxParser::ReadStat",
+      [&source, &stat]() { LinuxParser::ReadStat(source, stat); });
+  vector<char> statFile;
+  source.ReadFile(kProcStat_, statFile);
+  Run("LinuxParser::ParseStat [in memory]", [&statFile, &stat]() {
+    LinuxParser::ParseStat(statFile.data(), statFile.size(), stat);
+  });
+
+  Run("LinuxParser::UpTime", [&source]() { LinuxParser::UpTime(source); });
+
+  // Per process files
+  PidFiles files(pid);
+  LinuxParser::ProcStatRecord record;
+  long tick{0};
+  Run("LinuxParser::ReadProcStat [cached fds]",
+      [&source, &files, &record, &tick]() {
+        LinuxParser::ReadProcStat(source, files, record, ++tick);
+      });
+  Run("LinuxParser::ReadProcStat [uncached]",
+      [&source, &files, &record, &tick]() {
+        files.Close();
+        LinuxParser::ReadProcStat(source, files, record, ++tick);
+      });
+  vector<char> procStatFile;
+  source.ReadPidFile(pid, "stat", procStatFile);
+  Run("LinuxParser::ParseProcStat [in memory]", [&procStatFile, &record]() {
+    LinuxParser::ParseProcStat(procStatFile.data(), procStatFile.size(),
+                               record);
+  });
+
+  Run("DataSource::ReadPidFile [status]", [&source, pid, &buffer]() {
+    source.ReadPidFile(pid, "status", buffer);
+  });
+  Run("LinuxParser::Uid", [&source, pid]() { LinuxParser::Uid(source, pid); });
+  Run("LinuxParser::Command",
+      [&source, pid]() { LinuxParser::Command(source, pid); });
+  // Compare with ReadProcStat: the cost RefreshSmaps() budgets for
+  LinuxParser::SmapsRollupSnapshot smaps;
+  Run("LinuxParser::ReadSmapsRollup", [&source, pid, &smaps]() {
+    LinuxParser::ReadSmapsRollup(source, pid, smaps);
+  });
+
+  // Users
+  vector<LinuxParser::PasswdEntry> entries;
+  Run("LinuxParser::ReadPasswd",
+      [&source, &entries]() { LinuxParser::ReadPasswd(source, entries); });
+  Users::Revalidate(source);
+  const int uid = getuid();
+  Run("Users::Revalidate [unchanged]",
+      [&source]() { Users::Revalidate(source); });
+  Run("Users::LookUpUserName", [uid]() { Users::LookUpUserName(uid); });
+}
@@ -0,0 +1,125 @@
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <experimental/filesystem>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "linux_parser.h"
+#include "pid_enumerator.h"
+
+namespace fs = std::experimental::filesystem;
+using std::string;
+using std::to_string;
+using std::vector;
+
+namespace {
+// The directory_iterator based implementation LinuxParser::Pids() used
+// before switching to getdents64, kept here as the baseline
+vector<int> LegacyPids(const string& directory) {
+  vector<int> pids;
+
+  for (auto it = fs::directory_iterator(directory);
+       it != fs::directory_iterator(); ++it) {
+    if (fs::is_directory(it->path())) {
+      string foldername(it->path().stem());
+
+      if (std::all_of(foldername.begin(), foldername.end(), isdigit)) {
+        int pid = std::stoi(foldername);
+        pids.push_back(pid);
+      }
+    }
+  }
+  return pids;
+}
+
+// Create a /proc look-alike with 'numPids' numeric directories, plus a few
+// regular files and non-numeric directories that must be skipped
+string MakeFakeProc(int numPids) {
+  const char* base = (access("/dev/shm", W_OK) == 0) ? "/dev/shm" : "/tmp";
+  string templ = string(base) + "/monitor_bench_XXXXXX";
+  if (mkdtemp(&templ[0]) == nullptr) {
+    std::perror("mkdtemp");
+    std::exit(1);
+  }
+
+  for (int pid = 1; pid <= numPids; ++pid) {
+    mkdir((templ + "/" + to_string(pid)).c_str(), 0755);
+  }
+  for (const char* name : {"stat", "meminfo", "uptime", "version"}) {
+    close(creat((templ + "/" + name).c_str(), 0644));
+  }
+  for (const char* name : {"self", "sys", "net", "irq"}) {
+    mkdir((templ + "/" + name).c_str(), 0755);
+  }
+  return templ;
+}
+
+// Create a cgroup v2 subtree look-alike: a cgroup with 'numChildren'
+// children, each with 'pidsPerChild' processes in its cgroup.procs
+string MakeFakeCgroup(int numChildren, int pidsPerChild) {
+  string directory = MakeFakeProc(0);
+  close(creat((directory + "/cgroup.procs").c_str(), 0644));
+  int pid{1000};
+  for (int child = 0; child < numChildren; ++child) {
+    string path = directory + "/child" + to_string(child) + ".scope";
+    mkdir(path.c_str(), 0755);
+    string procs;
+    for (int i = 0; i < pidsPerChild; ++i) {
+      procs += to_string(pid++) + "\n";
+    }
+    int fd = creat((path + "/cgroup.procs").c_str(), 0644);
+    if (write(fd, procs.data(), procs.size()) != (ssize_t)procs.size()) {
+      std::perror("write");
+    }
+    close(fd);
+  }
+  return directory;
+}
+}  // namespace
+
+void Bench::PidsBenchmarks() {
+  for (int numPids : {1000, 10000, 100000}) {
+    string suffix = "[" + to_string(numPids) + " pids]";
+    if (!Enabled("Pids/directory_iterator " + suffix) &&
+        !Enabled("Pids/getdents64 " + suffix)) {
+      continue;  // Don't build a tree for nothing
+    }
+    string directory = MakeFakeProc(numPids);
+
+    Run("Pids/directory_iterator " + suffix,
+        [&directory]() { LegacyPids(directory); });
+
+    PidEnumerator enumerator(directory);
+    vector<int> pids;
+    Run("Pids/getdents64 " + suffix,
+        [&enumerator, &pids]() { enumerator.Enumerate(pids); });
+
+    if (pids.size() != LegacyPids(directory).size()) {
+      std::fprintf(stderr, "Mismatch between implementations\n");
+    }
+    fs::remove_all(directory);
+  }
+
+  // A container's processes, against the 100000 pids above
+  if (Enabled("Pids/cgroup.procs [10 cgroups, 100 pids]")) {
+    string directory = MakeFakeCgroup(10, 10);
+    CgroupEnumerator enumerator(directory);
+    vector<int> pids;
+    Run("Pids/cgroup.procs [10 cgroups, 100 pids]",
+        [&enumerator, &pids]() { enumerator.Enumerate(pids); });
+    fs::remove_all(directory);
+  }
+
+  PidEnumerator enumerator(LinuxParser::kProcDirectory);
+  vector<int> pids;
+  Run("Pids/getdents64 [/proc]",
+      [&enumerator, &pids]() { enumerator.Enumerate(pids); });
+  Run("Pids/directory_iterator [/proc]",
+      []() { LegacyPids(LinuxParser::kProcDirectory); });
+}
@@ -0,0 +1,50 @@
+#include <string>
+#include <thread>
+
+#include "bench.h"
+#include "in_memory_data_source.h"
+#include "procfs_data_source.h"
+#include "system.h"
+
+using std::to_string;
+
+// End-to-end System::Refresh() time as a function of the number of threads
+// used to refresh processes, on the live /proc and on a frozen copy of it
+// (which gives the same input on every run, without syscalls). Then the
+// cost of refreshing idle processes on every tick, and of a budget.
+void Bench::RefreshScalingBenchmarks() {
+  ProcfsDataSource procfs;
+  InMemoryDataSource snapshot;
+  snapshot.Capture(procfs);
+
+  size_t maxThreads = std::max(1U, std::thread::hardware_concurrency());
+  for (size_t threads = 1; threads <= maxThreads; threads *= 2) {
+    System system(procfs, threads);
+    system.Refresh();
+    Run("System::Refresh [threads=" + to_string(threads) + ", " +
+            to_string(system.Processes().Size()) + " procs]",
+        [&system]() { system.Refresh(); });
+
+    System frozen(snapshot, threads);
+    frozen.Refresh();
+    Run("System::Refresh [in memory, threads=" + to_string(threads) + ", " +
+            to_string(frozen.Processes().Size()) + " procs]",
+        [&frozen]() { frozen.Refresh(); });
+  }
+
+  System untiered(procfs);
+  untiered.EnableTiers(false);
+  untiered.Refresh();
+  Run("System::Refresh [no tiers, " +
+          to_string(untiered.Processes().Size()) + " procs]",
+      [&untiered]() { untiered.Refresh(); });
+
+  // Filled before the budget applies, since adding processes comes out of
+  // it too
+  System budgeted(procfs);
+  budgeted.Refresh();
+  budgeted.SetSyscallBudget(64);
+  Run("System::Refresh [budget=64, " +
+          to_string(budgeted.Processes().Size()) + " procs]",
+      [&budgeted]() { budgeted.Refresh(); });
+}
@@ -0,0 +1,19 @@
+#ifndef BATCH_MODE_H
+#define BATCH_MODE_H
+
+#include "options.h"
+#include "recorder.h"
+#include "system.h"
+
+/*
+Headless mode: refreshes 'system' every options.intervalMs milliseconds and
+streams each sample to stdout as CSV or newline-delimited JSON, also
+recording it if 'recorder' isn't null
+*/
+namespace BatchMode {
+// Returns the process exit status
+int Run(System& system, const Options& options,
+        Recorder* recorder = nullptr);
+};  // namespace BatchMode
+
+#endif
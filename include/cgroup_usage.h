@@ -0,0 +1,47 @@
+#ifndef CGROUP_USAGE_H
+#define CGROUP_USAGE_H
+
+#include "data_source.h"
+#include "linux_parser.h"
+#include "processor.h"
+#include "refresh.h"
+#include "utilization.h"
+
+/*
+Totals of the cgroup the source is scoped to (see ProcfsDataSource), read
+from its own cgroup v2 files instead of summed over its processes: a few
+reads per tick, whatever the number of processes, and its CPU time
+includes that of processes which ended between two ticks. Rates are taken
+over the Processor's jiffy window (refreshed first), and CPU utilization
+is a share of the system's active time, as processes' is, so that the
+cgroup's matches the sum of its processes'.
+*/
+class CgroupUsage : private UtilizationInterface, private RefreshInterface {
+ public:
+  CgroupUsage(DataSource& source, const Processor& cpu);
+
+  // Share of the system's active CPU time used by the cgroup's processes
+  float Utilization() const override;
+  void Refresh() override;
+
+  // False unless the source is scoped to a cgroup
+  bool Present() const;
+  // Share of CPU controller periods in which the cgroup was throttled
+  float ThrottledPeriods() const;
+  unsigned long long ReadRate() const;   // Bytes per second
+  unsigned long long WriteRate() const;  // Bytes per second
+  const LinuxParser::CgroupSnapshot& Snapshot() const;
+
+ private:
+  DataSource& source_;
+  const Processor& cpu_;
+  bool present_{false};
+  float utilization_{0.0};
+  float throttledPeriods_{0.0};
+  unsigned long long readRate_{0};
+  unsigned long long writeRate_{0};
+  LinuxParser::CgroupSnapshot cgroup_ = {};  // Latest reading
+  LinuxParser::CgroupSnapshot prev_ = {};    // The one before
+};
+
+#endif
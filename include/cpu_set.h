@@ -0,0 +1,41 @@
+#ifndef CPU_SET_H
+#define CPU_SET_H
+
+#include <cstddef>
+
+#include "aligned_allocator.h"
+#include "linux_parser.h"
+
+/*
+Per-core CPU counters, for every state of /proc/stat's "cpuN" lines. Like
+the readings it takes in (LinuxParser::CoreTimes), each state's counters
+are kept in an aligned buffer of their own, indexed by core (structure of
+arrays), so that each step of Update() is a plain loop over all cores
+which the compiler can vectorize.
+*/
+class CpuSet {
+ public:
+  // Take in a new reading of every core (e.g. StatSnapshot::cores), and
+  // compute each core's deltas and utilization since the previous one
+  void Update(const LinuxParser::CoreTimes& cores);
+
+  std::size_t Size() const;
+  // Jiffies each core spent in 'state' between the last two readings
+  const AlignedVector<unsigned long long>& Deltas(
+      LinuxParser::CPUStates state) const;
+  // Active share of each core's jiffies between the last two readings
+  const AlignedVector<float>& Utilizations() const;
+
+ private:
+  void Resize(std::size_t size);
+
+ private:
+  using Counters = AlignedVector<unsigned long long>;
+  Counters prev_[LinuxParser::kNumCpuStates_];    // Last reading
+  Counters deltas_[LinuxParser::kNumCpuStates_];  // Since the one before
+  Counters active_;                               // Sum of active deltas
+  Counters total_;                                // Active and idle deltas
+  AlignedVector<float> utilizations_;
+};
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef DATA_SOURCE_H
+#define DATA_SOURCE_H
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <cstddef>
+#include <vector>
+
+#include "pid_files.h"
+
+// System-wide files read by the monitor
+enum SystemFile {
+  kProcStat_ = 0,  // /proc/stat
+  kProcMeminfo_,   // /proc/meminfo
+  kProcUptime_,    // /proc/uptime
+  kProcVersion_,   // /proc/version
+  kPidMax_,        // /proc/sys/kernel/pid_max
+  kOsRelease_,     // /etc/os-release
+  kPasswd_,        // /etc/passwd
+  // cgroup v2 files of the cgroup the monitor is scoped to (if any, see
+  // ProcfsDataSource)
+  kCgroupCpuStat_,        // cpu.stat
+  kCgroupMemoryCurrent_,  // memory.current
+  kCgroupMemoryStat_,     // memory.stat
+  kCgroupIoStat_,         // io.stat
+  kNumSystemFiles_
+};
+
+/*
+Where System (through LinuxParser) gets its raw data from: the live
+procfs, a procfs tree under some other root (e.g. a captured copy), or an
+in-memory snapshot. Implementations only provide file contents; all the
+parsing stays in LinuxParser, so every source is parsed the same way.
+
+The per-process reads may be called concurrently (from different threads,
+for different processes); everything else is called serially.
+*/
+class DataSource {
+ public:
+  virtual ~DataSource() = default;
+
+  // Replace the contents of 'buffer' (keeping its capacity) with the whole
+  // file. Returns false if it can't be read.
+  virtual bool ReadFile(SystemFile file, std::vector<char>& buffer) = 0;
+  // stat(2) the file, to detect that it changed
+  virtual bool Stat(SystemFile file, struct stat& st) = 0;
+
+  // Replace the contents of 'pids' (keeping its capacity) with the PIDs
+  // currently present (in the scoped cgroup, if any). Returns false on
+  // error.
+  virtual bool Pids(std::vector<int>& pids) = 0;
+
+  // Read a file re-read every tick, as PidFiles::Read() (through the
+  // descriptors 'files' caches, if the source uses any)
+  virtual ssize_t ReadPidFile(PidFiles& files, PidFile file, char* buffer,
+                              std::size_t size, long tick) = 0;
+  // Read any file of the process (e.g. "cmdline"), as ReadFile()
+  virtual bool ReadPidFile(int pid, const char* name,
+                           std::vector<char>& buffer) = 0;
+
+  // Replace the contents of 'tids' (keeping its capacity) with the IDs of
+  // the process's threads (/proc/<pid>/task). Returns false if it has
+  // ended. Called serially.
+  virtual bool Tids(int pid, std::vector<int>& tids) = 0;
+  // Read (up to 'size' bytes of) a thread's stat file, as
+  // PidFiles::Read() (without caching its descriptor)
+  virtual ssize_t ReadTaskStat(int pid, int tid, char* buffer,
+                               std::size_t size) = 0;
+};
+
+#endif
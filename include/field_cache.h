@@ -0,0 +1,41 @@
+#ifndef FIELD_CACHE_H
+#define FIELD_CACHE_H
+
+#include <curses.h>
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/*
+What was last drawn in each field (a fixed width span of a row) of a
+window. Redrawing a field only writes the characters which changed, so a
+tick which changes little costs little, both in curses and on the wire.
+*/
+class FieldCache {
+ public:
+  // Forget everything, e.g. once the window has been recreated
+  void Clear();
+
+  // Draw 'text' (truncated, or padded with spaces, to 'width') at 'row' and
+  // 'column' of 'window'
+  void Put(WINDOW* window, int row, int column, int width, const char* text,
+           std::size_t length, attr_t attributes = A_NORMAL);
+  void Put(WINDOW* window, int row, int column, int width, const char* text,
+           attr_t attributes = A_NORMAL);
+
+ private:
+  struct Field {
+    int column;
+    attr_t attributes;
+    std::string text;
+  };
+
+  Field& Find(int row, int column);
+
+ private:
+  std::vector<std::vector<Field>> rows_;  // Indexed by row
+  std::string padded_;                    // Reused by Put()
+};
+
+#endif
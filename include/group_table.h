@@ -0,0 +1,58 @@
+#ifndef GROUP_TABLE_H
+#define GROUP_TABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// What processes can be grouped by
+enum Grouping { kByCgroup_ = 0, kByUser_, kNumGroupings_ };
+
+/*
+Running totals (CPU, RAM and number of processes) of groups of processes,
+e.g. of each cgroup, kept up to date incrementally: a process joins its
+group with its current usage, then changes it and eventually leaves, and
+each of these only adjusts its own group's totals. Totals are integers, so
+that they don't drift however many changes they go through.
+
+A group is removed once its last process leaves, and its slot reused.
+*/
+class GroupTable {
+ public:
+  using Group = std::uint32_t;
+  static constexpr Group kNoGroup_{UINT32_MAX};
+
+  // The group named 'name' (created, empty, if there's none)
+  Group Intern(const std::string& name);
+  // The group named 'name', or kNoGroup_ if there's none
+  Group Find(const std::string& name) const;
+
+  // 'cpu' is in CPU utilization units of kCpuScale_, 'ram' in KiB
+  void Join(Group group, long long cpu, long long ram);
+  void Change(Group group, long long cpuDelta, long long ramDelta);
+  void Leave(Group group, long long cpu, long long ram);
+  void Clear();
+
+  // Groups are numbered [0, Size()), including those removed
+  std::size_t Size() const;
+  bool IsEmpty(Group group) const;  // i.e. removed
+  const std::string& Name(Group group) const;
+  int Processes(Group group) const;
+  long long Cpu(Group group) const;
+  long long Ram(Group group) const;
+
+  // One kCpuScale_th of the system's CPU time
+  static constexpr long long kCpuScale_{1000000};
+
+ private:
+  std::vector<std::string> names_;
+  std::vector<int> processes_;
+  std::vector<long long> cpu_;
+  std::vector<long long> ram_;
+  std::unordered_map<std::string, Group> index_;  // Of non-empty groups
+  std::vector<Group> free_;                       // Removed groups
+};
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef IN_MEMORY_DATA_SOURCE_H
+#define IN_MEMORY_DATA_SOURCE_H
+
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "data_source.h"
+
+/*
+A frozen set of file contents, captured from another source (see
+Capture()) or built file by file, e.g. to benchmark or regression test
+System::Refresh() with the same input on every run. Nothing changes unless
+one of the setters is called.
+*/
+class InMemoryDataSource : public DataSource {
+ public:
+  // Replace the contents with a copy of what 'source' currently holds:
+  // all system files, and for each process its stat, status, cmdline,
+  // cgroup and smaps_rollup files, and its threads' stat files
+  // ("task/<tid>/stat"). Returns false if 'source' couldn't be enumerated.
+  bool Capture(DataSource& source);
+
+  void SetFile(SystemFile file, const std::string& contents);
+  void SetProcessFile(int pid, const std::string& name,
+                      const std::string& contents);
+  void RemoveProcess(int pid);
+
+  bool ReadFile(SystemFile file, std::vector<char>& buffer) override;
+  bool Stat(SystemFile file, struct stat& st) override;
+  bool Pids(std::vector<int>& pids) override;
+  ssize_t ReadPidFile(PidFiles& files, PidFile file, char* buffer,
+                      std::size_t size, long tick) override;
+  bool ReadPidFile(int pid, const char* name,
+                   std::vector<char>& buffer) override;
+  bool Tids(int pid, std::vector<int>& tids) override;
+  ssize_t ReadTaskStat(int pid, int tid, char* buffer,
+                       std::size_t size) override;
+
+ private:
+  struct File {
+    std::string contents;
+    bool present{false};
+    long version{0};  // Incremented on each change, reported as mtime
+  };
+
+  struct ProcessFiles {
+    std::unordered_map<std::string, std::string> files;
+  };
+
+  File files_[kNumSystemFiles_];
+  std::map<int, ProcessFiles> processes_;  // Ordered: Pids() is sorted
+};
+
+#endif
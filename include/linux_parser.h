@@ -1,9 +1,17 @@
 #ifndef SYSTEM_PARSER_H
 #define SYSTEM_PARSER_H
 
+#include <sys/types.h>
+
+#include <cstddef>
 #include <fstream>
 #include <regex>
 #include <string>
+#include <vector>
+
+#include "aligned_allocator.h"
+#include "data_source.h"
+#include "pid_files.h"
 
 namespace LinuxParser {
 // Paths
@@ -15,20 +23,57 @@ const std::string kStatFilename{"/stat"};
 const std::string kUptimeFilename{"/uptime"};
 const std::string kMeminfoFilename{"/meminfo"};
 const std::string kVersionFilename{"/version"};
+const std::string kPidMaxFilename{"/sys/kernel/pid_max"};
 const std::string kOSPath{"/etc/os-release"};
 const std::string kPasswordPath{"/etc/passwd"};
+const std::string kCgroupDirectory{"/sys/fs/cgroup"};
+const std::string kCgroupUnifiedDirectory{"/sys/fs/cgroup/unified"};
+const std::string kCgroupControllersFilename{"/cgroup.controllers"};
+const std::string kCpuStatFilename{"/cpu.stat"};
+const std::string kMemoryCurrentFilename{"/memory.current"};
+const std::string kMemoryStatFilename{"/memory.stat"};
+const std::string kIoStatFilename{"/io.stat"};
 const std::string kSep{"/"};
+// File names, relative to a /proc/<pid> or cgroup directory
+const char* const kCmdlineName{"cmdline"};
+const char* const kStatusName{"status"};
+const char* const kCgroupName{"cgroup"};
+const char* const kSmapsRollupName{"smaps_rollup"};
+const char* const kCgroupProcsName{"cgroup.procs"};
+
+// Memory (all values in kB, as reported by /proc/meminfo)
+struct MeminfoSnapshot {
+  unsigned long long memTotal{0};
+  unsigned long long memFree{0};
+  unsigned long long memAvailable{0};
+  unsigned long long buffers{0};
+  unsigned long long cached{0};
+  unsigned long long swapCached{0};
+  unsigned long long active{0};
+  unsigned long long inactive{0};
+  unsigned long long swapTotal{0};
+  unsigned long long swapFree{0};
+  unsigned long long dirty{0};
+  unsigned long long writeback{0};
+  unsigned long long anonPages{0};
+  unsigned long long mapped{0};
+  unsigned long long shmem{0};
+  unsigned long long slab{0};
+  unsigned long long sReclaimable{0};
+  unsigned long long sUnreclaim{0};
+  unsigned long long pageTables{0};
+  unsigned long long committedAs{0};
+};
+bool ReadMeminfo(DataSource& source, MeminfoSnapshot& snapshot);
+void ParseMeminfo(const char* buffer, std::size_t length,
+                  MeminfoSnapshot& snapshot);
 
 // System
-unsigned long MemoryUtilizationEntry(std::string path, std::string entryName);
-float MemoryUtilization();
-long UpTime();
-std::vector<int> Pids();
-int GetProcessesEntry(std::string entryName);
-int TotalProcesses();
-int RunningProcesses();
-std::string OperatingSystem();
-std::string Kernel();
+long UpTime(DataSource& source);
+std::string OperatingSystem(DataSource& source);
+std::string Kernel(DataSource& source);
+// Highest PID plus one, or 0 if it can't be read
+long PidMax(DataSource& source);
 
 // CPU
 enum CPUStates {
@@ -44,27 +89,137 @@ enum CPUStates {
   kGuestNice_,
   kNumCpuStates_
 };
-std::vector<unsigned long long> CpuUtilization();
-unsigned long long Jiffies();
-unsigned long long ActiveJiffies();
-unsigned long long IdleJiffies();
-unsigned long long ActiveJiffies(int pid);
+struct CpuTimes {
+  unsigned long long times[kNumCpuStates_]{};
+
+  unsigned long long Active() const;
+  unsigned long long Idle() const;
+};
+
+// The "cpuN" lines, with one buffer per state, indexed by N (structure of
+// arrays, see CpuSet)
+struct CoreTimes {
+  AlignedVector<unsigned long long> times[kNumCpuStates_];
+
+  std::size_t Size() const;
+  void Resize(std::size_t size);
+};
+
+// Everything we use from /proc/stat, parsed in a single pass
+struct StatSnapshot {
+  CpuTimes total;                // Aggregate "cpu" line
+  CoreTimes cores;               // "cpuN" lines
+  unsigned long long ctxt{0};    // Context switches since boot
+  unsigned long long intr{0};    // Interrupts serviced since boot
+  unsigned long long forks{0};   // "processes", i.e. forks since boot
+  int procsRunning{0};
+  int procsBlocked{0};
+};
+bool ReadStat(DataSource& source, StatSnapshot& snapshot);
+void ParseStat(const char* buffer, std::size_t length, StatSnapshot& snapshot);
 
 // Processes
-std::string ProcessFolderPath(int pid);
-std::string Command(int pid);
-std::string Ram(int pid);
-int Uid(int pid);
-long StartTimeAfterBoot(int pid);
-bool ProcessHasEnded(int pid);
+// Fields of /proc/<pid>/stat that we use (see proc(5) for numbering)
+struct ProcStatRecord {
+  int pid{-1};                      // (1)
+  char comm[16]{};                  // (2) without the parentheses
+  char state{'?'};                  // (3)
+  int ppid{0};                      // (4)
+  unsigned long long utime{0};      // (14) clock ticks
+  unsigned long long stime{0};      // (15) clock ticks
+  long numThreads{0};               // (20)
+  unsigned long long startTime{0};  // (22) clock ticks after boot
+  unsigned long long vsize{0};      // (23) bytes
+  unsigned long long rss{0};        // (24) pages
+
+  unsigned long long ActiveJiffies() const { return utime + stime; }
+};
+bool ReadProcStat(DataSource& source, PidFiles& files, ProcStatRecord& record,
+                  long tick);
+bool ParseProcStat(const char* buffer, std::size_t length,
+                   ProcStatRecord& record);
+// /proc/<pid>/task/<tid>/stat has the same fields, for one thread
+bool ReadTaskStat(DataSource& source, int pid, int tid,
+                  ProcStatRecord& record);
+
+// Totals of /proc/<pid>/smaps_rollup (kB) which we use. Reading it walks
+// all of the process's mappings, so it costs far more than stat.
+struct SmapsRollupSnapshot {
+  unsigned long long rss{0};
+  unsigned long long pss{0};  // Shared pages count 1/(number of sharers)
+  unsigned long long privateClean{0};
+  unsigned long long privateDirty{0};
+  unsigned long long swap{0};
+
+  // Unique set size: what ending the process would free
+  unsigned long long Uss() const { return privateClean + privateDirty; }
+};
+bool ReadSmapsRollup(DataSource& source, int pid,
+                     SmapsRollupSnapshot& snapshot);
+void ParseSmapsRollup(const char* buffer, std::size_t length,
+                      SmapsRollupSnapshot& snapshot);
+
+std::string Command(DataSource& source, int pid);
+// The process's owner: its real UID, from its status file (rather than the
+// effective UID /proc/<pid> is owned by), or -1 if it has ended
+int Uid(DataSource& source, int pid);
+int ParseUid(const char* buffer, std::size_t length);
+// The process's cgroup: its cgroup v2 path (e.g. "/system.slice/x.service"),
+// or on a cgroup v1 only host its CPU controller's. Empty if it has ended.
+std::string Cgroup(DataSource& source, int pid);
+std::string ParseCgroup(const char* buffer, std::size_t length);
+
+// cgroup v2 accounting of the cgroup the source is scoped to, whose files
+// are read in a few syscalls however many processes it holds
+struct CgroupSnapshot {
+  // cpu.stat (microseconds), including processes which have ended
+  unsigned long long usageUsec{0};
+  unsigned long long userUsec{0};
+  unsigned long long systemUsec{0};
+  unsigned long long nrPeriods{0};
+  unsigned long long nrThrottled{0};
+  unsigned long long throttledUsec{0};
+  // memory.current and memory.stat (bytes), if the memory controller is on
+  bool hasMemory{false};
+  unsigned long long memoryCurrent{0};
+  unsigned long long anon{0};
+  unsigned long long file{0};
+  unsigned long long kernel{0};
+  unsigned long long shmem{0};
+  unsigned long long sock{0};
+  // io.stat, summed over all devices, if the io controller is on
+  bool hasIo{false};
+  unsigned long long rbytes{0};
+  unsigned long long wbytes{0};
+  unsigned long long rios{0};
+  unsigned long long wios{0};
+};
+// False if the source isn't scoped to a cgroup (there's no cpu.stat)
+bool ReadCgroup(DataSource& source, CgroupSnapshot& snapshot);
+void ParseCgroupCpuStat(const char* buffer, std::size_t length,
+                        CgroupSnapshot& snapshot);
+void ParseCgroupMemoryStat(const char* buffer, std::size_t length,
+                           CgroupSnapshot& snapshot);
+void ParseCgroupIoStat(const char* buffer, std::size_t length,
+                       CgroupSnapshot& snapshot);
+// cgroup.procs: one PID per line, appended to 'pids'
+void ParseCgroupProcs(const char* buffer, std::size_t length,
+                      std::vector<int>& pids);
 
 // Users
-std::string UserFromUid(int uid);
+struct PasswdEntry {
+  int uid;
+  std::string name;
+};
+bool ReadPasswd(DataSource& source, std::vector<PasswdEntry>& entries);
+void ParsePasswd(const char* buffer, std::size_t length,
+                 std::vector<PasswdEntry>& entries);
 
 // Helpers
-std::string GetRestOfLineAfterToken(const std::string filepath,
-                                    const std::string token);
-void SkipNTokens(std::ifstream& filestream, const int n);
+bool ReadFileIntoVector(const std::string& path, std::vector<char>& buffer);
+bool ReadFdIntoVector(int fd, std::vector<char>& buffer);
+const char* ParseUnsigned(const char* begin, const char* end,
+                          unsigned long long& value);
 
 };  // namespace LinuxParser
 
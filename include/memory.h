@@ -1,16 +1,26 @@
 #ifndef MEMORY_H
 #define MEMORY_H
 
+#include "data_source.h"
+#include "linux_parser.h"
 #include "refresh.h"
 #include "utilization.h"
 
 class Memory : private UtilizationInterface, private RefreshInterface {
  public:
+  explicit Memory(DataSource& source);
+
   float Utilization() const override;
   void Refresh() override;
 
+  float SwapUtilization() const;
+  const LinuxParser::MeminfoSnapshot& Snapshot() const;
+
  private:
+  DataSource& source_;
   float utilization_{0.0};
+  float swap_utilization_{0.0};
+  LinuxParser::MeminfoSnapshot meminfo_ = {};
 };
 
 #endif
@@ -3,21 +3,109 @@
 
 #include <curses.h>
 
-#include "process.h"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "field_cache.h"
+#include "recorder.h"
+#include "replayer.h"
+#include "row_order.h"
+#include "sample.h"
 #include "system.h"
 
 namespace NCursesDisplay {
-void Display(System& system, size_t n = 10);
+// Number of rows in the system window (including its border), with a
+// single row of per-core heatmap, and no cgroup
+const int kSystemWindowHeight{12};
+
+// Column of the system window's values, after their labels
+const int kValueColumn{10};
+
+// Cores are shown in groups of this many heatmap cells
+const int kHeatmapGroup{8};
+
+// Size of a buffer which fits any ProgressBar()
+const std::size_t kProgressBarSize{80};
+
+// The windows, kept from one tick to the next, and what was drawn in them
+struct Screen {
+  int lines{0};    // Terminal size the windows were laid out for
+  int columns{0};  // Terminal size the windows were laid out for
+  int heatmapRows{0};
+  bool cgroup{false};  // The system window has a row for the cgroup
+  WINDOW* system{nullptr};
+  WINDOW* processes{nullptr};
+  WINDOW* profile{nullptr};  // Overlay, when shown
+  FieldCache systemFields;
+  FieldCache processFields;
+  Grouping grouping{kNumGroupings_};  // Of the process window's contents
+  bool threads{false};                // Of the process window's contents
+  bool smaps{false};                  // Of the process window's contents
+  std::string title;  // Drawn on the system window's border
+};
+
+// What the user chose to display, through key presses
+struct Controls {
+  ProcessOrder order{kCpuDsc_};
+  GroupOrder groupOrder{kGroupCpuDsc_};
+  std::size_t n{10};  // Processes (or groups) shown
+  ProcessView view;
+  std::size_t cursor{0};  // Highlighted group, while groups are shown
+  bool profile{false};    // Overlay
+  bool quit{false};
+};
+
+// What the user chose to replay, through key presses
+struct ReplayControls {
+  std::size_t n{10};      // Processes shown
+  std::size_t speed{1};   // Frames per second
+  bool paused{false};
+  bool quit{false};
+};
+
+// Show the live system, recording each tick if 'recorder' isn't null. On
+// failure to start, returns false with errno set.
+bool Display(System& system, size_t n = 10, Recorder* recorder = nullptr);
 
-void SleepAndCheckInput(System& system, size_t& n, int millisecondsPerSleep,
-                        int numberOfSleeps, bool& quit);
+// Show a recording, with seek and fast forward. On failure to start,
+// returns false with errno set.
+bool Replay(Replayer& replayer, size_t n = 10);
 
-void DisplaySystem(System& system, WINDOW* window);
+// Apply a key press to 'controls', given what they last showed; returns
+// whether to redraw
+bool HandleInput(int ch, const Sample& shown, Controls& controls);
 
-void DisplayProcesses(std::vector<Process>& processes, WINDOW* window,
-                      size_t n);
+// Apply a key press to 'controls' (or 'replayer', to seek or sort),
+// given the number of processes in the frame shown; returns whether to
+// redraw
+bool HandleReplayInput(int ch, Replayer& replayer, size_t numProcesses,
+                       ReplayControls& controls);
+
+void DisplaySystem(const Sample& sample, WINDOW* window, FieldCache& fields);
+
+// The cgroup's totals, on the window's 'row'th row
+void DisplayCgroup(const CgroupSample& cgroup, WINDOW* window, int row,
+                   FieldCache& fields);
+
+void DisplayProcesses(const Sample& sample, WINDOW* window,
+                      FieldCache& fields);
+
+// The sample's groups, with the 'cursor'th highlighted
+void DisplayGroups(const Sample& sample, WINDOW* window, FieldCache& fields,
+                   std::size_t cursor);
+
+// The sample's threads, each with its process's PID and command
+void DisplayThreads(const Sample& sample, WINDOW* window, FieldCache& fields);
+
+// Per-phase timings of the refresh (see profiler.h)
+void DisplayProfile(WINDOW* window);
 
 std::string ProgressBar(float percent);
+std::size_t ProgressBar(float percent, char* buffer, std::size_t size);
+
+// Rows of the per-core heatmap in a system window 'width' columns wide
+int HeatmapRows(std::size_t numCores, int width);
 };  // namespace NCursesDisplay
 
 #endif
\ No newline at end of file
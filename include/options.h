@@ -0,0 +1,31 @@
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+#include <cstddef>
+#include <string>
+
+enum OutputFormat { kCsv_ = 0, kJson_ };
+
+// Command line options
+struct Options {
+  std::size_t threads{1};        // Threads used to refresh processes
+  bool nss{false};               // Resolve unknown UIDs with getpwuid_r()
+  bool batch{false};             // Stream samples to stdout (no ncurses)
+  std::size_t intervalMs{1000};  // Batch mode: time between samples
+  std::size_t count{0};          // Batch mode: samples to take (0: forever)
+  OutputFormat format{kCsv_};    // Batch mode: output format
+  std::string record;            // Record each tick to this file
+  std::string replay;            // Replay this recording
+  std::string root;              // Read <root>/proc and <root>/etc
+  std::string cgroup;            // Only monitor this cgroup v2 subtree
+  bool profile{false};           // Time refresh phases, report on exit
+  bool tiers{true};              // Refresh idle processes less often
+  std::size_t budget{0};         // Syscalls per tick (0: unlimited)
+  std::size_t threadScope{0};    // Processes whose threads are shown
+  std::size_t smapsMs{0};        // Reading PSS, per tick (0: don't)
+
+  static bool Parse(int argc, char* argv[], Options& options);
+  static void PrintUsage(const char* program);
+};
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef OUTPUT_BUFFER_H
+#define OUTPUT_BUFFER_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/*
+Append-only text buffer for streaming output. Numbers are formatted in
+place and strings escaped while being copied, so that once the buffer has
+reached its working size, formatting a sample doesn't allocate.
+*/
+class OutputBuffer {
+ public:
+  explicit OutputBuffer(std::size_t capacity = 1 << 20);
+
+  void Append(char c);
+  void Append(const char* text);
+  void Append(const char* text, std::size_t length);
+  void AppendUnsigned(unsigned long long value);
+  void AppendSigned(long long value);
+  // 'value' rounded to 'decimals' decimal places, e.g. "12.34"
+  void AppendFixed(double value, int decimals);
+  // Double quoted, with embedded quotes doubled (RFC 4180)
+  void AppendCsvString(const std::string& value);
+  // Double quoted, with JSON escapes
+  void AppendJsonString(const std::string& value);
+
+  // Write the buffer's contents to 'fd' and empty it. Returns false, with
+  // errno set, if a write fails.
+  bool Flush(int fd);
+
+  std::size_t Size() const;
+  const char* Data() const;
+
+ private:
+  char* Reserve(std::size_t length);
+
+ private:
+  std::vector<char> data_;
+  std::size_t size_{0};
+};
+
+#endif
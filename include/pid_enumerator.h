@@ -0,0 +1,66 @@
+#ifndef PID_ENUMERATOR_H
+#define PID_ENUMERATOR_H
+
+#include <string>
+#include <vector>
+
+/*
+Lists the numeric subdirectories (i.e. PIDs) of /proc, or of any other
+directory laid out like it. The directory is opened once and re-read with
+raw getdents64() calls into a reused buffer; entries are filtered on d_type,
+so no per-entry stat() is needed, and names are parsed in place.
+*/
+class PidEnumerator {
+ public:
+  explicit PidEnumerator(const std::string& directory);
+  ~PidEnumerator();
+
+  PidEnumerator(const PidEnumerator&) = delete;
+  PidEnumerator& operator=(const PidEnumerator&) = delete;
+
+  // Replace the contents of 'pids' (keeping its capacity) with the PIDs
+  // currently present, in directory order. Returns false on error.
+  bool Enumerate(std::vector<int>& pids);
+  // Same, for the directory 'path' relative to 'dirFd' (opened for this
+  // call only), e.g. "<pid>/task" to list a process's threads
+  bool EnumerateAt(int dirFd, const char* path, std::vector<int>& pids);
+
+ private:
+  bool List(int fd, std::vector<int>& pids);
+
+ private:
+  int fd_{-1};
+  std::vector<char> buffer_;
+};
+
+/*
+Lists the PIDs of a cgroup v2 subtree: those in the cgroup.procs file of
+the cgroup and of each of its descendants, in place of all of /proc, so
+that a container's processes cost a few reads however many processes the
+rest of the host runs. The cgroup's directory is opened once; its
+descendants are found with getdents64(), as above, on each call.
+*/
+class CgroupEnumerator {
+ public:
+  explicit CgroupEnumerator(const std::string& directory);
+  ~CgroupEnumerator();
+
+  CgroupEnumerator(const CgroupEnumerator&) = delete;
+  CgroupEnumerator& operator=(const CgroupEnumerator&) = delete;
+
+  // False if the cgroup's directory couldn't be opened
+  bool IsOpen() const;
+
+  // As PidEnumerator::Enumerate(), in no particular order
+  bool Enumerate(std::vector<int>& pids);
+
+ private:
+  int fd_{-1};
+  std::vector<char> buffer_;  // Directory entries
+  std::vector<char> procs_;   // cgroup.procs contents
+  // Descendants to visit (paths relative to the cgroup), reused so as to
+  // keep their capacity
+  std::vector<std::string> pending_;
+};
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef PID_FILES_H
+#define PID_FILES_H
+
+#include <sys/types.h>
+
+#include <atomic>
+#include <cstddef>
+
+// Files under /proc/<pid>/ that are re-read on every refresh
+enum PidFile { kPidStat_ = 0, kNumPidFiles_ };
+
+// Name of the file under /proc/<pid>/, e.g. "stat"
+const char* PidFileName(PidFile file);
+
+/*
+Cached descriptors for one process's /proc/<pid> directory and the files
+under it that are re-read every tick. The directory is opened relative to
+a persistent descriptor of /proc (or of any directory laid out like it,
+passed in by the owner) and the files relative to the directory (openat),
+after which a refresh is a single pread() per file.
+
+All PidFiles share a descriptor budget derived from RLIMIT_NOFILE: once it
+is used up, reads fall back to open/read/close without caching, and the
+owner is expected to Close() its least recently used entries to make room.
+*/
+class PidFiles {
+ public:
+  explicit PidFiles(int pid = -1);
+  ~PidFiles();
+
+  // Move-only (owns descriptors)
+  PidFiles(PidFiles&& other) noexcept;
+  PidFiles& operator=(PidFiles&& other) noexcept;
+  PidFiles(const PidFiles&) = delete;
+  PidFiles& operator=(const PidFiles&) = delete;
+
+  // Read (up to 'size' bytes of) the file from offset 0, 'procFd' being
+  // the directory holding the process directories. Returns the
+  // number of bytes read, 0 if the process has exited (ESRCH, ENOENT or
+  // an empty read) or -1 on any other error. 'tick' is recorded as the
+  // time of last use, for LRU eviction.
+  ssize_t Read(int procFd, PidFile file, char* buffer, std::size_t size,
+               long tick);
+
+  void Close();
+  int Pid() const;
+  int OpenCount() const;
+  long LastUsed() const;
+
+  static std::size_t DescriptorBudget();
+  static std::size_t DescriptorsInUse();
+
+ private:
+  int OpenDirectory(int procFd);
+  int OpenFile(int procFd, PidFile file);
+  ssize_t ReadUncached(int procFd, PidFile file, char* buffer,
+                       std::size_t size) const;
+  static bool Reserve(int count);
+  static void CloseFd(int& fd);
+
+ private:
+  int pid_{-1};
+  int dirFd_{-1};
+  int fds_[kNumPidFiles_];  // -1 until opened (see the constructor)
+  long lastUsed_{-1};
+
+  static std::atomic<std::size_t> inUse_;
+};
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef PID_INDEX_H
+#define PID_INDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+Open-addressing hash map from PID to row number (e.g. of a ProcessTable).
+Linear probing over a power-of-two table kept at most half full; deletions
+shift the following entries back rather than leaving tombstones, so lookups
+never degrade as processes come and go.
+*/
+class PidIndex {
+ public:
+  static constexpr std::uint32_t kNotFound_{UINT32_MAX};
+
+  PidIndex();
+
+  std::uint32_t Find(int pid) const;
+  void Insert(int pid, std::uint32_t row);  // Inserts or updates
+  void Erase(int pid);
+  std::size_t Size() const;
+  void Reserve(std::size_t count);
+
+ private:
+  struct Slot {
+    int pid;  // 0 means empty (PIDs are always positive)
+    std::uint32_t row;
+  };
+
+  std::size_t Home(int pid) const;
+  void Rehash(std::size_t capacity);
+
+ private:
+  std::vector<Slot> slots_;
+  std::size_t mask_{0};
+  std::size_t size_{0};
+};
+
+#endif
@@ -3,13 +3,16 @@
 
 #include <string>
 
+#include "process_table.h"
+
 /*
 Basic class for Process representation
-It contains relevant attributes as shown below
+It's a lightweight, read-only view of one row of a ProcessTable, exposing
+the relevant attributes as shown below
 */
 class Process {
  public:
-  Process(int pid);
+  Process(const ProcessTable& table, Row row);
   int Pid() const;
   std::string User() const;
   std::string Command() const;
@@ -17,18 +20,10 @@ class Process {
   std::string Ram() const;
   int RamAsInt() const;
   long UpTime() const;
-  bool HasEnded() const;
-  void Refresh(long systemUpTime, long systemActiveJiffiesDelta);
 
  private:
-  int pid_{-1};
-  std::string user_;
-  std::string cmd_;
-  long startTimeAfterBoot_{-1};
-  int ram_{-1};
-  long upTime_{-1};
-  unsigned long long prevActiveJiffies_{0};
-  float cpu_utilization_{-1.0};
+  const ProcessTable& table_;
+  Row row_;
 };
 
 #endif
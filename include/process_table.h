@@ -0,0 +1,195 @@
+#ifndef PROCESS_TABLE_H
+#define PROCESS_TABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "data_source.h"
+#include "group_table.h"
+#include "linux_parser.h"
+#include "pid_files.h"
+#include "pid_index.h"
+#include "string_pool.h"
+
+// Index of a row in a ProcessTable
+using Row = std::uint32_t;
+
+/*
+Columnar (structure-of-arrays) storage for all the processes being
+monitored: one contiguous array per attribute, indexed by row. Rows are
+kept dense: removing a row moves the last row into its place, so row
+numbers are only stable between calls to Add() and RemoveEnded(). User
+names and commands are interned in a StringPool, and a PidIndex maps PIDs
+to rows.
+
+A process is identified by its (PID, start time) pair, so that a PID that
+is reused by a new process between two refreshes isn't mistaken for the
+old one.
+
+Attributes which are only ever displayed or exported (owner, user name
+and command) are read lazily, by Materialize(), since most processes are
+never displayed and many end before they could be.
+
+Once enabled, the processes' CPU and RAM are also totalled by cgroup and
+by user (see GroupTable). Processes join their groups when added, leave
+them when removed, and Regroup() applies the change of each refreshed
+row, so that the totals cost nothing for processes which aren't
+refreshed. A process's cgroup and owner can change, so Regroup() also
+re-reads them now and then, ever less often.
+
+Rows are also sorted into tiers by activity: a refresh which finds that
+the process used CPU time puts it in tier 0, and one which finds it idle
+moves it down a tier. A row in tier k is due for a refresh every 2^k
+ticks (see System::ScheduleRefreshes()).
+
+Refresh() only writes to the given row, hence different rows can be
+refreshed concurrently. All other modifiers must be called serially.
+*/
+class ProcessTable {
+ public:
+  // Coldest tier: idle processes are refreshed every 2^kMaxTier_ ticks
+  static constexpr int kMaxTier_{5};
+  // Slowest cadence at which a process's groups are re-read
+  static constexpr int kMaxRejoinShift_{7};
+
+  // Processes are read from 'source'
+  explicit ProcessTable(DataSource& source);
+
+  std::size_t Size() const;
+  void Reserve(std::size_t capacity);
+
+  // Row of the process with the given PID, or PidIndex::kNotFound_
+  Row Find(int pid) const;
+
+  // Append a row for a newly found process, seen in enumeration 'tick',
+  // and fill it in from a single stat read (as Refresh() would). Returns
+  // false, without adding a row, if the process has already ended. CPU
+  // utilization is measured from 'systemActiveJiffies' (cumulative) on.
+  bool Add(int pid, long tick, long systemUpTime,
+           unsigned long long systemActiveJiffies);
+
+  // Record that the row's PID was present in the enumeration 'generation'
+  void MarkSeen(Row row, unsigned long generation);
+  // Mark the rows not seen in enumeration 'generation' as ended
+  void MarkUnseenAsEnded(unsigned long generation);
+
+  // Refresh the dynamic attributes of one row (CPU, RAM & up time) and
+  // its tier. CPU utilization is the row's share of the system's active
+  // jiffies (cumulative: 'systemActiveJiffies') since its last refresh.
+  // Also detects that the process has ended, or that its PID has been
+  // reused, in which case the row is refreshed for the new process.
+  void Refresh(Row row, long systemUpTime,
+               unsigned long long systemActiveJiffies, long tick);
+
+  // Read the row's PSS and USS (see LinuxParser::SmapsRollupSnapshot),
+  // which costs far more than Refresh(), and make it due again 'interval'
+  // ticks later. Returns false if they couldn't be read.
+  bool RefreshSmaps(Row row, long tick, long interval);
+
+  // Finish re-initializing the rows whose PID Refresh() found to have been
+  // reused by a new process, without reading their stat again. Returns the
+  // number of such rows.
+  std::size_t ResetReused();
+
+  // Update the up time of every row, without reading anything
+  void RefreshUpTimes(long systemUpTime);
+
+  // Read the row's display-only attributes (Uid(), User() & Command()),
+  // unless they've already been read
+  void Materialize(Row row);
+  // Reads saved so far by rows which ended (or were reused) before their
+  // display-only attributes were needed
+  unsigned long long AvoidedReads() const;
+
+  // Remove the rows of processes found to have ended
+  void RemoveEnded();
+
+  // Total the processes by group from now on (reading every process's
+  // cgroup and owner), or stop doing so
+  void EnableGroups(bool enable);
+  bool GroupsEnabled() const;
+  // Bring the groups' totals up to date with the rows' latest refresh
+  // Also re-reads the rows' cgroup and owner now and then, the first time
+  // at their first refresh after joining their groups, then 2, 4, ... up
+  // to 2^kMaxRejoinShift_ ticks apart. Returns the number of rows re-read.
+  std::size_t Regroup(const std::vector<Row>& rows, long tick);
+  void Regroup(Row begin, Row end);
+  const GroupTable& Groups(Grouping grouping) const;
+  GroupTable::Group GroupOf(Row row, Grouping grouping) const;
+
+  int Pid(Row row) const;
+  float CpuUtilization(Row row) const;
+  int Ram(Row row) const;  // Resident set, in MB
+  int Rss(Row row) const;  // KiB
+  int Pss(Row row) const;  // KiB, or -1 until RefreshSmaps()
+  int Uss(Row row) const;  // KiB, or -1 until RefreshSmaps()
+  long NextSmapsRefresh(Row row) const;  // Tick
+  long UpTime(Row row) const;
+  unsigned long long StartTime(Row row) const;      // Clock ticks after boot
+  unsigned long long ActiveJiffies(Row row) const;  // As of the last refresh
+  int Uid(Row row) const;                     // Once materialized
+  const std::string& User(Row row) const;     // Once materialized
+  const std::string& Command(Row row) const;  // Once materialized
+  bool HasEnded(Row row) const;
+  int Tier(Row row) const;
+  long NextRefresh(Row row) const;  // Tick at which the row is due
+  long LastRefresh(Row row) const;  // Tick it was last refreshed at
+  PidFiles& Files(Row row);
+
+  // Whole columns, for scans over all rows
+  const std::vector<int>& Pids() const;
+  const std::vector<float>& CpuUtilizations() const;
+  const std::vector<int>& Rams() const;  // Rss(), in KiB
+
+ private:
+  enum RowState : unsigned char { kAlive_ = 0, kEnded_, kReused_ };
+
+  void Initialize(Row row, const LinuxParser::ProcStatRecord& stat,
+                  unsigned long long systemActiveJiffies);
+  void Update(Row row, const LinuxParser::ProcStatRecord& stat,
+              long systemUpTime, unsigned long long systemActiveJiffies,
+              long tick);
+  void Remove(Row row);
+  void JoinGroups(Row row);
+  void LeaveGroups(Row row);
+  bool Rejoin(Row row);
+  void RegroupRow(Row row);
+  std::size_t PendingReads(Row row) const;
+
+ private:
+  DataSource& source_;
+  std::vector<int> pid_;
+  std::vector<unsigned long long> startTime_;  // Clock ticks after boot
+  std::vector<unsigned long> seen_;            // Enumeration generation
+  std::vector<RowState> state_;
+  std::vector<unsigned char> materialized_;  // uid_, user_ & cmd_ read
+  std::vector<int> uid_;
+  std::vector<StringHandle> user_;
+  std::vector<StringHandle> cmd_;
+  std::vector<int> rss_;  // KiB
+  std::vector<int> pss_;  // KiB
+  std::vector<int> uss_;  // KiB
+  std::vector<long> nextSmapsRefresh_;  // Tick
+  std::vector<long> upTime_;
+  std::vector<unsigned long long> prevActiveJiffies_;
+  std::vector<unsigned long long> prevSystemJiffies_;  // At last refresh
+  std::vector<float> cpuUtilization_;
+  std::vector<unsigned char> tier_;
+  std::vector<long> nextRefresh_;  // Tick
+  std::vector<PidFiles> files_;
+  std::vector<GroupTable::Group> groupOf_[kNumGroupings_];
+  std::vector<long long> groupedCpu_;  // As counted in the groups' totals
+  std::vector<long long> groupedRam_;  // Same, in KiB
+  std::vector<long> nextRejoin_;       // Tick
+  std::vector<unsigned char> rejoinShift_;  // Next interval: 2^shift ticks
+
+  StringPool strings_;
+  PidIndex index_;
+  unsigned long long avoidedReads_{0};
+  GroupTable groups_[kNumGroupings_];
+  bool grouped_{false};
+};
+
+#endif
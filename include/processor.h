@@ -1,20 +1,35 @@
 #ifndef PROCESSOR_H
 #define PROCESSOR_H
 
+#include "aligned_allocator.h"
+#include "cpu_set.h"
+#include "linux_parser.h"
 #include "refresh.h"
 #include "utilization.h"
 
+// Tracks aggregate and per-core CPU utilization. Refresh() doesn't read
+// /proc/stat itself: it consumes the snapshot the owner (System) reads once
+// per tick, so that all consumers see the same jiffy window.
 class Processor : private UtilizationInterface, private RefreshInterface {
  public:
+  explicit Processor(const LinuxParser::StatSnapshot& stat);
+
   float Utilization() const override;
   void Refresh() override;
-  unsigned long long ActiveJiffiesDelta();
+  unsigned long long ActiveJiffiesDelta() const;
+  unsigned long long JiffiesDelta() const;  // Active and idle, all cores
+  unsigned long long ActiveJiffies() const;  // Since boot
+  const AlignedVector<float>& CoreUtilizations() const;
+  const CpuSet& Cores() const;
 
  private:
+  const LinuxParser::StatSnapshot& stat_;
   float utilization_{0.0};
-  unsigned long actvJiffiesPrev_{0U};
-  unsigned long idleJiffiesPrev_{0U};
-  unsigned long actvJiffiesDelta_{0U};
+  unsigned long long actvJiffiesPrev_{0U};
+  unsigned long long idleJiffiesPrev_{0U};
+  unsigned long long actvJiffiesDelta_{0U};
+  unsigned long long jiffiesDelta_{0U};
+  CpuSet cores_;
 };
 
 #endif
@@ -0,0 +1,55 @@
+#ifndef PROCFS_DATA_SOURCE_H
+#define PROCFS_DATA_SOURCE_H
+
+#include <string>
+#include <vector>
+
+#include "data_source.h"
+#include "pid_enumerator.h"
+
+/*
+Reads procfs and /etc under 'root': "" (the default) for the live system,
+or e.g. the directory a production box's /proc and /etc were copied to.
+The proc directory is opened once; process files are opened relative to
+it, so a relocated tree costs the same to read as the live one.
+
+With a 'cgroup' (a cgroup v2 path, e.g. "/system.slice/docker-x.scope"),
+only the processes of that cgroup and its descendants are enumerated, and
+the cgroup's own accounting files are read too. The cgroup v2 hierarchy is
+looked for at /sys/fs/cgroup, then (on hybrid v1/v2 hosts) at
+/sys/fs/cgroup/unified, under 'root'.
+*/
+class ProcfsDataSource : public DataSource {
+ public:
+  explicit ProcfsDataSource(const std::string& root = "",
+                            const std::string& cgroup = "");
+  ~ProcfsDataSource() override;
+
+  ProcfsDataSource(const ProcfsDataSource&) = delete;
+  ProcfsDataSource& operator=(const ProcfsDataSource&) = delete;
+
+  // False if the proc directory (or the cgroup's) couldn't be opened
+  bool IsOpen() const;
+  // The cgroup's directory, or "" if not scoped to one
+  const std::string& CgroupDirectory() const;
+
+  bool ReadFile(SystemFile file, std::vector<char>& buffer) override;
+  bool Stat(SystemFile file, struct stat& st) override;
+  bool Pids(std::vector<int>& pids) override;
+  ssize_t ReadPidFile(PidFiles& files, PidFile file, char* buffer,
+                      std::size_t size, long tick) override;
+  bool ReadPidFile(int pid, const char* name,
+                   std::vector<char>& buffer) override;
+  bool Tids(int pid, std::vector<int>& tids) override;
+  ssize_t ReadTaskStat(int pid, int tid, char* buffer,
+                       std::size_t size) override;
+
+ private:
+  std::string paths_[kNumSystemFiles_];
+  int procFd_{-1};
+  std::string cgroupDirectory_;
+  PidEnumerator enumerator_;
+  CgroupEnumerator cgroupEnumerator_;
+};
+
+#endif
@@ -0,0 +1,99 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdio>
+#include <ctime>
+#include <string>
+
+/*
+Refresh phase profiler. PROFILE_SCOPE(phase) times the rest of the
+enclosing scope (wall clock, and the process's user & system CPU time)
+into that phase's histogram.
+
+Timers compile to nothing unless built with MONITOR_PROFILING (the CMake
+option of the same name), and cost a relaxed load and a branch while
+profiling is disabled at run time.
+*/
+enum ProfilePhase {
+  kRefresh_ = 0,   // System::Refresh(), as a whole
+  kSystemFiles_,   // uptime, passwd, stat, meminfo & cgroup files
+  kEnumerate_,     // PID enumeration & reconciliation
+  kParse_,         // Per-process parsing
+  kSweep_,         // Reused PIDs & ended processes
+  kAddNew_,        // New processes
+  kGroup_,         // Group totals (see ProcessTable::Regroup())
+  kThreads_,       // Threads of the top processes (see ThreadTable)
+  kSmaps_,         // PSS & USS (see System::RefreshSmaps())
+  kSort_,          // Top processes selection
+  kSample_,        // Sample copy
+  kDraw_,          // ncurses drawing
+  kNumProfilePhases_
+};
+
+namespace Profiler {
+// Histogram buckets: bucket b counts durations in [2^(b-1), 2^b) ns
+const std::size_t kNumBuckets{40};
+
+// Whether PROFILE_SCOPE() is compiled in
+#ifdef MONITOR_PROFILING
+const bool kBuiltIn{true};
+#else
+const bool kBuiltIn{false};
+#endif
+
+struct PhaseStats {
+  unsigned long long count;
+  unsigned long long totalNs;
+  unsigned long long maxNs;
+  unsigned long long userNs;    // CPU time of all threads
+  unsigned long long systemNs;  // CPU time of all threads
+  unsigned long long buckets[kNumBuckets];
+};
+
+extern std::atomic<bool> enabled;
+
+inline bool Enabled() { return enabled.load(std::memory_order_relaxed); }
+void Enable(bool enable);
+void Reset();
+
+const char* PhaseName(ProfilePhase phase);
+void Record(ProfilePhase phase, unsigned long long ns,
+            unsigned long long userNs, unsigned long long systemNs);
+void Snapshot(ProfilePhase phase, PhaseStats& stats);
+// Upper bound of the bucket holding the 'fraction' quantile (e.g. 0.99)
+unsigned long long Percentile(const PhaseStats& stats, double fraction);
+
+// One line per phase (which ran) under a header, e.g. for the overlay
+std::string Header();
+std::string FormatPhase(ProfilePhase phase, const PhaseStats& stats);
+void Dump(std::FILE* file);
+
+class ScopedTimer {
+ public:
+  explicit ScopedTimer(ProfilePhase phase);
+  ~ScopedTimer();
+
+  ScopedTimer(const ScopedTimer&) = delete;
+  ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+ private:
+  ProfilePhase phase_;
+  bool active_;
+  timespec start_;
+  unsigned long long userNs_;
+  unsigned long long systemNs_;
+};
+}  // namespace Profiler
+
+#ifdef MONITOR_PROFILING
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_NAME_(line) PROFILE_CONCAT_(profileTimer, line)
+#define PROFILE_SCOPE(phase) \
+  Profiler::ScopedTimer PROFILE_NAME_(__LINE__) { phase }
+#else
+#define PROFILE_SCOPE(phase)
+#endif
+
+#endif
@@ -0,0 +1,89 @@
+#ifndef RECORDER_H
+#define RECORDER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "pid_index.h"
+#include "recording.h"
+#include "process_table.h"
+#include "sample.h"
+#include "system.h"
+
+/*
+Appends one frame per tick to a recording (see recording.h). The file is
+written through a shared memory mapping, grown in large steps, and
+truncated to its contents when closed. Only the processes which were
+born, ended or changed since the previous frame are written, except for
+periodic keyframes.
+*/
+class Recorder {
+ public:
+  // One keyframe every so many frames
+  static const unsigned long kKeyframeInterval{300};
+
+  Recorder() = default;
+  Recorder(const Recorder&) = delete;
+  Recorder& operator=(const Recorder&) = delete;
+  ~Recorder();
+
+  // Create (or truncate) the recording at 'path'. On failure, returns
+  // false with errno set.
+  bool Open(const std::string& path);
+  // Append a frame for the system's latest refresh. On failure, returns
+  // false with errno set; the recording is then closed.
+  bool Record(System& system);
+  // Returns false, with errno set, if writing failed at any point
+  bool Close();
+
+  std::size_t Bytes() const;
+
+ private:
+  // A process which is new, or changed, since the previous frame
+  struct Change {
+    int pid;
+    Row row;  // In the system's process table
+    bool birth;
+    long long cpuDelta;  // Fixed-point (see Recording::kUtilizationScale)
+    int ramDelta;
+  };
+
+  std::uint32_t Intern(const std::string& text);
+  bool Append(Recording::RecordType type, const std::uint8_t* data,
+              std::size_t length);
+  bool Reserve(std::size_t length);
+  void TrackProcesses(const ProcessTable& table, bool keyframe);
+  void EncodeFrame(const ProcessTable& table);
+  void RemoveState(std::uint32_t index);
+
+ private:
+  int fd_{-1};
+  std::uint8_t* map_{nullptr};
+  std::size_t capacity_{0};
+  std::size_t size_{0};
+  bool failed_{false};
+  int error_{0};  // errno of the failure
+
+  unsigned long frames_{0};
+  long long lastTimestampMs_{0};
+  Sample sample_ = {};  // System columns of the frame being recorded
+  std::unordered_map<std::string, std::uint32_t> strings_ = {};
+
+  // What was recorded of each live process, indexed through index_
+  std::vector<int> pid_ = {};
+  std::vector<unsigned long long> startTime_ = {};  // Clock ticks
+  std::vector<std::uint64_t> cpu_ = {};  // Fixed-point
+  std::vector<int> ram_ = {};
+  std::vector<unsigned long> seen_ = {};  // Frame last seen in
+  PidIndex index_ = {};
+
+  // Reused for each frame
+  std::vector<Change> changes_ = {};
+  std::vector<int> deaths_ = {};
+  std::vector<std::uint8_t> frame_ = {};
+};
+
+#endif
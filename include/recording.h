@@ -0,0 +1,87 @@
+#ifndef RECORDING_H
+#define RECORDING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+On-disk format shared by the Recorder and the Replayer.
+
+A recording is an 8 byte magic followed by records, each being a 32-bit
+little-endian payload length, a one byte RecordType and the payload. A
+zero length ends the recording (the writer grows the file ahead of its
+contents, so a recording cut short by a crash is zero padded).
+
+String records hold the bytes of one string; strings are numbered in
+order of appearance from 1 (0 is the empty string), and only recorded
+once. Frame records hold one tick, as varints:
+  - system columns: timestamp (ms, delta from the previous frame), up
+    time, CPU utilization (1/10000ths), core count
+    and per-core utilizations, memory and swap utilization, available,
+    cached, dirty & slab memory (kB), total/running/blocked processes, OS
+    and kernel string ids
+  - deaths: count, then PIDs
+  - births: count, then columns of PIDs, start times (s after boot), user
+    ids, command ids, RAM (MB) and CPU utilizations (1/10000ths)
+  - updates: count, then columns of PIDs, CPU utilization deltas and RAM
+    deltas
+Within each section processes are sorted by PID and PIDs are delta
+encoded; signed values are zigzag encoded. A process's CPU utilization is
+the one the monitor showed: over the ticks since the process's last
+refresh, which with tiers may be many. Processes whose CPU and RAM didn't
+change are left out of the updates. Keyframes list all processes as
+births (with no deaths or updates) and have an absolute timestamp, so that
+replay can seek without decoding from the start.
+*/
+namespace Recording {
+const char kMagic[8] = {'C', 'P', 'P', 'M', 'O', 'N', 'R', '2'};
+
+enum RecordType : std::uint8_t { kString_ = 1, kFrame_, kKeyframe_ };
+
+// Fixed-point scale of utilizations
+const float kUtilizationScale{10000.0};
+
+inline void PutVarint(std::vector<std::uint8_t>& out, std::uint64_t value) {
+  while (value >= 0x80) {
+    out.push_back((std::uint8_t)(value | 0x80));
+    value >>= 7;
+  }
+  out.push_back((std::uint8_t)value);
+}
+
+inline void PutSigned(std::vector<std::uint8_t>& out, std::int64_t value) {
+  PutVarint(out, ((std::uint64_t)value << 1) ^ (std::uint64_t)(value >> 63));
+}
+
+// Reads varints from [next, end); 'ok' turns false on truncated input
+struct Cursor {
+  const std::uint8_t* next;
+  const std::uint8_t* end;
+  bool ok{true};
+
+  std::uint64_t Varint() {
+    std::uint64_t value{0};
+    for (int shift = 0; shift < 64; shift += 7) {
+      if (next == end) {
+        ok = false;
+        return 0;
+      }
+      std::uint8_t byte = *next++;
+      value |= (std::uint64_t)(byte & 0x7F) << shift;
+      if (byte < 0x80) {
+        return value;
+      }
+    }
+    ok = false;
+    return 0;
+  }
+
+  std::int64_t Signed() {
+    std::uint64_t value = Varint();
+    return (std::int64_t)(value >> 1) ^ -(std::int64_t)(value & 1);
+  }
+};
+};  // namespace Recording
+
+#endif
@@ -0,0 +1,83 @@
+#ifndef REPLAYER_H
+#define REPLAYER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "pid_index.h"
+#include "recording.h"
+#include "row_order.h"
+#include "sample.h"
+
+/*
+Reads a recording (see recording.h) through a read-only memory mapping.
+Opening it indexes its frames and strings; seeking decodes from the
+nearest keyframe at or before the target frame.
+*/
+class Replayer {
+ public:
+  Replayer() = default;
+  Replayer(const Replayer&) = delete;
+  Replayer& operator=(const Replayer&) = delete;
+  ~Replayer();
+
+  // On failure, returns false with a description in Error()
+  bool Open(const std::string& path);
+  const std::string& Error() const;
+
+  std::size_t NumFrames() const;
+  // Index of the frame replayed, once Seek() has succeeded
+  std::size_t Position() const;
+  // Replay frame 'frame' (clamped to the last one). Returns false if the
+  // recording is corrupt.
+  bool Seek(std::size_t frame);
+
+  // Copy the frame replayed into 'sample', keeping only the top 'n'
+  // processes in the current order
+  void FillSample(Sample& sample, std::size_t n);
+  // Time since the first frame
+  long long ElapsedMs() const;
+
+  void ToggleProcessOrderByCpu();
+  void ToggleProcessOrderByMemory();
+
+ private:
+  struct FrameRef {
+    const std::uint8_t* data;
+    std::size_t length;
+    bool keyframe;
+  };
+
+  bool Apply(const FrameRef& frame);
+  void RemoveRow(std::uint32_t row);
+  void Clear();
+
+ private:
+  std::uint8_t* map_{nullptr};
+  std::size_t mapSize_{0};
+  std::string error_;
+  std::vector<std::string> strings_ = {};
+  std::vector<FrameRef> frames_ = {};
+  std::size_t position_{0};
+  bool positioned_{false};
+  long long firstTimestampMs_{0};
+  ProcessOrder order_{kCpuDsc_};
+
+  // System columns of the frame replayed (without processes)
+  Sample sample_ = {};
+
+  // Processes of the frame replayed, one row each, indexed through index_
+  std::vector<int> pid_ = {};
+  std::vector<long> startTime_ = {};  // Seconds after boot
+  std::vector<std::uint32_t> user_ = {};
+  std::vector<std::uint32_t> command_ = {};
+  std::vector<int> ram_ = {};
+  std::vector<std::uint64_t> fixedCpu_ = {};  // As recorded
+  std::vector<float> cpu_ = {};
+  PidIndex index_ = {};
+  std::vector<std::uint32_t> rows_ = {};  // Reused by FillSample()
+};
+
+#endif
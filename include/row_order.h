@@ -0,0 +1,54 @@
+#ifndef ROW_ORDER_H
+#define ROW_ORDER_H
+
+#include <cstdint>
+#include <vector>
+
+enum ProcessOrder { kCpuAsc_ = 0, kCpuDsc_, kMemoryAsc_, kMemoryDsc_ };
+
+// Orders of groups of processes, by total CPU, RAM or number of processes
+enum GroupOrder {
+  kGroupCpuAsc_ = 0,
+  kGroupCpuDsc_,
+  kGroupMemoryAsc_,
+  kGroupMemoryDsc_,
+  kGroupSizeAsc_,
+  kGroupSizeDsc_
+};
+
+/*
+Strict weak ordering of rows of process columns (CPU utilization, RAM and
+PID, indexed by row) for a ProcessOrder. Ties are broken on PID, so that
+rows with equal values keep their relative order from one tick to the
+next rather than flickering.
+*/
+struct RowOrder {
+  RowOrder(const std::vector<float>& cpu, const std::vector<int>& ram,
+           const std::vector<int>& pid, ProcessOrder order)
+      : cpu(cpu), ram(ram), pid(pid), order(order) {}
+
+  bool operator()(std::uint32_t a, std::uint32_t b) const {
+    switch (order) {
+      case kCpuAsc_:
+        if (cpu[a] != cpu[b]) return cpu[a] < cpu[b];
+        break;
+      case kCpuDsc_:
+        if (cpu[a] != cpu[b]) return cpu[a] > cpu[b];
+        break;
+      case kMemoryAsc_:
+        if (ram[a] != ram[b]) return ram[a] < ram[b];
+        break;
+      case kMemoryDsc_:
+        if (ram[a] != ram[b]) return ram[a] > ram[b];
+        break;
+    }
+    return pid[a] < pid[b];
+  }
+
+  const std::vector<float>& cpu;
+  const std::vector<int>& ram;
+  const std::vector<int>& pid;
+  ProcessOrder order;
+};
+
+#endif
@@ -0,0 +1,102 @@
+#ifndef SAMPLE_H
+#define SAMPLE_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "group_table.h"
+
+// What the display shows of one process
+struct ProcessSample {
+  int pid{0};
+  std::string user;
+  std::string command;
+  float cpuUtilization{0.0};
+  int ram{0};   // MB, resident
+  int pss{-1};  // MB, or -1 if not read (yet)
+  int uss{-1};  // MB, or -1 if not read (yet)
+  long upTime{0};
+};
+
+// What the display shows of one thread (see ThreadTable)
+struct ThreadSample {
+  int tid{0};
+  std::size_t process{0};  // Its process's index in Sample::processes
+  std::string name;
+  char state{'?'};
+  float cpuUtilization{0.0};
+  bool stale{false};  // Not read this tick (out of --budget): as last read
+};
+
+// What the display shows of one group of processes (see GroupTable)
+struct GroupSample {
+  std::string name;
+  int processes{0};
+  float cpuUtilization{0.0};
+  long long ram{0};  // MB
+};
+
+// What the display shows of the cgroup the monitor is scoped to (see
+// CgroupUsage)
+struct CgroupSample {
+  bool present{false};  // False unless scoped to a cgroup
+  std::string name;
+  float cpuUtilization{0.0};
+  float throttledPeriods{0.0};
+  bool hasMemory{false};            // Memory controller enabled
+  unsigned long long memory{0};     // kB
+  unsigned long long anon{0};       // kB
+  unsigned long long file{0};       // kB
+  bool hasIo{false};                // IO controller enabled
+  unsigned long long readRate{0};   // kB/s
+  unsigned long long writeRate{0};  // kB/s
+};
+
+// Which processes to show: all of them, their totals by group, or those of
+// one group ("drilling down" into it)
+struct ProcessView {
+  Grouping grouping{kNumGroupings_};  // kNumGroupings_: not grouped
+  bool drillDown{false};              // Into 'group'
+  std::string group;
+  bool threads{false};  // The threads of the top processes, instead
+};
+
+/*
+Everything the display shows for one tick, whether it comes from the live
+system or from a recording. Only the processes to be displayed are kept,
+already in display order (except for Sampler snapshots, which keep the
+top processes in every order, for the display to pick from).
+*/
+struct Sample {
+  long long timestampMs{0};  // Wall clock (ms since the epoch)
+  std::string os;
+  std::string kernel;
+  float cpuUtilization{0.0};
+  std::vector<float> coreUtilizations;
+  float memoryUtilization{0.0};
+  float swapUtilization{0.0};
+  unsigned long long memAvailable{0};  // kB
+  unsigned long long cached{0};        // kB
+  unsigned long long dirty{0};         // kB
+  unsigned long long slab{0};          // kB
+  CgroupSample cgroup;
+  long upTime{0};
+  int totalProcesses{0};
+  int runningProcesses{0};
+  int blockedProcesses{0};
+  std::size_t numProcesses{0};  // All processes, not just those below
+  bool smaps{false};  // Processes' PSS and USS are read
+  unsigned long long readsAvoided{0};  // By lazy materialization, so far
+  std::vector<ProcessSample> processes;
+  // Instead of processes, with a grouping other than kNumGroupings_: all
+  // the groups (in no particular order)
+  Grouping grouping{kNumGroupings_};
+  std::vector<GroupSample> groups;
+  // With showThreads: the threads of the processes above (in no particular
+  // order), which are then the top processes by CPU
+  bool showThreads{false};
+  std::vector<ThreadSample> threads;
+};
+
+#endif
@@ -0,0 +1,79 @@
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "recorder.h"
+#include "sample.h"
+#include "system.h"
+#include "triple_buffer.h"
+
+/*
+Refreshes the system on a thread of its own, on request, and publishes a
+snapshot (a Sample) after each refresh. Snapshots are handed over through
+a triple buffer, and announced on an eventfd, so that the display can
+wait for input and snapshots alike in poll() and never waits for a
+refresh to complete.
+*/
+class Sampler {
+ public:
+  // Sample 'system', recording each refresh if 'recorder' isn't null
+  Sampler(System& system, Recorder* recorder);
+  Sampler(const Sampler&) = delete;
+  Sampler& operator=(const Sampler&) = delete;
+  ~Sampler();  // Stops the thread
+
+  // Start the thread. On failure, returns false with errno set.
+  bool Start();
+
+  // Refresh, then publish a snapshot. Requests made while a refresh is
+  // under way are merged into one.
+  void RequestRefresh();
+  // Keep the top 'n' processes in every order in snapshots; a larger 'n'
+  // is published straight away (without a refresh)
+  void SetRows(std::size_t n);
+
+  // Processes on display, to be refreshed on every tick
+  void SetVisible(const std::vector<int>& pids);
+  // What snapshots hold (see System::FillSampleInAllOrders()); a new view
+  // is published straight away
+  void SetView(const ProcessView& view);
+
+  // Readable once a new snapshot has been published
+  int EventFd() const;
+  // Switch to the latest snapshot; returns false if there's none newer
+  bool Update();
+  // The latest snapshot as of the last Update()
+  const Sample& Snapshot() const;
+  // Whether refreshes are still being recorded (i.e. none failed)
+  bool Recording() const;
+
+ private:
+  void Run();
+  void Publish();
+
+ private:
+  System& system_;
+  Recorder* recorder_;
+  std::atomic<bool> recording_;
+  TripleBuffer<Sample> snapshots_;
+  int eventFd_{-1};
+  std::thread thread_;
+
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  bool refresh_{false};    // Request, under mutex_
+  bool publish_{false};    // Request, under mutex_
+  bool stop_{false};       // Request, under mutex_
+  std::size_t rows_{0};    // Under mutex_
+  std::vector<int> visible_;  // Under mutex_
+  ProcessView view_;          // Under mutex_
+  bool refreshed_{false};  // Sampler thread only
+};
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef STRING_POOL_H
+#define STRING_POOL_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Handle to a string interned in a StringPool
+using StringHandle = std::uint32_t;
+
+/*
+Reference counted string interning. Equal strings (e.g. the user names and
+commands shared by many processes) are stored once and referred to by a
+small handle. Released slots are recycled.
+*/
+class StringPool {
+ public:
+  StringPool();
+
+  // Handle of the empty string, which is always present
+  static constexpr StringHandle kEmpty_{0};
+
+  StringHandle Intern(const std::string& value);
+  void Release(StringHandle handle);
+  const std::string& Get(StringHandle handle) const;
+  std::size_t Size() const;
+
+ private:
+  std::vector<std::string> strings_;
+  std::vector<std::uint32_t> refCounts_;
+  std::vector<StringHandle> free_;
+  std::unordered_map<std::string, StringHandle> index_;
+};
+
+#endif
@@ -1,49 +1,139 @@
 #ifndef SYSTEM_H
 #define SYSTEM_H
 
+#include <cstddef>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include "cgroup_usage.h"
+#include "data_source.h"
+#include "linux_parser.h"
 #include "memory.h"
 #include "process.h"
+#include "process_table.h"
 #include "processor.h"
 #include "refresh.h"
+#include "row_order.h"
+#include "sample.h"
+#include "thread_pool.h"
+#include "thread_table.h"
 #include "users.h"
 
-enum ProcessOrder { kCpuAsc_ = 0, kCpuDsc_, kMemoryAsc_, kMemoryDsc_ };
-
 class System : private RefreshInterface {
  public:
+  // Monitor the system 'source' describes (e.g. a ProcfsDataSource)
+  explicit System(DataSource& source, std::size_t numThreads = 1);
+
   void Refresh() override;
 
   Processor& Cpu();
   Memory& MemoryInfo();
-  std::vector<Process>& Processes();
+  // Totals of the cgroup the source is scoped to, if any
+  CgroupUsage& CgroupInfo();
+  // The cgroup's name, as displayed (e.g. the path it was scoped with)
+  void SetCgroupName(const std::string& name);
+  const ProcessTable& Processes();
+  const std::vector<Row>& TopProcesses(std::size_t n, ProcessOrder order);
+  const std::vector<Row>& TopProcesses(std::size_t n);
+  const std::vector<Row>& SortedProcesses(ProcessOrder order);
+  // Copy what the display shows, including the top 'n' processes
+  void FillSample(Sample& sample, std::size_t n);
+  // Same, with the top 'n' processes in every order (see Sampler), or
+  // all the groups, or the threads of the top processes, as 'view' says
+  void FillSampleInAllOrders(Sample& sample, std::size_t n,
+                             const ProcessView& view = ProcessView());
   long UpTime();
   int TotalProcesses();
   int RunningProcesses();
+  int BlockedProcesses();
+  unsigned long long ContextSwitches();
+  unsigned long long Interrupts();
   std::string Kernel();
   std::string OperatingSystem();
+  // Refresh idle processes less often (see ProcessTable), within a budget
+  // of syscalls per tick (0: no limit). On by default.
+  void EnableTiers(bool enable);
+  void SetSyscallBudget(std::size_t budget);
+  // Refresh these processes (e.g. those displayed) on every tick
+  void PinProcesses(const std::vector<int>& pids);
+  // Read the threads of the top 'scope' processes by CPU (0: as many as
+  // the view shows) while the view asks for threads
+  void SetThreadScope(std::size_t scope);
+  // Read processes' PSS and USS for up to 'budgetMs' per tick (0: never),
+  // displayed processes first, then those with the largest resident sets
+  void SetSmapsBudget(std::size_t budgetMs);
+  // Number of processes read by the latest refresh
+  std::size_t RefreshedProcesses() const;
+  // Read the user and command of these processes (e.g. to export them), or
+  // of all of them; they're otherwise only read once displayed
+  void MaterializeProcesses(const std::vector<Row>& rows);
+  void MaterializeProcesses();
+  // Reads which lazy materialization saved (see ProcessTable)
+  unsigned long long LazyReadsAvoided() const;
   void ToggleProcessOrderByCpu();
   void ToggleProcessOrderByMemory();
+  ProcessOrder GetProcessOrder() const;
 
  private:
   void RefreshProcesses();
-  void PopulateNewProcesses();
-  std::vector<int> GetSortedActiveProcessPids();
-  std::vector<int> GetSortedCachedProcessPids();
-  void SortProcesses();
+  void ReconcilePids();
+  void AddNewProcesses();
+  void ScheduleRefreshes();
+  std::size_t RefreshCost(Row row);
+  std::size_t AddCost() const;
+  std::size_t JoinCost() const;
+  long ReuseHorizon();
+  void RefreshProcessRows(const std::vector<Row>& rows);
+  void EnforceDescriptorBudget();
+  void SelectTop(std::vector<Row>& rows, std::size_t n, ProcessOrder order);
+  void FillSystemSample(Sample& sample);
+  void FillCgroupSample(CgroupSample& sample);
+  void FillProcessSamples(Sample& sample, const std::vector<Row>& rows);
+  void FillGroupSamples(Sample& sample, Grouping grouping);
+  void RefreshSmaps();
+  void RefreshThreads(std::size_t n);
+  void FillThreadSamples(Sample& sample);
 
  private:
-  Processor cpu_ = {};                   // Refreshed
-  Memory memory_ = {};                   // Refreshed
+  DataSource& source_;                   // Where everything is read from
+  LinuxParser::StatSnapshot stat_ = {};  // Refreshed (read once per tick)
+  Processor cpu_{stat_};                 // Refreshed (from stat_)
+  Memory memory_{source_};               // Refreshed
+  CgroupUsage cgroup_{source_, cpu_};    // Refreshed (after cpu_)
+  std::string cgroupName_;               // Set once
   long upTime_{0};                       // Refreshed
-  int proc_running_{0};                  // Refreshed
-  int proc_total_{0};                    // Refreshed
-  std::vector<Process> processes_ = {};  // Refreshed
+  long tick_{0};                         // Incremented on each refresh
+  ProcessTable processes_{source_};      // Refreshed
+  std::vector<Row> selected_rows_ = {};  // Result of TopProcesses()
+  std::vector<Row> candidateRows_ = {};  // Reused by FillSampleInAllOrders()
+  std::vector<Row> groupRows_ = {};      // Reused by FillSampleInAllOrders()
+  std::vector<int> activePids_ = {};     // Reused for each enumeration
+  std::vector<int> newPids_ = {};        // Reused for each enumeration
+  std::vector<Row> lruRows_ = {};        // Reused when evicting descriptors
+  std::vector<Row> dueRows_ = {};        // Rows to refresh this tick
+  std::vector<Row> overdueRows_ = {};    // Due, but not pinned
+  std::size_t addBudget_{0};             // Syscalls left for new processes
+  long pidMax_{0};                       // Read once
+  // (tick, forks since boot) of recent ticks, see ReuseHorizon()
+  std::vector<std::pair<long, unsigned long long>> forkHistory_ = {};
+  std::vector<int> pinnedPids_ = {};     // Refreshed on every tick
+  ThreadTable threads_{source_};         // Refreshed while viewed
+  std::vector<Row> threadRows_ = {};     // The processes threads_ reads
+  std::vector<int> threadPids_ = {};     // Of threadRows_, in order
+  // (PID, index in threadRows_) of the same processes, sorted by PID
+  std::vector<std::pair<int, std::size_t>> threadProcesses_ = {};
+  long threadsTick_{-1};                 // Of threads_' latest refresh
+  std::size_t threadScope_{0};           // Processes; 0: as many as shown
+  std::vector<Row> smapsRows_ = {};      // Reused by RefreshSmaps()
+  std::size_t smapsBudgetMs_{0};         // Per tick; 0: PSS isn't read
+  bool tiered_{true};                    // Skip idle processes' refreshes
+  std::size_t syscallBudget_{0};         // Per tick; 0: unlimited
+  std::size_t refreshedRows_{0};         // By the latest refresh
   std::string os_;                       // Read & set once (cached)
   std::string kernel_;                   // Read & set once (cached)
   ProcessOrder proc_order_{kCpuDsc_};    // Can be toggled at run time
+  ThreadPool pool_;                      // Used to refresh processes
 };
 
 #endif
@@ -0,0 +1,67 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+Fixed size work-stealing thread pool for data parallel loops.
+ParallelFor() splits a range into chunks which are dealt out round-robin
+to per-thread queues; each thread drains its own queue from the back and,
+once empty, steals from the front of the others'. The calling thread takes
+part in the work, so a pool of size 1 simply runs the loop inline.
+*/
+class ThreadPool {
+ public:
+  using RangeFunction = std::function<void(std::size_t, std::size_t)>;
+
+  explicit ThreadPool(std::size_t numThreads);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  std::size_t Size() const;
+
+  // Call body(begin, end) for consecutive sub-ranges of [0, count) of (at
+  // most) 'grain' elements, concurrently. Returns once all have completed.
+  void ParallelFor(std::size_t count, std::size_t grain,
+                   const RangeFunction& body);
+
+ private:
+  struct Range {
+    std::size_t begin;
+    std::size_t end;
+  };
+  struct Queue {
+    std::mutex mutex;
+    std::deque<Range> ranges;
+  };
+
+  void WorkerLoop(std::size_t self);
+  void RunTasks(std::size_t self);
+  bool PopLocal(std::size_t self, Range& range);
+  bool Steal(std::size_t self, Range& range);
+
+ private:
+  std::vector<std::unique_ptr<Queue>> queues_;
+  std::vector<std::thread> workers_;
+
+  const RangeFunction* body_{nullptr};
+  std::atomic<std::size_t> pending_{0};
+
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::condition_variable done_;
+  unsigned long generation_{0};
+  bool stop_{false};
+};
+
+#endif
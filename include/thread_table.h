@@ -0,0 +1,73 @@
+#ifndef THREAD_TABLE_H
+#define THREAD_TABLE_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "data_source.h"
+#include "linux_parser.h"
+#include "pid_index.h"
+#include "process_table.h"
+
+/*
+The threads of a few processes (e.g. the top ones), from their
+/proc/<pid>/task/<tid>/stat files, each read once and parsed with the same
+single pass parser as processes' stat files. As in ProcessTable, storage
+is columnar with a PidIndex from TID to row, and a thread is identified by
+its (TID, start time) pair.
+
+Only the threads of the processes given to Refresh() are read, and those
+of processes which no longer are are dropped: a tick costs as much as the
+threads of the processes of interest, however many threads the system
+runs.
+*/
+class ThreadTable {
+ public:
+  // Threads are read from 'source'
+  explicit ThreadTable(DataSource& source);
+
+  // Read the threads of 'pids', in order, within 'budget' syscalls (0:
+  // unlimited). CPU utilization is a thread's share of the system's active
+  // jiffies (cumulative: 'systemActiveJiffies') since it was last read.
+  // The threads left out for lack of budget are kept, but aren't
+  // Current(), and the next call starts with them. Returns the number of
+  // threads read.
+  std::size_t Refresh(const std::vector<int>& pids,
+                      unsigned long long systemActiveJiffies,
+                      std::size_t budget);
+  void Clear();
+
+  std::size_t Size() const;
+  int Tid(Row row) const;
+  int Pid(Row row) const;  // Of the thread's process
+  const std::string& Name(Row row) const;
+  char State(Row row) const;
+  float CpuUtilization(Row row) const;
+  bool Current(Row row) const;  // Read by the latest Refresh()
+
+ private:
+  void Update(int pid, int tid, const LinuxParser::ProcStatRecord& stat,
+              unsigned long long systemActiveJiffies);
+  void Remove(Row row);
+
+ private:
+  DataSource& source_;
+  unsigned long generation_{0};  // Incremented by each Refresh()
+  std::vector<int> tid_;
+  std::vector<int> pid_;
+  std::vector<unsigned long long> startTime_;  // Clock ticks after boot
+  std::vector<std::string> name_;  // At most 15 characters: not allocated
+  std::vector<char> state_;
+  std::vector<unsigned long long> prevActiveJiffies_;
+  std::vector<unsigned long long> prevSystemJiffies_;  // At last read
+  std::vector<float> cpuUtilization_;
+  std::vector<unsigned long> seen_;  // Generation last read in
+  PidIndex index_;
+  std::vector<int> tids_;        // Reused for each process
+  std::vector<int> skipped_;     // Processes left out by Refresh(), sorted
+  int resumePid_{0};             // Where the next Refresh() starts...
+  std::size_t resumeOffset_{0};  // ...in the process's threads
+};
+
+#endif
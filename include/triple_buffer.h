@@ -0,0 +1,50 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <atomic>
+
+/*
+Lock-free single producer, single consumer handoff of the latest value.
+The writer fills Back() and publishes it; the reader picks up the latest
+published value with Update() and reads it through Front(). Each side
+owns one of the three buffers at any time and the third is in the
+middle, so neither side ever waits for the other, nor sees a value being
+written. Values are reused (rather than reallocated) from one handoff to
+the next.
+*/
+template <typename T>
+class TripleBuffer {
+ public:
+  // Writer: the value to fill in, then publish
+  T& Back() { return buffers_[back_]; }
+
+  // Writer: make Back() the latest value (and get a new Back())
+  void Publish() {
+    back_ = middle_.exchange(back_ | kFresh, std::memory_order_acq_rel) &
+            kIndexMask;
+  }
+
+  // Reader: switch to the latest value; returns false if there's none
+  // newer than Front()
+  bool Update() {
+    if ((middle_.load(std::memory_order_relaxed) & kFresh) == 0) {
+      return false;
+    }
+    front_ = middle_.exchange(front_, std::memory_order_acq_rel) & kIndexMask;
+    return true;
+  }
+
+  // Reader: the latest value as of the last Update()
+  const T& Front() const { return buffers_[front_]; }
+
+ private:
+  static const unsigned kIndexMask{3};
+  static const unsigned kFresh{4};  // The middle buffer hasn't been read
+
+  T buffers_[3];
+  unsigned back_{0};
+  std::atomic<unsigned> middle_{1};
+  unsigned front_{2};
+};
+
+#endif
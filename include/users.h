@@ -1,22 +1,68 @@
 #ifndef USERS_H
 #define USERS_H
 
+#include <sys/types.h>
+
+#include <ctime>
+#include <shared_mutex>
 #include <string>
 #include <unordered_map>
+#include <vector>
+
+#include "data_source.h"
+
+/*
+UID to user name cache. The whole password database file is loaded at
+once into a flat array sorted by UID, and reloaded only when the file is
+replaced or modified (see Revalidate()). UIDs missing from the file are
+either reported as unknown, or, if NSS lookups are enabled (e.g. for users
+coming from LDAP), resolved with getpwuid_r(); both outcomes are cached.
 
+Thread-safe: lookups take a shared lock, so processes may be refreshed
+concurrently.
+*/
 class Users {
  public:
   static std::string LookUpUserName(int uid);
 
+  // Load the password file from 'source', unless it is the one loaded
+  // last and it hasn't changed since
+  static void Revalidate(DataSource& source);
+
+  // Resolve UIDs that aren't in the password file through NSS
+  static void EnableNss(bool enable);
+
  private:
   // Note: we could also delete the copy & move
   // c'tors and assignment op's but the singleton's
   // ref is never exposed, so not strictly needed.
-  Users() {}
+  Users();
+
+  static Users& Instance();
 
  private:
+  // Identifies a version of the password file
+  struct FileStamp {
+    dev_t device{0};
+    ino_t inode{0};
+    timespec mtime{};
+    bool valid{false};
+    const DataSource* source{nullptr};
+
+    bool operator==(const FileStamp& other) const;
+  };
+
   std::string GetNameFromUid(int uid);
-  std::unordered_map<int, std::string> users_map_;
+  std::string GetNameFromNss(int uid);
+  void ReloadIfChanged(DataSource& source);
+  static FileStamp StampPasswordFile(DataSource& source);
+
+  std::vector<int> uids_;           // Sorted
+  std::vector<std::string> names_;  // names_[i] is the name of uids_[i]
+  std::unordered_map<int, std::string> nss_map_;  // "" if not found
+  FileStamp loaded_stamp_;
+  bool use_nss_{false};
+  std::shared_mutex mutex_;  // Guards all of the above
 };
 
 #endif
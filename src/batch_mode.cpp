@@ -0,0 +1,165 @@
+#include "batch_mode.h"
+
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <thread>
+#include <vector>
+
+#include "output_buffer.h"
+#include "process_table.h"
+
+using std::size_t;
+
+namespace {
+const char kCsvHeader[] =
+    "kind,sample,timestamp_ms,cpu_percent,mem_percent,uptime_s,"
+    "procs_running,procs_total,pid,user,ram_mb,command\n";
+
+long long WallClockMs() {
+  using namespace std::chrono;
+  return duration_cast<milliseconds>(system_clock::now().time_since_epoch())
+      .count();
+}
+
+// One "system" line followed by one "process" line per process; columns
+// which don't apply to a line's kind are left empty
+void AppendCsv(OutputBuffer& out, System& system, const std::vector<Row>& rows,
+               unsigned long sample, long long timestamp) {
+  out.Append("system,");
+  out.AppendUnsigned(sample);
+  out.Append(',');
+  out.AppendSigned(timestamp);
+  out.Append(',');
+  out.AppendFixed(100.0 * system.Cpu().Utilization(), 2);
+  out.Append(',');
+  out.AppendFixed(100.0 * system.MemoryInfo().Utilization(), 2);
+  out.Append(',');
+  out.AppendSigned(system.UpTime());
+  out.Append(',');
+  out.AppendSigned(system.RunningProcesses());
+  out.Append(',');
+  out.AppendSigned(system.TotalProcesses());
+  out.Append(",,,,\n");
+
+  const ProcessTable& table = system.Processes();
+  for (Row row : rows) {
+    out.Append("process,");
+    out.AppendUnsigned(sample);
+    out.Append(',');
+    out.AppendSigned(timestamp);
+    out.Append(',');
+    out.AppendFixed(100.0 * table.CpuUtilization(row), 2);
+    out.Append(",,");
+    out.AppendSigned(table.UpTime(row));
+    out.Append(",,,");
+    out.AppendSigned(table.Pid(row));
+    out.Append(',');
+    out.AppendCsvString(table.User(row));
+    out.Append(',');
+    out.AppendSigned(table.Ram(row));
+    out.Append(',');
+    out.AppendCsvString(table.Command(row));
+    out.Append('\n');
+  }
+}
+
+// One JSON object per line (NDJSON)
+void AppendJson(OutputBuffer& out, System& system, const std::vector<Row>& rows,
+                unsigned long sample, long long timestamp) {
+  out.Append("{\"sample\":");
+  out.AppendUnsigned(sample);
+  out.Append(",\"timestamp_ms\":");
+  out.AppendSigned(timestamp);
+  out.Append(",\"cpu_percent\":");
+  out.AppendFixed(100.0 * system.Cpu().Utilization(), 2);
+  out.Append(",\"mem_percent\":");
+  out.AppendFixed(100.0 * system.MemoryInfo().Utilization(), 2);
+  out.Append(",\"uptime_s\":");
+  out.AppendSigned(system.UpTime());
+  out.Append(",\"procs_running\":");
+  out.AppendSigned(system.RunningProcesses());
+  out.Append(",\"procs_total\":");
+  out.AppendSigned(system.TotalProcesses());
+  out.Append(",\"processes\":[");
+
+  const ProcessTable& table = system.Processes();
+  bool first{true};
+  for (Row row : rows) {
+    out.Append(first ? "{\"pid\":" : ",{\"pid\":");
+    first = false;
+    out.AppendSigned(table.Pid(row));
+    out.Append(",\"user\":");
+    out.AppendJsonString(table.User(row));
+    out.Append(",\"cpu_percent\":");
+    out.AppendFixed(100.0 * table.CpuUtilization(row), 2);
+    out.Append(",\"ram_mb\":");
+    out.AppendSigned(table.Ram(row));
+    if (table.Pss(row) >= 0) {
+      out.Append(",\"pss_kb\":");
+      out.AppendSigned(table.Pss(row));
+      out.Append(",\"uss_kb\":");
+      out.AppendSigned(table.Uss(row));
+    }
+    out.Append(",\"uptime_s\":");
+    out.AppendSigned(table.UpTime(row));
+    out.Append(",\"command\":");
+    out.AppendJsonString(table.Command(row));
+    out.Append('}');
+  }
+  out.Append("]}\n");
+}
+}  // namespace
+
+int BatchMode::Run(System& system, const Options& options,
+                   Recorder* recorder) {
+  using Clock = std::chrono::steady_clock;
+  const auto interval = std::chrono::milliseconds(options.intervalMs);
+
+  // A reader which goes away (e.g. "| head") ends the stream with EPIPE
+  // rather than killing us, so that the recording still gets closed
+  std::signal(SIGPIPE, SIG_IGN);
+
+  OutputBuffer out;
+  if (options.format == kCsv_) {
+    out.Append(kCsvHeader, sizeof(kCsvHeader) - 1);
+  }
+
+  // CPU utilization is measured between refreshes, so take a first sample
+  // which is not reported
+  system.Refresh();
+  auto next = Clock::now() + interval;
+
+  for (unsigned long sample = 1;
+       (options.count == 0) || (sample <= options.count); ++sample) {
+    std::this_thread::sleep_until(next);
+    system.Refresh();
+    if ((recorder != nullptr) && !recorder->Record(system)) {
+      return 1;  // The caller reports the error
+    }
+
+    const std::vector<Row>& rows =
+        system.SortedProcesses(system.GetProcessOrder());
+    system.MaterializeProcesses(rows);
+    long long timestamp = WallClockMs();
+    if (options.format == kCsv_) {
+      AppendCsv(out, system, rows, sample, timestamp);
+    } else {
+      AppendJson(out, system, rows, sample, timestamp);
+    }
+    if (!out.Flush(STDOUT_FILENO)) {
+      return (errno == EPIPE) ? 0 : 1;  // The reader went away: done
+    }
+
+    // Keep a fixed cadence; if a refresh overran, skip the missed slots
+    // rather than sampling back-to-back to catch up
+    next += interval;
+    auto now = Clock::now();
+    if (next < now) {
+      next += ((now - next) / interval + 1) * interval;
+    }
+  }
+  return 0;
+}
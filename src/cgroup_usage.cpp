@@ -0,0 +1,66 @@
+#include "cgroup_usage.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstddef>
+
+#include "linux_parser.h"
+
+static const long kClockTicksPerSecond{sysconf(_SC_CLK_TCK)};
+
+// Counters only go backwards if the cgroup was recreated: count from zero
+static unsigned long long Delta(unsigned long long now,
+                                unsigned long long before) {
+  return (now > before) ? (now - before) : now;
+}
+
+CgroupUsage::CgroupUsage(DataSource& source, const Processor& cpu)
+    : source_(source), cpu_(cpu) {}
+
+float CgroupUsage::Utilization() const { return utilization_; }
+
+bool CgroupUsage::Present() const { return present_; }
+
+float CgroupUsage::ThrottledPeriods() const { return throttledPeriods_; }
+
+unsigned long long CgroupUsage::ReadRate() const { return readRate_; }
+
+unsigned long long CgroupUsage::WriteRate() const { return writeRate_; }
+
+const LinuxParser::CgroupSnapshot& CgroupUsage::Snapshot() const {
+  return cgroup_;
+}
+
+void CgroupUsage::Refresh() {
+  bool primed = present_;  // There's a previous reading to compare with
+  prev_ = cgroup_;
+  present_ = LinuxParser::ReadCgroup(source_, cgroup_);
+  utilization_ = 0.0;
+  throttledPeriods_ = 0.0;
+  readRate_ = 0;
+  writeRate_ = 0;
+  unsigned long long jiffies = cpu_.JiffiesDelta();
+  if (!present_ || !primed || (jiffies == 0)) {
+    return;
+  }
+
+  // The system's active time in the window (in microseconds), and the
+  // window's length in seconds (all cores' jiffies go by at once)
+  double activeUsec =
+      (double)cpu_.ActiveJiffiesDelta() * 1e6 / kClockTicksPerSecond;
+  std::size_t cores = std::max<std::size_t>(cpu_.Cores().Size(), 1);
+  double windowSeconds = (double)jiffies / (kClockTicksPerSecond * cores);
+
+  if (activeUsec > 0) {
+    utilization_ = std::min(
+        Delta(cgroup_.usageUsec, prev_.usageUsec) / activeUsec, 1.0);
+  }
+  unsigned long long periods = Delta(cgroup_.nrPeriods, prev_.nrPeriods);
+  if (periods > 0) {
+    throttledPeriods_ =
+        (float)Delta(cgroup_.nrThrottled, prev_.nrThrottled) / periods;
+  }
+  readRate_ = Delta(cgroup_.rbytes, prev_.rbytes) / windowSeconds;
+  writeRate_ = Delta(cgroup_.wbytes, prev_.wbytes) / windowSeconds;
+}
@@ -0,0 +1,87 @@
+#include "cpu_set.h"
+
+#include <algorithm>
+#include <cstddef>
+
+#include "linux_parser.h"
+
+using LinuxParser::CoreTimes;
+using LinuxParser::CPUStates;
+using LinuxParser::kNumCpuStates_;
+using std::size_t;
+
+// States counted as active and idle time, as in CpuTimes::Active() and
+// CpuTimes::Idle() (guest time is already part of user time)
+static const CPUStates kActiveStates[]{
+    LinuxParser::kUser_, LinuxParser::kNice_,    LinuxParser::kSystem_,
+    LinuxParser::kIRQ_,  LinuxParser::kSoftIRQ_, LinuxParser::kSteal_};
+static const CPUStates kIdleStates[]{LinuxParser::kIdle_,
+                                     LinuxParser::kIOwait_};
+
+void CpuSet::Update(const CoreTimes& cores) {
+  const size_t n = cores.Size();
+  Resize(n);
+
+  // Counters can go backwards when a core is hot-(un)plugged, in which
+  // case the delta is 0: the sign bit of the difference masks it, as SSE2
+  // has no 64-bit comparison
+  for (int state = 0; state < kNumCpuStates_; ++state) {
+    const unsigned long long* __restrict__ curr = cores.times[state].data();
+    unsigned long long* __restrict__ prev = prev_[state].data();
+    unsigned long long* __restrict__ delta = deltas_[state].data();
+    for (size_t core = 0; core < n; ++core) {
+      unsigned long long difference = curr[core] - prev[core];
+      delta[core] = difference & ((difference >> 63) - 1);
+      prev[core] = curr[core];
+    }
+  }
+
+  unsigned long long* __restrict__ active = active_.data();
+  unsigned long long* __restrict__ total = total_.data();
+  std::fill(active_.begin(), active_.end(), 0U);
+  for (CPUStates state : kActiveStates) {
+    const unsigned long long* __restrict__ delta = deltas_[state].data();
+    for (size_t core = 0; core < n; ++core) {
+      active[core] += delta[core];
+    }
+  }
+  std::copy(active_.begin(), active_.end(), total_.begin());
+  for (CPUStates state : kIdleStates) {
+    const unsigned long long* __restrict__ delta = deltas_[state].data();
+    for (size_t core = 0; core < n; ++core) {
+      total[core] += delta[core];
+    }
+  }
+
+  // A core without jiffies has no active ones either: 0 / 1
+  float* __restrict__ utilization = utilizations_.data();
+  for (size_t core = 0; core < n; ++core) {
+    utilization[core] =
+        (float)active[core] / std::max((float)total[core], 1.0f);
+  }
+}
+
+size_t CpuSet::Size() const { return utilizations_.size(); }
+
+const AlignedVector<unsigned long long>& CpuSet::Deltas(
+    CPUStates state) const {
+  return deltas_[state];
+}
+
+const AlignedVector<float>& CpuSet::Utilizations() const {
+  return utilizations_;
+}
+
+// Cores which appear start from 0 (their first utilization is since boot)
+void CpuSet::Resize(size_t size) {
+  if (size == Size()) {
+    return;
+  }
+  for (int state = 0; state < kNumCpuStates_; ++state) {
+    prev_[state].resize(size, 0U);
+    deltas_[state].resize(size);
+  }
+  active_.resize(size);
+  total_.resize(size);
+  utilizations_.resize(size);
+}
@@ -0,0 +1,62 @@
+#include "field_cache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+using std::size_t;
+
+void FieldCache::Clear() { rows_.clear(); }
+
+void FieldCache::Put(WINDOW* window, int row, int column, int width,
+                     const char* text, attr_t attributes) {
+  Put(window, row, column, width, text, std::strlen(text), attributes);
+}
+
+void FieldCache::Put(WINDOW* window, int row, int column, int width,
+                     const char* text, size_t length, attr_t attributes) {
+  if ((row < 0) || (column < 0) || (width <= 0)) {
+    return;
+  }
+  // Like curses, stop at a NUL
+  size_t size = width;
+  padded_.assign(text, strnlen(text, std::min(length, size)));
+  padded_.resize(size, ' ');
+
+  // A field drawn with other attributes (or never drawn) is drawn in full
+  Field& field = Find(row, column);
+  size_t first{0};
+  size_t last{size};
+  if ((field.attributes == attributes) && (field.text.size() == size)) {
+    while ((first < size) && (padded_[first] == field.text[first])) {
+      ++first;
+    }
+    if (first == size) {
+      return;  // Unchanged
+    }
+    while (padded_[last - 1] == field.text[last - 1]) {
+      --last;
+    }
+  }
+
+  wattron(window, attributes);
+  mvwaddnstr(window, row, column + first, padded_.data() + first,
+             last - first);
+  wattroff(window, attributes);
+  field.attributes = attributes;
+  field.text.swap(padded_);
+}
+
+FieldCache::Field& FieldCache::Find(int row, int column) {
+  if ((size_t)row >= rows_.size()) {
+    rows_.resize(row + 1);
+  }
+  std::vector<Field>& fields = rows_[row];
+  for (Field& field : fields) {
+    if (field.column == column) {
+      return field;
+    }
+  }
+  fields.push_back(Field{column, A_NORMAL, std::string()});
+  return fields.back();
+}
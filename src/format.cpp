@@ -1,6 +1,7 @@
 #include "format.h"
 
-#include <iomanip>
+#include <algorithm>
+#include <cstdio>
 #include <string>
 
 using std::string;
@@ -8,8 +9,19 @@ using std::string;
 // INPUT: Long int measuring seconds
 // OUTPUT: HH:MM:SS
 string Format::ElapsedTime(long seconds) {
-  if (seconds < 0) {
-    return string();
+  char buffer[32];
+  std::size_t length = ElapsedTime(seconds, buffer, sizeof(buffer));
+  return string(buffer, length);
+}
+
+// As above, but written to 'buffer' (NUL terminated) without allocating.
+// Returns the number of characters written.
+std::size_t Format::ElapsedTime(long seconds, char* buffer, std::size_t size) {
+  if ((seconds < 0) || (size == 0)) {
+    if (size > 0) {
+      buffer[0] = '\0';
+    }
+    return 0;
   }
 
   long hours = seconds / 3600;
@@ -18,11 +30,7 @@ string Format::ElapsedTime(long seconds) {
   long minutes = seconds / 60;
   seconds -= (minutes * 60);
 
-  // If we were using C++20 we could use std::format.
-  // As we're on C++17 let's use stringstream
-  std::stringstream ss;
-  ss << std::setw(2) << std::setfill('0') << std::to_string(hours) << ":";
-  ss << std::setw(2) << std::setfill('0') << std::to_string(minutes) << ":";
-  ss << std::setw(2) << std::setfill('0') << std::to_string(seconds);
-  return ss.str();
+  int length =
+      std::snprintf(buffer, size, "%02ld:%02ld:%02ld", hours, minutes, seconds);
+  return (length < 0) ? 0 : std::min<std::size_t>(length, size - 1);
 }
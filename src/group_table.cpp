@@ -0,0 +1,82 @@
+#include "group_table.h"
+
+#include <string>
+
+using std::size_t;
+using std::string;
+
+GroupTable::Group GroupTable::Intern(const string& name) {
+  auto found = index_.find(name);
+  if (found != index_.end()) {
+    return found->second;
+  }
+
+  Group group;
+  if (!free_.empty()) {
+    group = free_.back();
+    free_.pop_back();
+    names_[group] = name;
+  } else {
+    group = names_.size();
+    names_.push_back(name);
+    processes_.push_back(0);
+    cpu_.push_back(0);
+    ram_.push_back(0);
+  }
+  index_.emplace(name, group);
+  return group;
+}
+
+GroupTable::Group GroupTable::Find(const string& name) const {
+  auto found = index_.find(name);
+  return (found != index_.end()) ? found->second : kNoGroup_;
+}
+
+void GroupTable::Join(Group group, long long cpu, long long ram) {
+  ++processes_[group];
+  cpu_[group] += cpu;
+  ram_[group] += ram;
+}
+
+void GroupTable::Change(Group group, long long cpuDelta, long long ramDelta) {
+  cpu_[group] += cpuDelta;
+  ram_[group] += ramDelta;
+}
+
+void GroupTable::Leave(Group group, long long cpu, long long ram) {
+  cpu_[group] -= cpu;
+  ram_[group] -= ram;
+  if (--processes_[group] > 0) {
+    return;
+  }
+
+  // The slot goes to the next new group
+  index_.erase(names_[group]);
+  names_[group].clear();
+  cpu_[group] = 0;
+  ram_[group] = 0;
+  free_.push_back(group);
+}
+
+void GroupTable::Clear() {
+  names_.clear();
+  processes_.clear();
+  cpu_.clear();
+  ram_.clear();
+  index_.clear();
+  free_.clear();
+}
+
+size_t GroupTable::Size() const { return names_.size(); }
+
+bool GroupTable::IsEmpty(Group group) const {
+  return processes_[group] == 0;
+}
+
+const string& GroupTable::Name(Group group) const { return names_[group]; }
+
+int GroupTable::Processes(Group group) const { return processes_[group]; }
+
+long long GroupTable::Cpu(Group group) const { return cpu_[group]; }
+
+long long GroupTable::Ram(Group group) const { return ram_[group]; }
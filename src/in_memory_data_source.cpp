@@ -0,0 +1,161 @@
+#include "in_memory_data_source.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+using std::size_t;
+using std::string;
+using std::vector;
+
+// Files of a process copied by Capture()
+static const char* const kCapturedPidFiles[] = {
+    "stat", "status", "cmdline", "cgroup", "smaps_rollup"};
+
+bool InMemoryDataSource::Capture(DataSource& source) {
+  vector<int> pids;
+  if (!source.Pids(pids)) {
+    return false;
+  }
+
+  vector<char> buffer;
+  vector<int> tids;
+  char stat[1024];
+  for (int file = 0; file < kNumSystemFiles_; ++file) {
+    files_[file].present = false;
+    if (source.ReadFile((SystemFile)file, buffer)) {
+      SetFile((SystemFile)file, string(buffer.begin(), buffer.end()));
+    }
+  }
+
+  processes_.clear();
+  for (int pid : pids) {
+    ProcessFiles& process = processes_[pid];
+    for (const char* name : kCapturedPidFiles) {
+      if (source.ReadPidFile(pid, name, buffer)) {
+        process.files[name].assign(buffer.begin(), buffer.end());
+      }
+    }
+    if (source.Tids(pid, tids)) {
+      for (int tid : tids) {
+        ssize_t length = source.ReadTaskStat(pid, tid, stat, sizeof(stat));
+        if (length > 0) {
+          process.files["task/" + std::to_string(tid) + "/stat"].assign(
+              stat, length);
+        }
+      }
+    }
+    // Processes which ended while being captured are left out
+    if ((process.files.count("status") == 0) ||
+        (process.files.count("stat") == 0) ||
+        process.files["stat"].empty()) {
+      processes_.erase(pid);
+    }
+  }
+  return true;
+}
+
+void InMemoryDataSource::SetFile(SystemFile file, const string& contents) {
+  files_[file].contents = contents;
+  files_[file].present = true;
+  ++files_[file].version;
+}
+
+void InMemoryDataSource::SetProcessFile(int pid, const string& name,
+                                        const string& contents) {
+  processes_[pid].files[name] = contents;
+}
+
+void InMemoryDataSource::RemoveProcess(int pid) { processes_.erase(pid); }
+
+bool InMemoryDataSource::ReadFile(SystemFile file, vector<char>& buffer) {
+  if (!files_[file].present) {
+    return false;
+  }
+  buffer.assign(files_[file].contents.begin(), files_[file].contents.end());
+  return true;
+}
+
+bool InMemoryDataSource::Stat(SystemFile file, struct stat& st) {
+  if (!files_[file].present) {
+    return false;
+  }
+  std::memset(&st, 0, sizeof(st));
+  st.st_ino = file + 1;
+  st.st_size = files_[file].contents.size();
+  st.st_mtim.tv_sec = files_[file].version;
+  return true;
+}
+
+bool InMemoryDataSource::Pids(vector<int>& pids) {
+  pids.clear();
+  for (const auto& process : processes_) {
+    pids.push_back(process.first);
+  }
+  return true;
+}
+
+// As with procfs, a process which is gone reads as empty
+ssize_t InMemoryDataSource::ReadPidFile(PidFiles& files, PidFile file,
+                                        char* buffer, size_t size,
+                                        long tick) {
+  (void)tick;
+  auto process = processes_.find(files.Pid());
+  if (process == processes_.end()) {
+    return 0;
+  }
+  auto found = process->second.files.find(PidFileName(file));
+  if (found == process->second.files.end()) {
+    return -1;
+  }
+  size_t length = std::min(size, found->second.size());
+  std::memcpy(buffer, found->second.data(), length);
+  return length;
+}
+
+bool InMemoryDataSource::ReadPidFile(int pid, const char* name,
+                                     vector<char>& buffer) {
+  auto process = processes_.find(pid);
+  if (process == processes_.end()) {
+    return false;
+  }
+  auto found = process->second.files.find(name);
+  if (found == process->second.files.end()) {
+    return false;
+  }
+  buffer.assign(found->second.begin(), found->second.end());
+  return true;
+}
+
+// The threads whose "task/<tid>/stat" file was set
+bool InMemoryDataSource::Tids(int pid, vector<int>& tids) {
+  tids.clear();
+  auto process = processes_.find(pid);
+  if (process == processes_.end()) {
+    return false;
+  }
+  for (const auto& file : process->second.files) {
+    int tid;
+    if (std::sscanf(file.first.c_str(), "task/%d/stat", &tid) == 1) {
+      tids.push_back(tid);
+    }
+  }
+  return true;
+}
+
+ssize_t InMemoryDataSource::ReadTaskStat(int pid, int tid, char* buffer,
+                                         size_t size) {
+  auto process = processes_.find(pid);
+  if (process == processes_.end()) {
+    return 0;
+  }
+  char name[32];
+  std::snprintf(name, sizeof(name), "task/%d/stat", tid);
+  auto found = process->second.files.find(name);
+  if (found == process->second.files.end()) {
+    return 0;
+  }
+  size_t length = std::min(size, found->second.size());
+  std::memcpy(buffer, found->second.data(), length);
+  return length;
+}
@@ -1,30 +1,31 @@
 #include "linux_parser.h"
 
+#include <fcntl.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <cassert>
+#include <cctype>
+#include <cerrno>
 #include <cmath>
-#include <experimental/filesystem>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
 #include <string>
 #include <vector>
 
-using dir_it = std::experimental::filesystem::directory_iterator;
-using std::ifstream;
-using std::istringstream;
-using std::stof;
-using std::stoi;
 using std::string;
 using std::to_string;
 using std::vector;
-using std::experimental::filesystem::path;
 
 // DONE: An example of how to read data from the filesystem
-string LinuxParser::OperatingSystem() {
+string LinuxParser::OperatingSystem(DataSource& source) {
   string line;
   string key;
   string value;
-  std::ifstream filestream(kOSPath);
-  if (filestream.is_open()) {
+  vector<char> buffer;
+  if (source.ReadFile(kOsRelease_, buffer)) {
+    std::istringstream filestream(string(buffer.begin(), buffer.end()));
     while (std::getline(filestream, line)) {
       std::replace(line.begin(), line.end(), ' ', '_');
       std::replace(line.begin(), line.end(), '=', ' ');
@@ -42,284 +43,655 @@ string LinuxParser::OperatingSystem() {
 }
 
 // DONE: An example of how to read data from the filesystem
-string LinuxParser::Kernel() {
+string LinuxParser::Kernel(DataSource& source) {
   string os, version, kernel;
-  string line;
-  std::ifstream stream(kProcDirectory + kVersionFilename);
-  if (stream.is_open()) {
-    std::getline(stream, line);
-    std::istringstream linestream(line);
+  vector<char> buffer;
+  if (source.ReadFile(kProcVersion_, buffer)) {
+    std::istringstream linestream(string(buffer.begin(), buffer.end()));
     linestream >> os >> version >> kernel;
   }
   return kernel;
 }
 
-// Get list of PIDs for all active processes
-vector<int> LinuxParser::Pids() {
-  vector<int> pids;
+long LinuxParser::PidMax(DataSource& source) {
+  vector<char> buffer;
+  if (!source.ReadFile(kPidMax_, buffer)) {
+    return 0;
+  }
+  unsigned long long pidMax;
+  ParseUnsigned(buffer.data(), buffer.data() + buffer.size(), pidMax);
+  return pidMax;
+}
 
-  for (auto it = dir_it(kProcDirectory); it != dir_it(); ++it) {
-    if (std::experimental::filesystem::is_directory(it->path())) {
-      string foldername(it->path().stem());
+namespace {
+// Maps a key we care about (e.g. of /proc/meminfo, without the trailing
+// ':') to the corresponding field of a Snapshot
+template <typename Snapshot>
+struct KeyedField {
+  const char* key;
+  std::size_t keyLength;
+  unsigned long long Snapshot::*field;
+};
+
+#define KEYED_FIELD(snapshot, key, member) \
+  { key, sizeof(key) - 1, &LinuxParser::snapshot::member }
+#define MEMINFO_FIELD(key, member) KEYED_FIELD(MeminfoSnapshot, key, member)
+#define CGROUP_FIELD(key, member) KEYED_FIELD(CgroupSnapshot, key, member)
+#define SMAPS_FIELD(key, member) \
+  KEYED_FIELD(SmapsRollupSnapshot, key, member)
+
+const KeyedField<LinuxParser::MeminfoSnapshot> kMeminfoFields[] = {
+    MEMINFO_FIELD("MemTotal", memTotal),
+    MEMINFO_FIELD("MemFree", memFree),
+    MEMINFO_FIELD("MemAvailable", memAvailable),
+    MEMINFO_FIELD("Buffers", buffers),
+    MEMINFO_FIELD("Cached", cached),
+    MEMINFO_FIELD("SwapCached", swapCached),
+    MEMINFO_FIELD("Active", active),
+    MEMINFO_FIELD("Inactive", inactive),
+    MEMINFO_FIELD("SwapTotal", swapTotal),
+    MEMINFO_FIELD("SwapFree", swapFree),
+    MEMINFO_FIELD("Dirty", dirty),
+    MEMINFO_FIELD("Writeback", writeback),
+    MEMINFO_FIELD("AnonPages", anonPages),
+    MEMINFO_FIELD("Mapped", mapped),
+    MEMINFO_FIELD("Shmem", shmem),
+    MEMINFO_FIELD("Slab", slab),
+    MEMINFO_FIELD("SReclaimable", sReclaimable),
+    MEMINFO_FIELD("SUnreclaim", sUnreclaim),
+    MEMINFO_FIELD("PageTables", pageTables),
+    MEMINFO_FIELD("Committed_AS", committedAs),
+};
+
+const KeyedField<LinuxParser::CgroupSnapshot> kCpuStatFields[] = {
+    CGROUP_FIELD("usage_usec", usageUsec),
+    CGROUP_FIELD("user_usec", userUsec),
+    CGROUP_FIELD("system_usec", systemUsec),
+    CGROUP_FIELD("nr_periods", nrPeriods),
+    CGROUP_FIELD("nr_throttled", nrThrottled),
+    CGROUP_FIELD("throttled_usec", throttledUsec),
+};
+
+const KeyedField<LinuxParser::CgroupSnapshot> kMemoryStatFields[] = {
+    CGROUP_FIELD("anon", anon),     CGROUP_FIELD("file", file),
+    CGROUP_FIELD("kernel", kernel), CGROUP_FIELD("shmem", shmem),
+    CGROUP_FIELD("sock", sock),
+};
+
+// Keys of io.stat's "key=value" pairs
+const KeyedField<LinuxParser::CgroupSnapshot> kIoStatFields[] = {
+    CGROUP_FIELD("rbytes", rbytes),
+    CGROUP_FIELD("wbytes", wbytes),
+    CGROUP_FIELD("rios", rios),
+    CGROUP_FIELD("wios", wios),
+};
+
+// The first line, the "[rollup]" pseudo mapping, matches no key
+const KeyedField<LinuxParser::SmapsRollupSnapshot> kSmapsRollupFields[] = {
+    SMAPS_FIELD("Rss", rss),
+    SMAPS_FIELD("Pss", pss),
+    SMAPS_FIELD("Private_Clean", privateClean),
+    SMAPS_FIELD("Private_Dirty", privateDirty),
+    SMAPS_FIELD("Swap", swap),
+};
+
+#undef SMAPS_FIELD
+#undef CGROUP_FIELD
+#undef MEMINFO_FIELD
+#undef KEYED_FIELD
+
+// Parse lines of the form "key<separator> value", setting the fields whose
+// key is listed (the others are left alone)
+template <typename Snapshot, std::size_t N>
+void ParseKeyedLines(const char* buffer, std::size_t length, char separator,
+                     const KeyedField<Snapshot> (&fields)[N],
+                     Snapshot& snapshot) {
+  const char* const end = buffer + length;
+  const char* line = buffer;
+  while (line < end) {
+    const char* eol =
+        static_cast<const char*>(std::memchr(line, '\n', end - line));
+    if (eol == nullptr) {
+      eol = end;
+    }
 
-      if (std::all_of(foldername.begin(), foldername.end(), isdigit)) {
-        int pid = stoi(foldername);
-        pids.push_back(pid);
+    const char* separatorPos =
+        static_cast<const char*>(std::memchr(line, separator, eol - line));
+    if (separatorPos != nullptr) {
+      std::size_t keyLength = separatorPos - line;
+      for (const auto& entry : fields) {
+        if ((entry.keyLength == keyLength) &&
+            (std::memcmp(entry.key, line, keyLength) == 0)) {
+          LinuxParser::ParseUnsigned(separatorPos + 1, eol,
+                                     snapshot.*(entry.field));
+          break;
+        }
       }
     }
+
+    line = eol + 1;
   }
-  return pids;
 }
+}  // namespace
+
+// Read /proc/meminfo once and parse all the fields we're interested in
+bool LinuxParser::ReadMeminfo(DataSource& source, MeminfoSnapshot& snapshot) {
+  // /proc/meminfo is ~1.5 kB on current kernels: the buffer's capacity is
+  // kept, so after the first call reading it doesn't allocate
+  static thread_local std::vector<char> buffer(8192);
+  if (!source.ReadFile(kProcMeminfo_, buffer) || buffer.empty()) {
+    return false;
+  }
 
-// Read and return value for one line of meminfo file
-unsigned long LinuxParser::MemoryUtilizationEntry(string path,
-                                                  string entryName) {
-  string line = LinuxParser::GetRestOfLineAfterToken(path, entryName);
-  std::replace(line.begin(), line.end(), ':', ' ');
-
-  // Extract value from line
-  unsigned long value{0U};
-  istringstream linestream(line);
-  linestream >> value;
-  return value;
+  ParseMeminfo(buffer.data(), buffer.size(), snapshot);
+  return true;
 }
 
-// Read and return system memory utilization information
-float LinuxParser::MemoryUtilization() {
-  string path = kProcDirectory + kMeminfoFilename;
-
-  // Could have read whole file into a dictionary but decided to keep this
-  // simple
-  unsigned long MemTotal = MemoryUtilizationEntry(path, "MemTotal:");
-  unsigned long MemFree = MemoryUtilizationEntry(path, "MemFree:");
-  unsigned long Buffers = MemoryUtilizationEntry(path, "Buffers:");
-  unsigned long Cached = MemoryUtilizationEntry(path, "Cached:");
-  unsigned long SReclaimable = MemoryUtilizationEntry(path, "SReclaimable:");
-  unsigned long Shmem = MemoryUtilizationEntry(path, "Shmem:");
-
-  // Calculation taken from https://stackoverflow.com/a/41251290
-  // Value returned here corresponds to the "(green)" signal
-  unsigned long TotalUsed = MemTotal - MemFree;
-  unsigned long CachedMem = Cached + SReclaimable - Shmem;
-  unsigned long NonCacheNorBufferUsedMem = TotalUsed - (Buffers + CachedMem);
-  return ((float)NonCacheNorBufferUsedMem) / MemTotal;
+// Parse the contents of /proc/meminfo (lines of the form "Key:   value kB")
+void LinuxParser::ParseMeminfo(const char* buffer, std::size_t length,
+                               MeminfoSnapshot& snapshot) {
+  snapshot = MeminfoSnapshot{};
+  ParseKeyedLines(buffer, length, ':', kMeminfoFields, snapshot);
 }
 
 // Read and return the system uptime
-long LinuxParser::UpTime() {
-  ifstream filestream(kProcDirectory + kUptimeFilename);
-  if (filestream.is_open()) {
-    float upTimeValueFloat;
-    if (filestream >> upTimeValueFloat) {
-      return std::roundf(upTimeValueFloat);
+long LinuxParser::UpTime(DataSource& source) {
+  static thread_local std::vector<char> buffer(64);
+  if (source.ReadFile(kProcUptime_, buffer)) {
+    buffer.push_back('\0');
+    char* end;
+    double upTime = std::strtod(buffer.data(), &end);
+    if (end != buffer.data()) {
+      return std::lround(upTime);
     }
   }
 
   return 0;
 }
 
-// Read and return CPU utilization
-vector<unsigned long long> LinuxParser::CpuUtilization() {
-  string path = kProcDirectory + kStatFilename;
-  string cpuLine = GetRestOfLineAfterToken(path, "cpu");
+// NOTE: The idle/non-idle categorisation below is based on this
+// StackOverflow answer: https://stackoverflow.com/a/23376195
+// In particular note the fact that 'guest' and 'guestnice' are
+// said to already be included in 'usertime' and 'usernice',
+// hence we don't add them again here.
+unsigned long long LinuxParser::CpuTimes::Active() const {
+  return times[kUser_] + times[kNice_] + times[kSystem_] + times[kIRQ_] +
+         times[kSoftIRQ_] + times[kSteal_];
+}
 
-  vector<string> raw;
-  string raw_time;
-  istringstream linestream(cpuLine);
-  while (linestream >> raw_time) {
-    raw.push_back(raw_time);
-  }
-  assert(raw.size() == CPUStates::kNumCpuStates_);
+unsigned long long LinuxParser::CpuTimes::Idle() const {
+  return times[kIdle_] + times[kIOwait_];
+}
 
-  // NOTE: The idle/non-idle categorisation below is based on this
-  // StackOverflow answer: https://stackoverflow.com/a/23376195
-  // In particular note the fact that 'guest' and 'guestnice' are
-  // said to already be included in 'usertime' and 'usernice',
-  // hence we've not bothered extracting those values from 'raw'.
+std::size_t LinuxParser::CoreTimes::Size() const { return times[0].size(); }
 
-  unsigned long long user = stoull(raw[CPUStates::kUser_]);
-  unsigned long long nice = stoull(raw[CPUStates::kNice_]);
-  unsigned long long syst = stoull(raw[CPUStates::kSystem_]);
-  unsigned long long idle = stoull(raw[CPUStates::kIdle_]);
-  unsigned long long iowt = stoull(raw[CPUStates::kIOwait_]);
-  unsigned long long nirq = stoull(raw[CPUStates::kIRQ_]);
-  unsigned long long sirq = stoull(raw[CPUStates::kSoftIRQ_]);
-  unsigned long long stel = stoull(raw[CPUStates::kSteal_]);
-  // raw_time_t gest = stoull(raw[kGuest_]);     // normal guest
-  // raw_time_t gstn = stoull(raw[kGuestNice_]); // niced guest
+void LinuxParser::CoreTimes::Resize(std::size_t size) {
+  for (auto& state : times) {
+    state.resize(size);
+  }
+}
 
-  unsigned long long all_actv = user + nice + syst + nirq + sirq + stel;
-  unsigned long long all_idle = idle + iowt;
-  unsigned long long all_time = all_actv + all_idle;
+// Read /proc/stat once and parse the CPU lines and process counters
+bool LinuxParser::ReadStat(DataSource& source, StatSnapshot& snapshot) {
+  // /proc/stat grows with the number of CPUs and interrupt lines, so
+  // keep a (per-thread) buffer around rather than sizing one per call
+  static thread_local std::vector<char> buffer(16384);
+  if (!source.ReadFile(kProcStat_, buffer)) {
+    return false;
+  }
 
-  return {all_time, all_actv, all_idle};
+  ParseStat(buffer.data(), buffer.size(), snapshot);
+  return true;
 }
 
-// Read and return the number of jiffies for the system
-unsigned long long LinuxParser::Jiffies() {
-  return LinuxParser::CpuUtilization()[0];
+// Parse the contents of /proc/stat
+void LinuxParser::ParseStat(const char* buffer, std::size_t length,
+                            StatSnapshot& snapshot) {
+  // Keep the capacity of the per-core buffers between calls
+  std::size_t numCores{0};
+
+  const char* const end = buffer + length;
+  const char* line = buffer;
+  while (line < end) {
+    const char* eol =
+        static_cast<const char*>(std::memchr(line, '\n', end - line));
+    if (eol == nullptr) {
+      eol = end;
+    }
+
+    const char* space =
+        static_cast<const char*>(std::memchr(line, ' ', eol - line));
+    if (space == nullptr) {
+      space = eol;
+    }
+    std::size_t keyLength = space - line;
+    auto keyIs = [line, keyLength](const char* key, std::size_t length) {
+      return (keyLength == length) && (std::memcmp(line, key, length) == 0);
+    };
+
+    unsigned long long value{0};
+    if ((keyLength >= 3) && (std::memcmp(line, "cpu", 3) == 0)) {
+      CpuTimes times;
+      const char* p = space;
+      for (int state = 0; state < kNumCpuStates_; ++state) {
+        p = ParseUnsigned(p, eol, times.times[state]);
+      }
+      if (keyLength == 3) {
+        snapshot.total = times;
+      } else {
+        unsigned long long core;
+        ParseUnsigned(line + 3, space, core);
+        if (core >= numCores) {
+          numCores = core + 1;
+          if (snapshot.cores.Size() < numCores) {
+            snapshot.cores.Resize(numCores);
+          }
+        }
+        for (int state = 0; state < kNumCpuStates_; ++state) {
+          snapshot.cores.times[state][core] = times.times[state];
+        }
+      }
+    } else if (keyIs("ctxt", 4)) {
+      ParseUnsigned(space, eol, snapshot.ctxt);
+    } else if (keyIs("intr", 4)) {
+      // Only the first number (the total) is of interest
+      ParseUnsigned(space, eol, snapshot.intr);
+    } else if (keyIs("processes", 9)) {
+      ParseUnsigned(space, eol, snapshot.forks);
+    } else if (keyIs("procs_running", 13)) {
+      ParseUnsigned(space, eol, value);
+      snapshot.procsRunning = value;
+    } else if (keyIs("procs_blocked", 13)) {
+      ParseUnsigned(space, eol, value);
+      snapshot.procsBlocked = value;
+    }
+
+    line = eol + 1;
+  }
+
+  snapshot.cores.Resize(numCores);
 }
 
-// Read and return the number of active jiffies for the system
-unsigned long long LinuxParser::ActiveJiffies() {
-  return LinuxParser::CpuUtilization()[1];
+// Read /proc/<pid>/stat once (through the process's cached descriptor)
+// and decode all the fields we use. Returns false if the process has ended.
+bool LinuxParser::ReadProcStat(DataSource& source, PidFiles& files,
+                               ProcStatRecord& record, long tick) {
+  // A stat line is a few hundred bytes: even with a 16 char comm and every
+  // numeric field at its widest, 1 kB is plenty
+  char buffer[1024];
+  ssize_t length =
+      source.ReadPidFile(files, kPidStat_, buffer, sizeof(buffer), tick);
+  return (length > 0) && ParseProcStat(buffer, length, record);
 }
 
-// Read and return the number of idle jiffies for the system
-unsigned long long LinuxParser::IdleJiffies() {
-  return LinuxParser::CpuUtilization()[2];
+bool LinuxParser::ReadTaskStat(DataSource& source, int pid, int tid,
+                               ProcStatRecord& record) {
+  char buffer[1024];  // As above
+  ssize_t length = source.ReadTaskStat(pid, tid, buffer, sizeof(buffer));
+  return (length > 0) && ParseProcStat(buffer, length, record);
 }
 
-// Read and return the number of active jiffies for a PID
-unsigned long long LinuxParser::ActiveJiffies(int pid) {
-  string path = kProcDirectory + kSep + to_string(pid) + kSep + kStatFilename;
-  ifstream filestream(path);
+// Parse the contents of /proc/<pid>/stat. The command name (2) is in
+// parentheses and may itself contain spaces and ')', so field offsets are
+// counted from the *last* ')' in the line.
+bool LinuxParser::ParseProcStat(const char* buffer, std::size_t length,
+                                ProcStatRecord& record) {
+  const char* const end = buffer + length;
+  const char* lparen =
+      static_cast<const char*>(std::memchr(buffer, '(', length));
+  const char* rparen = static_cast<const char*>(memrchr(buffer, ')', length));
+  if ((lparen == nullptr) || (rparen == nullptr) || (rparen < lparen)) {
+    return false;
+  }
+
+  unsigned long long value;
+  ParseUnsigned(buffer, lparen, value);
+  record.pid = value;
 
-  if (filestream.is_open()) {
-    unsigned long utime, stime;
+  std::size_t commLength =
+      std::min<std::size_t>(rparen - lparen - 1, sizeof(record.comm) - 1);
+  std::memcpy(record.comm, lparen + 1, commLength);
+  record.comm[commLength] = '\0';
 
-    // See https://man7.org/linux/man-pages/man5/proc.5.html
-    // and https://stackoverflow.com/a/16736599
-    LinuxParser::SkipNTokens(filestream, 13);
-    filestream >> utime;  // 14
-    filestream >> stime;  // 15
-    return utime + stime;
+  // Walk the space separated fields following the command name
+  const char* p = rparen + 1;
+  for (int field = 3; (field <= 24) && (p < end); ++field) {
+    while ((p < end) && (*p == ' ')) {
+      ++p;
+    }
+    if (p == end) {
+      break;  // The field is missing
+    }
+
+    switch (field) {
+      case 3:
+        record.state = *p;
+        break;
+      case 4:
+        ParseUnsigned(p, end, value);
+        record.ppid = value;
+        break;
+      case 14:
+        ParseUnsigned(p, end, record.utime);
+        break;
+      case 15:
+        ParseUnsigned(p, end, record.stime);
+        break;
+      case 20:
+        ParseUnsigned(p, end, value);
+        record.numThreads = value;
+        break;
+      case 22:
+        ParseUnsigned(p, end, record.startTime);
+        break;
+      case 23:
+        ParseUnsigned(p, end, record.vsize);
+        break;
+      case 24:
+        ParseUnsigned(p, end, record.rss);
+        return true;
+      default:
+        break;
+    }
+
+    p = static_cast<const char*>(std::memchr(p, ' ', end - p));
+    if (p == nullptr) {
+      break;
+    }
   }
 
-  return 0;
+  return false;  // Truncated line
 }
 
-int LinuxParser::GetProcessesEntry(std::string entryName) {
-  string path = kProcDirectory + kStatFilename;
-  string line = LinuxParser::GetRestOfLineAfterToken(path, entryName);
+// Read the totals of all the process's mappings into 'snapshot'
+bool LinuxParser::ReadSmapsRollup(DataSource& source, int pid,
+                                  SmapsRollupSnapshot& snapshot) {
+  // ~1 kB: as for meminfo, the buffer's capacity is kept
+  static thread_local vector<char> buffer(4096);
+  if (!source.ReadPidFile(pid, kSmapsRollupName, buffer) || buffer.empty()) {
+    return false;  // Ended, or a kernel thread (which has no mappings)
+  }
+  ParseSmapsRollup(buffer.data(), buffer.size(), snapshot);
+  return true;
+}
 
-  int value{0};
-  istringstream linestream(line);
-  linestream >> value;
-  return value;
+void LinuxParser::ParseSmapsRollup(const char* buffer, std::size_t length,
+                                   SmapsRollupSnapshot& snapshot) {
+  snapshot = SmapsRollupSnapshot{};
+  ParseKeyedLines(buffer, length, ':', kSmapsRollupFields, snapshot);
 }
 
-// Read and return the total number of processes
-int LinuxParser::TotalProcesses() {
-  // NOTE: this is actually the total number of forks since boot,
-  // e.g. see: https://man7.org/linux/man-pages/man5/proc.5.html
-  return GetProcessesEntry("processes");
+// Read and return the command associated with a process (its first line,
+// arguments being separated by NULs)
+string LinuxParser::Command(DataSource& source, int pid) {
+  vector<char> buffer;
+  if (!source.ReadPidFile(pid, kCmdlineName, buffer)) {
+    return string();
+  }
+  auto eol = std::find(buffer.begin(), buffer.end(), '\n');
+  return string(buffer.begin(), eol);
 }
 
-// Read and return the number of running processes
-int LinuxParser::RunningProcesses() {
-  return GetProcessesEntry("procs_running");
+int LinuxParser::Uid(DataSource& source, int pid) {
+  // ~1.5 kB: the buffer's capacity is kept
+  static thread_local vector<char> buffer(4096);
+  if (!source.ReadPidFile(pid, kStatusName, buffer)) {
+    return -1;
+  }
+  return ParseUid(buffer.data(), buffer.size());
+}
+
+// The first of the "Uid:" line's real, effective, saved and filesystem
+// UIDs
+int LinuxParser::ParseUid(const char* buffer, std::size_t length) {
+  static const char kKey[] = "\nUid:";
+  const char* const end = buffer + length;
+  const char* key = std::search(buffer, end, kKey, kKey + sizeof(kKey) - 1);
+  if (key == end) {
+    return -1;
+  }
+  unsigned long long uid;
+  const char* value = key + sizeof(kKey) - 1;
+  const char* last = ParseUnsigned(value, end, uid);
+  if ((last == value) || !std::isdigit((unsigned char)last[-1])) {
+    return -1;
+  }
+  return (int)uid;
 }
 
-// Return path
-string LinuxParser::ProcessFolderPath(int pid) {
-  return kProcDirectory + kSep + to_string(pid) + kSep;
+string LinuxParser::Cgroup(DataSource& source, int pid) {
+  vector<char> buffer;
+  if (!source.ReadPidFile(pid, kCgroupName, buffer)) {
+    return string();
+  }
+  return ParseCgroup(buffer.data(), buffer.size());
 }
 
-// Read and return the command associated with a process
-string LinuxParser::Command(int pid) {
-  string cmd;
-  string path = LinuxParser::ProcessFolderPath(pid) + kSep + kCmdlineFilename;
-  ifstream filestream(path);
-  if (filestream.is_open()) {
-    std::getline(filestream, cmd);
+// Parse cgroup lines, "hierarchy-ID:controller-list:cgroup-path". A v1
+// hierarchy with the CPU controller wins over the unified (v2) one, which
+// on hybrid hosts may have no controllers at all.
+string LinuxParser::ParseCgroup(const char* buffer, std::size_t length) {
+  string unified;
+  const char* const end = buffer + length;
+  const char* line = buffer;
+  while (line < end) {
+    const char* eol =
+        static_cast<const char*>(std::memchr(line, '\n', end - line));
+    if (eol == nullptr) {
+      eol = end;
+    }
+    const char* list =
+        static_cast<const char*>(std::memchr(line, ':', eol - line));
+    const char* path =
+        (list == nullptr) ? nullptr
+                          : static_cast<const char*>(
+                                std::memchr(list + 1, ':', eol - list - 1));
+    if (path != nullptr) {
+      if ((list == line + 1) && (*line == '0') && (path == list + 1)) {
+        unified.assign(path + 1, eol);
+      } else {
+        // Controllers are comma separated, e.g. "cpu,cpuacct"
+        for (const char* controller = list + 1; controller < path;) {
+          const char* comma = static_cast<const char*>(
+              std::memchr(controller, ',', path - controller));
+          if (comma == nullptr) {
+            comma = path;
+          }
+          if ((comma - controller == 3) &&
+              (std::memcmp(controller, "cpu", 3) == 0)) {
+            return string(path + 1, eol);
+          }
+          controller = comma + 1;
+        }
+      }
+    }
+    line = eol + 1;
   }
-  return cmd;
+  return unified;
 }
 
-// Read and return the memory used by a process (in MB)
-string LinuxParser::Ram(int pid) {
-  string path = LinuxParser::ProcessFolderPath(pid) + kStatusFilename;
-  string line = LinuxParser::GetRestOfLineAfterToken(path, "VmSize:");
+// Read the scoped cgroup's files. cpu.stat is always there (on the root
+// too); the memory and io files only if their controllers are enabled.
+bool LinuxParser::ReadCgroup(DataSource& source, CgroupSnapshot& snapshot) {
+  static thread_local std::vector<char> buffer(4096);
+  snapshot = CgroupSnapshot{};
+  if (!source.ReadFile(kCgroupCpuStat_, buffer)) {
+    return false;
+  }
+  ParseCgroupCpuStat(buffer.data(), buffer.size(), snapshot);
 
-  int ramInKb;
-  istringstream linestream(line);
-  if (linestream >> ramInKb) {
-    return to_string((int)std::round(ramInKb / 1000.0));  // KB to MB
+  if (source.ReadFile(kCgroupMemoryCurrent_, buffer)) {
+    snapshot.hasMemory = true;
+    ParseUnsigned(buffer.data(), buffer.data() + buffer.size(),
+                  snapshot.memoryCurrent);
+  }
+  if (source.ReadFile(kCgroupMemoryStat_, buffer)) {
+    ParseCgroupMemoryStat(buffer.data(), buffer.size(), snapshot);
   }
-  return string("0");
+  if (source.ReadFile(kCgroupIoStat_, buffer)) {
+    snapshot.hasIo = true;
+    ParseCgroupIoStat(buffer.data(), buffer.size(), snapshot);
+  }
+  return true;
 }
 
-// Read and return the user ID associated with a process
-int LinuxParser::Uid(int pid) {
-  string path = LinuxParser::ProcessFolderPath(pid) + kStatusFilename;
-  string line = LinuxParser::GetRestOfLineAfterToken(path, "Uid:");
+// Lines of the form "key value"
+void LinuxParser::ParseCgroupCpuStat(const char* buffer, std::size_t length,
+                                     CgroupSnapshot& snapshot) {
+  ParseKeyedLines(buffer, length, ' ', kCpuStatFields, snapshot);
+}
 
-  int uid{-1};
-  istringstream linestream(line);
-  linestream >> uid;
-  return uid;
+// As cpu.stat
+void LinuxParser::ParseCgroupMemoryStat(const char* buffer,
+                                        std::size_t length,
+                                        CgroupSnapshot& snapshot) {
+  ParseKeyedLines(buffer, length, ' ', kMemoryStatFields, snapshot);
 }
 
-// Read and return the start time (after boot) of a process
-long LinuxParser::StartTimeAfterBoot(int pid) {
-  string path = LinuxParser::ProcessFolderPath(pid) + kStatFilename;
-  ifstream filestream(path);
+// One line per device, "major:minor key=value key=value ..."
+void LinuxParser::ParseCgroupIoStat(const char* buffer, std::size_t length,
+                                    CgroupSnapshot& snapshot) {
+  const char* const end = buffer + length;
+  const char* token = buffer;
+  while (token < end) {
+    const char* tokenEnd = token;
+    while ((tokenEnd < end) && (*tokenEnd != ' ') && (*tokenEnd != '\n')) {
+      ++tokenEnd;
+    }
 
-  long startTime{0};
+    // Devices (e.g. "8:0") have no '='
+    const char* equals =
+        static_cast<const char*>(std::memchr(token, '=', tokenEnd - token));
+    if (equals != nullptr) {
+      std::size_t keyLength = equals - token;
+      for (const auto& entry : kIoStatFields) {
+        if ((entry.keyLength == keyLength) &&
+            (std::memcmp(entry.key, token, keyLength) == 0)) {
+          unsigned long long value;
+          ParseUnsigned(equals + 1, tokenEnd, value);
+          snapshot.*(entry.field) += value;
+          break;
+        }
+      }
+    }
 
-  if (filestream.is_open()) {
-    LinuxParser::SkipNTokens(filestream, 21);
-    filestream >> startTime;
-    startTime /= sysconf(_SC_CLK_TCK);
+    token = tokenEnd + 1;
   }
-
-  return startTime;
 }
 
-bool LinuxParser::ProcessHasEnded(int pid) {
-  std::error_code ec;
-  string path{LinuxParser::ProcessFolderPath(pid)};
-  return !std::experimental::filesystem::is_directory(path, ec);
+void LinuxParser::ParseCgroupProcs(const char* buffer, std::size_t length,
+                                   std::vector<int>& pids) {
+  const char* const end = buffer + length;
+  const char* next = buffer;
+  while (next < end) {
+    unsigned long long pid;
+    const char* after = ParseUnsigned(next, end, pid);
+    if (pid > 0) {
+      pids.push_back((int)pid);
+    }
+    next = after + 1;  // Past the newline
+  }
 }
 
-// Get user name from user ID
-std::string LinuxParser::UserFromUid(int uid) {
-  string line;
-  string name, pwd, userId;
+// Read all the entries of the password database file
+bool LinuxParser::ReadPasswd(DataSource& source,
+                             vector<PasswdEntry>& entries) {
+  vector<char> buffer;
+  if (!source.ReadFile(kPasswd_, buffer)) {
+    return false;
+  }
 
-  ifstream filestream(kPasswordPath);
-  if (filestream.is_open()) {
-    while (std::getline(filestream, line)) {
-      // Replace ':' with ' ' to ease parsing below
-      std::replace(line.begin(), line.end(), ':', ' ');
+  ParsePasswd(buffer.data(), buffer.size(), entries);
+  return true;
+}
 
-      istringstream linestream(line);
-      if (linestream >> name >> pwd >> userId) {
-        if (std::stoi(userId) == uid) {
-          return name;
-        }
-      }
+// Parse passwd(5) lines, "name:password:UID:GID:GECOS:directory:shell"
+void LinuxParser::ParsePasswd(const char* buffer, std::size_t length,
+                              vector<PasswdEntry>& entries) {
+  entries.clear();
+
+  const char* const end = buffer + length;
+  const char* line = buffer;
+  while (line < end) {
+    const char* eol =
+        static_cast<const char*>(std::memchr(line, '\n', end - line));
+    if (eol == nullptr) {
+      eol = end;
+    }
+
+    const char* nameEnd =
+        static_cast<const char*>(std::memchr(line, ':', eol - line));
+    const char* passwordEnd =
+        (nameEnd == nullptr)
+            ? nullptr
+            : static_cast<const char*>(
+                  std::memchr(nameEnd + 1, ':', eol - nameEnd - 1));
+    if ((passwordEnd != nullptr) && (nameEnd > line) &&
+        (passwordEnd + 1 < eol) && std::isdigit(passwordEnd[1])) {
+      unsigned long long uid;
+      ParseUnsigned(passwordEnd + 1, eol, uid);
+      entries.push_back({(int)uid, string(line, nameEnd)});
     }
+
+    line = eol + 1;
   }
+}
 
-  return name;  // Not found (empty string)
+// Read a whole file into 'buffer', growing it as needed (its capacity is
+// kept so that repeated reads of the same file don't allocate). On return
+// the buffer's size equals the number of bytes read.
+bool LinuxParser::ReadFileIntoVector(const string& path,
+                                     std::vector<char>& buffer) {
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return false;
+  }
+
+  bool ok = ReadFdIntoVector(fd, buffer);
+  close(fd);
+  return ok;
 }
 
-string LinuxParser::GetRestOfLineAfterToken(const string filepath,
-                                            const std::string token) {
-  string result;
-  ifstream filestream(filepath);
+// As above, reading from an open descriptor (which is left open)
+bool LinuxParser::ReadFdIntoVector(int fd, std::vector<char>& buffer) {
+  buffer.resize(std::max<std::size_t>(buffer.capacity(), 4096));
 
-  if (filestream.is_open()) {
-    string line;
-    while (std::getline(filestream, line)) {
-      string first;
-      istringstream linestream(line);
-      if ((linestream >> first) && (first == token)) {
-        std::getline(linestream, result);
+  std::size_t total{0};
+  while (true) {
+    if (total == buffer.size()) {
+      buffer.resize(2 * buffer.size());
+    }
+    ssize_t n = read(fd, buffer.data() + total, buffer.size() - total);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
       }
+      buffer.clear();
+      return false;
+    }
+    if (n == 0) {
+      break;
     }
+    total += n;
   }
 
-  return result;
+  buffer.resize(total);
+  return true;
 }
 
-void LinuxParser::SkipNTokens(std::ifstream& filestream, const int n) {
-  if (n > 0) {
-    string dummy;
-    for (int ii = 0; ii < n; ++ii) {
-      filestream >> dummy;
-    }
+// Skip any leading blanks and parse an unsigned decimal integer, without
+// allocating. Returns a pointer to the first character after the number
+// ('value' is set to 0 if no digits were found).
+const char* LinuxParser::ParseUnsigned(const char* begin, const char* end,
+                                       unsigned long long& value) {
+  while ((begin < end) && ((*begin == ' ') || (*begin == '\t'))) {
+    ++begin;
+  }
+
+  value = 0;
+  while ((begin < end) && (*begin >= '0') && (*begin <= '9')) {
+    value = (value * 10) + (*begin - '0');
+    ++begin;
   }
+  return begin;
 }
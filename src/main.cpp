@@ -1,7 +1,83 @@
+#include <cstdio>
+
+#include "batch_mode.h"
+#include "linux_parser.h"
 #include "ncurses_display.h"
+#include "options.h"
+#include "procfs_data_source.h"
+#include "profiler.h"
+#include "recorder.h"
+#include "replayer.h"
 #include "system.h"
+#include "users.h"
+
+int main(int argc, char* argv[]) {
+  Options options;
+  if (!Options::Parse(argc, argv, options)) {
+    Options::PrintUsage(argv[0]);
+    return 1;
+  }
+
+  if (!options.replay.empty()) {
+    Replayer replayer;
+    if (!replayer.Open(options.replay)) {
+      std::fprintf(stderr, "%s\n", replayer.Error().c_str());
+      return 1;
+    }
+    if (!NCursesDisplay::Replay(replayer)) {
+      std::perror(argv[0]);
+      return 1;
+    }
+    return 0;
+  }
+
+  ProcfsDataSource source(options.root, options.cgroup);
+  if (!source.IsOpen()) {
+    std::perror(options.cgroup.empty()
+                    ? (options.root + LinuxParser::kProcDirectory).c_str()
+                    : source.CgroupDirectory().c_str());
+    return 1;
+  }
+
+  Recorder recorder;
+  Recorder* recording{nullptr};
+  if (!options.record.empty()) {
+    if (!recorder.Open(options.record)) {
+      std::perror(options.record.c_str());
+      return 1;
+    }
+    recording = &recorder;
+  }
+
+  Users::EnableNss(options.nss);
+  Profiler::Enable(options.profile);
+  System system(source, options.threads);
+  system.SetCgroupName(options.cgroup);
+  // Batch mode writes out every process, so all are kept up to date
+  system.EnableTiers(options.tiers && !options.batch);
+  system.SetSyscallBudget(options.budget);
+  system.SetThreadScope(options.threadScope);
+  system.SetSmapsBudget(options.smapsMs);
+  int status{0};
+  if (options.batch) {
+    status = BatchMode::Run(system, options, recording);
+  } else {
+    if (!NCursesDisplay::Display(system, 10, recording)) {
+      std::perror(argv[0]);
+      status = 1;
+    }
+  }
+
+  // Also when profiling was started from the UI
+  if (Profiler::Enabled()) {
+    Profiler::Dump(stderr);
+    std::fprintf(stderr, "lazy reads avoided: %llu\n",
+                 system.LazyReadsAvoided());
+  }
 
-int main() {
-  System system;
-  NCursesDisplay::Display(system);
-}
\ No newline at end of file
+  if ((recording != nullptr) && !recorder.Close()) {
+    std::perror(options.record.c_str());
+    status = 1;
+  }
+  return status;
+}
@@ -2,14 +2,42 @@
 
 #include "linux_parser.h"
 
+Memory::Memory(DataSource& source) : source_(source) {}
+
 float Memory::Utilization() const { return utilization_; }
 
+float Memory::SwapUtilization() const { return swap_utilization_; }
+
+const LinuxParser::MeminfoSnapshot& Memory::Snapshot() const {
+  return meminfo_;
+}
+
 void Memory::Refresh() {
-  float newUtilization = LinuxParser::MemoryUtilization();
+  if (!LinuxParser::ReadMeminfo(source_, meminfo_)) {
+    utilization_ = 0.0;
+    swap_utilization_ = 0.0;
+    return;
+  }
+
+  // Calculation taken from https://stackoverflow.com/a/41251290
+  // Value computed here corresponds to the "(green)" signal
+  const auto& m = meminfo_;
+  float newUtilization{0.0};
+  if (m.memTotal > 0U) {
+    long long totalUsed = m.memTotal - m.memFree;
+    long long cachedMem = m.cached + m.sReclaimable - m.shmem;
+    long long nonCacheNorBufferUsedMem = totalUsed - (m.buffers + cachedMem);
+    newUtilization = ((float)nonCacheNorBufferUsedMem) / m.memTotal;
+  }
 
   if ((newUtilization >= 0.0) && (newUtilization <= 1.0)) {
     utilization_ = newUtilization;
   } else {
     utilization_ = 0.0;
   }
+
+  swap_utilization_ =
+      (m.swapTotal == 0U)
+          ? 0.0
+          : ((float)(m.swapTotal - m.swapFree)) / m.swapTotal;
 }
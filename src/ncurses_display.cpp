@@ -1,13 +1,26 @@
 #include "ncurses_display.h"
 
 #include <curses.h>
+#include <poll.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
 
-#include <chrono>
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <numeric>
 #include <string>
-#include <thread>
 #include <vector>
 
+#include "field_cache.h"
 #include "format.h"
+#include "profiler.h"
+#include "recorder.h"
+#include "replayer.h"
+#include "row_order.h"
+#include "sample.h"
+#include "sampler.h"
 #include "system.h"
 
 using std::string;
@@ -16,154 +29,925 @@ using std::to_string;
 // 50 bars uniformly displayed from 0 - 100 %
 // 2% is one bar(|)
 std::string NCursesDisplay::ProgressBar(float percent) {
-  std::string result{"0%"};
-  int size{50};
-  float bars{percent * size};
+  char buffer[kProgressBarSize];
+  return string(buffer, ProgressBar(percent, buffer, sizeof(buffer)));
+}
+
+// As above, but written to 'buffer' (NUL terminated) without allocating.
+// Returns the number of characters written.
+size_t NCursesDisplay::ProgressBar(float percent, char* buffer,
+                                   size_t size) {
+  const int bars_size{50};
+  char bars[bars_size + 1];
+  float bars_count{percent * bars_size};
+  for (int i{0}; i < bars_size; ++i) {
+    bars[i] = i <= bars_count ? '|' : ' ';
+  }
+  bars[bars_size] = '\0';
 
-  for (int i{0}; i < size; ++i) {
-    result += i <= bars ? '|' : ' ';
+  // The percentage, e.g. "12.3" or " 5.2" (" 100" when full)
+  char number[32];
+  std::snprintf(number, sizeof(number), "%f", percent * 100);
+  int digits = 4;
+  const char* space = "";
+  if (percent < 0.1 || percent == 1.0) {
+    digits = 3;
+    space = " ";
   }
+  int length = std::snprintf(buffer, size, "0%%%s %s%.*s/100%%", bars, space,
+                             digits, number);
+  return (length < 0) ? 0 : std::min<size_t>(length, size - 1);
+}
+
+// Format a kB quantity as a number of MB (rounded)
+static unsigned long long KbToMb(unsigned long long kb) {
+  return (kb + 512) / 1024;
+}
+
+// Number of cores per row of the heatmap, in whole groups
+static size_t HeatmapCoresPerRow(int width) {
+  const int group_width{NCursesDisplay::kHeatmapGroup + 1};  // With a space
+  int groups = std::max((width + 1) / group_width, 1);
+  return groups * NCursesDisplay::kHeatmapGroup;
+}
+
+// The heatmap takes the system window's width, but for the labels
+int NCursesDisplay::HeatmapRows(size_t numCores, int width) {
+  size_t perRow = HeatmapCoresPerRow(width - kValueColumn - 1);
+  return std::max<int>((numCores + perRow - 1) / perRow, 1);
+}
 
-  string display{to_string(percent * 100).substr(0, 4)};
-  if (percent < 0.1 || percent == 1.0)
-    display = " " + to_string(percent * 100).substr(0, 3);
-  return result + " " + display + "/100%";
+// One cell per core, in groups of kHeatmapGroup cores: its glyph (and
+// color) goes from '_' (idle) to '@' (busy) in steps of 10%
+static void DisplayHeatmap(const std::vector<float>& cores, WINDOW* window,
+                           int first_row, int rows, FieldCache& fields) {
+  const char kGlyphs[]{"_.:-=+*#%@"};
+  const int levels{sizeof(kGlyphs) - 1};
+  const int column{NCursesDisplay::kValueColumn};
+  const size_t perRow = HeatmapCoresPerRow(getmaxx(window) - column - 1);
+  for (size_t cell = 0; cell < rows * perRow; ++cell) {
+    int row = first_row + cell / perRow;
+    size_t index = cell % perRow;
+    int x = column + index + index / NCursesDisplay::kHeatmapGroup;
+    if (cell >= cores.size()) {
+      fields.Put(window, row, x, 1, "");
+      continue;
+    }
+    float utilization = std::min(std::max(cores[cell], 0.0f), 1.0f);
+    int level = std::min((int)(utilization * levels), levels - 1);
+    int pair = (utilization < 0.5) ? 2 : (utilization < 0.8) ? 3 : 4;
+    fields.Put(window, row, x, 1, &kGlyphs[level], 1,
+               (attr_t)COLOR_PAIR(pair));
+  }
 }
 
-void NCursesDisplay::DisplaySystem(System& system, WINDOW* window) {
+void NCursesDisplay::DisplaySystem(const Sample& sample, WINDOW* window,
+                                   FieldCache& fields) {
+  const int label_column{2};
+  const int value_column{kValueColumn};
+  const attr_t value_attributes{(attr_t)COLOR_PAIR(1)};
+  // Everything fits inside the border
+  const int width{getmaxx(window) - label_column - 1};
+  const int value_width{width - (value_column - label_column)};
+  char text[512];
+  size_t length;
   int row{0};
-  mvwprintw(window, ++row, 2, ("OS: " + system.OperatingSystem()).c_str());
-  mvwprintw(window, ++row, 2, ("Kernel: " + system.Kernel()).c_str());
-  mvwprintw(window, ++row, 2, "CPU: ");
-  wattron(window, COLOR_PAIR(1));
-  mvwprintw(window, row, 10, "");
-  wprintw(window, ProgressBar(system.Cpu().Utilization()).c_str());
-  wattroff(window, COLOR_PAIR(1));
-  mvwprintw(window, ++row, 2, "Memory: ");
-  wattron(window, COLOR_PAIR(1));
-  mvwprintw(window, row, 10, "");
-  wprintw(window, ProgressBar(system.MemoryInfo().Utilization()).c_str());
-  wattroff(window, COLOR_PAIR(1));
-  mvwprintw(window, ++row, 2,
-            ("Total Processes: " + to_string(system.TotalProcesses())).c_str());
-  mvwprintw(
-      window, ++row, 2,
-      ("Running Processes: " + to_string(system.RunningProcesses())).c_str());
-  mvwprintw(window, ++row, 2,
-            ("Up Time: " + Format::ElapsedTime(system.UpTime())).c_str());
-  wrefresh(window);
-}
-
-void NCursesDisplay::DisplayProcesses(std::vector<Process>& processes,
-                                      WINDOW* window, size_t n) {
+
+  std::snprintf(text, sizeof(text), "OS: %s", sample.os.c_str());
+  fields.Put(window, ++row, label_column, width, text);
+  std::snprintf(text, sizeof(text), "Kernel: %s", sample.kernel.c_str());
+  fields.Put(window, ++row, label_column, width, text);
+
+  fields.Put(window, ++row, label_column, value_column - label_column, "CPU: ");
+  length = ProgressBar(sample.cpuUtilization, text, sizeof(text));
+  fields.Put(window, row, value_column, value_width, text, length,
+             value_attributes);
+
+  // As many rows as the cores need (see Layout())
+  fields.Put(window, ++row, label_column, value_column - label_column,
+             "Cores: ");
+  int heatmap_rows = HeatmapRows(sample.coreUtilizations.size(),
+                                 getmaxx(window));
+  DisplayHeatmap(sample.coreUtilizations, window, row, heatmap_rows, fields);
+  row += heatmap_rows - 1;
+
+  fields.Put(window, ++row, label_column, value_column - label_column,
+             "Memory: ");
+  length = ProgressBar(sample.memoryUtilization, text, sizeof(text));
+  fields.Put(window, row, value_column, value_width, text, length,
+             value_attributes);
+
+  fields.Put(window, ++row, label_column, value_column - label_column,
+             "Swap: ");
+  length = ProgressBar(sample.swapUtilization, text, sizeof(text));
+  fields.Put(window, row, value_column, value_width, text, length,
+             value_attributes);
+
+  std::snprintf(text, sizeof(text),
+                "Avail: %llu MB  Cached: %llu MB  Dirty: %llu MB  Slab: %llu "
+                "MB",
+                KbToMb(sample.memAvailable), KbToMb(sample.cached),
+                KbToMb(sample.dirty), KbToMb(sample.slab));
+  fields.Put(window, ++row, label_column, width, text);
+  if (sample.cgroup.present) {
+    DisplayCgroup(sample.cgroup, window, ++row, fields);
+  }
+  if (sample.readsAvoided > 0) {
+    std::snprintf(text, sizeof(text),
+                  "Total Processes: %d (lazy reads avoided: %llu)",
+                  sample.totalProcesses, sample.readsAvoided);
+  } else {
+    std::snprintf(text, sizeof(text), "Total Processes: %d",
+                  sample.totalProcesses);
+  }
+  fields.Put(window, ++row, label_column, width, text);
+  std::snprintf(text, sizeof(text), "Running Processes: %d (blocked: %d)",
+                sample.runningProcesses, sample.blockedProcesses);
+  fields.Put(window, ++row, label_column, width, text);
+
+  length = std::snprintf(text, sizeof(text), "Up Time: ");
+  Format::ElapsedTime(sample.upTime, text + length, sizeof(text) - length);
+  fields.Put(window, ++row, label_column, width, text);
+}
+
+// The scoped cgroup's totals, on one row (see Layout())
+void NCursesDisplay::DisplayCgroup(const CgroupSample& cgroup, WINDOW* window,
+                                   int row, FieldCache& fields) {
+  const int label_column{2};
+  const int width{getmaxx(window) - label_column - 1};
+  char text[512];
+  int length = std::snprintf(text, sizeof(text), "Cgroup %s: CPU %.1f%%",
+                             cgroup.name.c_str(), cgroup.cpuUtilization * 100);
+  if (cgroup.throttledPeriods > 0) {
+    length += std::snprintf(text + length, sizeof(text) - length,
+                            " (throttled %.0f%%)",
+                            cgroup.throttledPeriods * 100);
+  }
+  if (cgroup.hasMemory) {
+    length += std::snprintf(
+        text + length, sizeof(text) - length,
+        "  RAM %llu MB (anon %llu, file %llu)", KbToMb(cgroup.memory),
+        KbToMb(cgroup.anon), KbToMb(cgroup.file));
+  }
+  if (cgroup.hasIo) {
+    length += std::snprintf(text + length, sizeof(text) - length,
+                            "  IO r/w %llu/%llu kB/s", cgroup.readRate,
+                            cgroup.writeRate);
+  }
+  fields.Put(window, row, label_column, width, text,
+             std::min<size_t>(length, sizeof(text) - 1));
+}
+
+// Processes fill the window's rows (up to 'n'); rows without a process are
+// blanked. PSS and USS get columns of their own while they're read.
+void NCursesDisplay::DisplayProcesses(const Sample& sample, WINDOW* window,
+                                      FieldCache& fields) {
   int row{0};
   int const pid_column{2};
   int const user_column{9};
   int const cpu_column{18};
   int const ram_column{27};
-  int const time_column{36};
+  int const pss_column{36};
+  int const uss_column{45};
+  int const time_column{sample.smaps ? 54 : 36};
+  int const command_column{time_column + 11};
+  int const command_width{getmaxx(window) - command_column - 1};
+  const attr_t header_attributes{(attr_t)COLOR_PAIR(2)};
+  fields.Put(window, ++row, pid_column, user_column - pid_column, "PID",
+             header_attributes);
+  fields.Put(window, row, user_column, cpu_column - user_column, "USER",
+             header_attributes);
+  fields.Put(window, row, cpu_column, ram_column - cpu_column, "CPU[%]",
+             header_attributes);
+  fields.Put(window, row, ram_column, pss_column - ram_column, "RAM[MB]",
+             header_attributes);
+  if (sample.smaps) {
+    fields.Put(window, row, pss_column, uss_column - pss_column, "PSS[MB]",
+               header_attributes);
+    fields.Put(window, row, uss_column, time_column - uss_column, "USS[MB]",
+               header_attributes);
+  }
+  fields.Put(window, row, time_column, command_column - time_column, "TIME+",
+             header_attributes);
+  fields.Put(window, row, command_column, command_width, "COMMAND",
+             header_attributes);
+
+  char text[64];
+  size_t length;
+  const int last_row{getmaxy(window) - 2};
+  for (size_t i = 0; (i < sample.processes.size()) && (row < last_row); ++i) {
+    const ProcessSample& process = sample.processes[i];
+    length = std::snprintf(text, sizeof(text), "%d", process.pid);
+    fields.Put(window, ++row, pid_column, user_column - pid_column, text,
+               length);
+    fields.Put(window, row, user_column, 8, process.user.data(),
+               process.user.size());
+    // As many characters as fit in 4, e.g. "12.3" or "0.00"
+    length = std::snprintf(text, sizeof(text), "%f",
+                           process.cpuUtilization * 100);
+    fields.Put(window, row, cpu_column, ram_column - cpu_column, text,
+               std::min<size_t>(length, 4));
+    length = std::snprintf(text, sizeof(text), "%d", process.ram);
+    fields.Put(window, row, ram_column, pss_column - ram_column, text,
+               length);
+    if (sample.smaps) {
+      // "-" until read
+      length = (process.pss < 0)
+                   ? std::snprintf(text, sizeof(text), "-")
+                   : std::snprintf(text, sizeof(text), "%d", process.pss);
+      fields.Put(window, row, pss_column, uss_column - pss_column, text,
+                 length);
+      length = (process.uss < 0)
+                   ? std::snprintf(text, sizeof(text), "-")
+                   : std::snprintf(text, sizeof(text), "%d", process.uss);
+      fields.Put(window, row, uss_column, time_column - uss_column, text,
+                 length);
+    }
+    length = Format::ElapsedTime(process.upTime, text, sizeof(text));
+    fields.Put(window, row, time_column, command_column - time_column, text,
+               length);
+    fields.Put(window, row, command_column, command_width,
+               process.command.data(), process.command.size());
+  }
+  while (row < last_row) {
+    fields.Put(window, ++row, pid_column, user_column - pid_column, "");
+    fields.Put(window, row, user_column, 8, "");
+    fields.Put(window, row, cpu_column, ram_column - cpu_column, "");
+    fields.Put(window, row, ram_column, pss_column - ram_column, "");
+    if (sample.smaps) {
+      fields.Put(window, row, pss_column, uss_column - pss_column, "");
+      fields.Put(window, row, uss_column, time_column - uss_column, "");
+    }
+    fields.Put(window, row, time_column, command_column - time_column, "");
+    fields.Put(window, row, command_column, command_width, "");
+  }
+}
+
+// As DisplayProcesses(), for groups: their number of processes and their
+// CPU and RAM totals
+void NCursesDisplay::DisplayGroups(const Sample& sample, WINDOW* window,
+                                   FieldCache& fields, size_t cursor) {
+  int row{0};
+  int const size_column{2};
+  int const cpu_column{10};
+  int const ram_column{19};
+  int const name_column{30};
+  int const name_width{getmaxx(window) - name_column - 1};
+  const attr_t header_attributes{(attr_t)COLOR_PAIR(2)};
+  fields.Put(window, ++row, size_column, cpu_column - size_column, "PROCS",
+             header_attributes);
+  fields.Put(window, row, cpu_column, ram_column - cpu_column, "CPU[%]",
+             header_attributes);
+  fields.Put(window, row, ram_column, name_column - ram_column, "RAM[MB]",
+             header_attributes);
+  fields.Put(window, row, name_column, name_width,
+             (sample.grouping == kByUser_) ? "USER" : "CGROUP",
+             header_attributes);
+
+  char text[64];
+  size_t length;
+  const int last_row{getmaxy(window) - 2};
+  for (size_t i = 0; (i < sample.groups.size()) && (row < last_row); ++i) {
+    const GroupSample& group = sample.groups[i];
+    attr_t attributes = (i == cursor) ? A_REVERSE : A_NORMAL;
+    length = std::snprintf(text, sizeof(text), "%d", group.processes);
+    fields.Put(window, ++row, size_column, cpu_column - size_column, text,
+               length, attributes);
+    // A share of the system's active CPU time, so the groups add up to
+    // 100% at most: no wider than "100.0"
+    length = std::snprintf(text, sizeof(text), "%.1f",
+                           group.cpuUtilization * 100);
+    fields.Put(window, row, cpu_column, ram_column - cpu_column, text,
+               length, attributes);
+    length = std::snprintf(text, sizeof(text), "%lld", group.ram);
+    fields.Put(window, row, ram_column, name_column - ram_column, text,
+               length, attributes);
+    fields.Put(window, row, name_column, name_width, group.name.data(),
+               group.name.size(), attributes);
+  }
+  while (row < last_row) {
+    fields.Put(window, ++row, size_column, cpu_column - size_column, "");
+    fields.Put(window, row, cpu_column, ram_column - cpu_column, "");
+    fields.Put(window, row, ram_column, name_column - ram_column, "");
+    fields.Put(window, row, name_column, name_width, "");
+  }
+}
+
+// As DisplayProcesses(), for threads: their CPU utilization, state and
+// name, next to their process's. Threads not read this tick are dimmed.
+void NCursesDisplay::DisplayThreads(const Sample& sample, WINDOW* window,
+                                    FieldCache& fields) {
+  int row{0};
+  int const tid_column{2};
+  int const pid_column{10};
+  int const cpu_column{18};
+  int const state_column{27};
+  int const name_column{30};
   int const command_column{47};
-  wattron(window, COLOR_PAIR(2));
-  mvwprintw(window, ++row, pid_column, "PID");
-  mvwprintw(window, row, user_column, "USER");
-  mvwprintw(window, row, cpu_column, "CPU[%%]");
-  mvwprintw(window, row, ram_column, "RAM[MB]");
-  mvwprintw(window, row, time_column, "TIME+");
-  mvwprintw(window, row, command_column, "COMMAND");
-  wattroff(window, COLOR_PAIR(2));
-  for (size_t i = 0; i < n; ++i) {
-    mvwprintw(window, ++row, pid_column, to_string(processes[i].Pid()).c_str());
-    mvwprintw(window, row, user_column,
-              processes[i].User().substr(0, 8).c_str());
-    float cpu = processes[i].CpuUtilization() * 100;
-    mvwprintw(window, row, cpu_column, to_string(cpu).substr(0, 4).c_str());
-    mvwprintw(window, row, ram_column, processes[i].Ram().c_str());
-    mvwprintw(window, row, time_column,
-              Format::ElapsedTime(processes[i].UpTime()).c_str());
-    mvwprintw(window, row, command_column,
-              processes[i].Command().substr(0, window->_maxx - 46).c_str());
+  int const command_width{getmaxx(window) - command_column - 1};
+  const attr_t header_attributes{(attr_t)COLOR_PAIR(2)};
+  fields.Put(window, ++row, tid_column, pid_column - tid_column, "TID",
+             header_attributes);
+  fields.Put(window, row, pid_column, cpu_column - pid_column, "PID",
+             header_attributes);
+  fields.Put(window, row, cpu_column, state_column - cpu_column, "CPU[%]",
+             header_attributes);
+  fields.Put(window, row, state_column, name_column - state_column, "S",
+             header_attributes);
+  fields.Put(window, row, name_column, command_column - name_column,
+             "THREAD", header_attributes);
+  fields.Put(window, row, command_column, command_width, "COMMAND",
+             header_attributes);
+
+  char text[64];
+  size_t length;
+  const int last_row{getmaxy(window) - 2};
+  for (size_t i = 0; (i < sample.threads.size()) && (row < last_row); ++i) {
+    const ThreadSample& thread = sample.threads[i];
+    const ProcessSample& process = sample.processes[thread.process];
+    attr_t attributes = thread.stale ? A_DIM : A_NORMAL;
+    length = std::snprintf(text, sizeof(text), "%d", thread.tid);
+    fields.Put(window, ++row, tid_column, pid_column - tid_column, text,
+               length, attributes);
+    length = std::snprintf(text, sizeof(text), "%d", process.pid);
+    fields.Put(window, row, pid_column, cpu_column - pid_column, text,
+               length, attributes);
+    // As many characters as fit in 4, as for processes
+    length = std::snprintf(text, sizeof(text), "%f",
+                           thread.cpuUtilization * 100);
+    fields.Put(window, row, cpu_column, state_column - cpu_column, text,
+               std::min<size_t>(length, 4), attributes);
+    fields.Put(window, row, state_column, name_column - state_column,
+               &thread.state, 1, attributes);
+    fields.Put(window, row, name_column, command_column - name_column,
+               thread.name.data(), thread.name.size(), attributes);
+    fields.Put(window, row, command_column, command_width,
+               process.command.data(), process.command.size(), attributes);
+  }
+  while (row < last_row) {
+    fields.Put(window, ++row, tid_column, pid_column - tid_column, "");
+    fields.Put(window, row, pid_column, cpu_column - pid_column, "");
+    fields.Put(window, row, cpu_column, state_column - cpu_column, "");
+    fields.Put(window, row, state_column, name_column - state_column, "");
+    fields.Put(window, row, name_column, command_column - name_column, "");
+    fields.Put(window, row, command_column, command_width, "");
+  }
+}
+
+void NCursesDisplay::DisplayProfile(WINDOW* window) {
+  werase(window);
+  box(window, 0, 0);
+  mvwprintw(window, 0, 2, " Profile (p: close) ");
+  int row{0};
+  if (!Profiler::kBuiltIn) {
+    mvwprintw(window, ++row, 2, "Built without MONITOR_PROFILING");
+  } else {
+    wattron(window, COLOR_PAIR(2));
+    mvwprintw(window, ++row, 2, "%s", Profiler::Header().c_str());
+    wattroff(window, COLOR_PAIR(2));
+    Profiler::PhaseStats stats;
+    for (int phase = 0; phase < kNumProfilePhases_; ++phase) {
+      Profiler::Snapshot((ProfilePhase)phase, stats);
+      mvwprintw(window, ++row, 2, "%s",
+                Profiler::FormatPhase((ProfilePhase)phase, stats).c_str());
+    }
+  }
+  wnoutrefresh(window);
+}
+
+// Create the profile overlay, in the bottom right corner
+static WINDOW* NewProfileWindow() {
+  int height = kNumProfilePhases_ + 3;
+  int width = Profiler::Header().size() + 4;
+  return newwin(height, width, std::max(getmaxy(stdscr) - height, 0),
+                std::max(getmaxx(stdscr) - width - 1, 0));
+}
+
+// (Re)create the windows to fit the terminal, 'numCores' and the 'cgroup'
+// row (if any): the system window at the top, and the process window
+// below, down to the bottom of the terminal
+static void Layout(NCursesDisplay::Screen& screen, size_t numCores,
+                   bool cgroup) {
+  bool profile = (screen.profile != nullptr);
+  for (WINDOW* window : {screen.system, screen.processes, screen.profile}) {
+    if (window != nullptr) {
+      delwin(window);
+    }
   }
+
+  screen.lines = getmaxy(stdscr);
+  screen.columns = getmaxx(stdscr);
+  erase();
+  wnoutrefresh(stdscr);
+
+  int width = std::max(screen.columns - 1, 2);
+  screen.heatmapRows = NCursesDisplay::HeatmapRows(numCores, width);
+  screen.cgroup = cgroup;
+  int height = NCursesDisplay::kSystemWindowHeight + screen.heatmapRows - 1 +
+               (cgroup ? 1 : 0);
+  screen.system = newwin(height, width, 0, 0);
+  screen.processes =
+      newwin(std::max(screen.lines - height, 3), width, height, 0);
+  screen.profile = profile ? NewProfileWindow() : nullptr;
+  box(screen.system, 0, 0);
+  box(screen.processes, 0, 0);
+  screen.systemFields.Clear();
+  screen.processFields.Clear();
+  screen.grouping = kNumGroupings_;
+  screen.threads = false;
+  screen.smaps = false;
+  screen.title.clear();
 }
 
-void NCursesDisplay::Display(System& system, size_t n) {
+// Start ncurses; windows are created by the first Draw()
+static void Start(NCursesDisplay::Screen& screen) {
   initscr();              // start ncurses
   noecho();               // do not print input values
   keypad(stdscr, TRUE);   // enable keys (getch())
   nodelay(stdscr, TRUE);  // getch() becomes non-blocking
   cbreak();               // terminate ncurses on ctrl + c
   start_color();          // enable color
+  init_pair(1, COLOR_BLUE, COLOR_BLACK);
+  init_pair(2, COLOR_GREEN, COLOR_BLACK);
+  init_pair(3, COLOR_YELLOW, COLOR_BLACK);
+  init_pair(4, COLOR_RED, COLOR_BLACK);
+  screen.lines = 0;
+}
 
-  int x_max{getmaxx(stdscr)};
-  WINDOW* system_window = newwin(9, x_max - 1, 0, 0);
-  WINDOW* process_window;
-
-  bool quit = false;
-  size_t previous_n = n;
-
-  while (!quit) {
-    system.Refresh();
-    size_t num_processes = system.Processes().size();
-    size_t processes_lines = std::min(num_processes, n);
-
-    process_window =
-        newwin(3 + processes_lines, x_max - 1, system_window->_maxy + 1, 0);
-
-    init_pair(1, COLOR_BLUE, COLOR_BLACK);
-    init_pair(2, COLOR_GREEN, COLOR_BLACK);
-    box(system_window, 0, 0);
-    box(process_window, 0, 0);
-    DisplaySystem(system, system_window);
-    DisplayProcesses(system.Processes(), process_window, processes_lines);
-    wrefresh(system_window);
-    wrefresh(process_window);
-
-    // Clear lines below process window, when 'n' decreases
-    if (previous_n > processes_lines) {
-      for (size_t offset = n; offset < previous_n; ++offset) {
-        move(9 + 3 + offset, 0);
-        clrtoeol();
-      }
+static void Stop(NCursesDisplay::Screen& screen) {
+  for (WINDOW* window : {screen.system, screen.processes, screen.profile}) {
+    if (window != nullptr) {
+      delwin(window);
     }
+  }
+  screen = NCursesDisplay::Screen();
+  endwin();
+}
 
-    move(0, 0);  // Keep cursor here
-    refresh();
-    previous_n = n;
+// Draw a sample, with 'title' (if any) on the system window's border, and
+// its processes, or its groups with the 'cursor'th highlighted, or its
+// threads. Only what changed since the last call is written; the windows
+// are recreated (and drawn in full) when the terminal is resized, or the
+// heatmap needs another number of rows, or the cgroup row comes or goes.
+static void Draw(const Sample& sample, NCursesDisplay::Screen& screen,
+                 const string& title, size_t cursor = 0) {
+  PROFILE_SCOPE(kDraw_);
+  size_t numCores = sample.coreUtilizations.size();
+  if ((screen.lines != getmaxy(stdscr)) ||
+      (screen.columns != getmaxx(stdscr)) ||
+      (screen.heatmapRows != NCursesDisplay::HeatmapRows(
+                                 numCores, getmaxx(screen.system))) ||
+      (screen.cgroup != sample.cgroup.present)) {
+    Layout(screen, numCores, sample.cgroup.present);
+    screen.title = "\n";  // Draw the title, even if there's none
+  }
 
-    // Several inputs can be processed between refreshes
-    SleepAndCheckInput(system,
-                       /* Number of processes */ n,
-                       /* milliseconds */ 250,
-                       /* number of sleeps */ 4, quit);
+  if (title != screen.title) {
+    mvwhline(screen.system, 0, 1, ACS_HLINE, getmaxx(screen.system) - 2);
+    if (!title.empty()) {
+      mvwprintw(screen.system, 0, 2, "%s", title.c_str());
+    }
+    screen.title = title;
   }
-  endwin();
+  NCursesDisplay::DisplaySystem(sample, screen.system, screen.systemFields);
+
+  // Processes (with or without PSS), groups and threads have different
+  // columns: switch on a blank window
+  if ((sample.grouping != screen.grouping) ||
+      (sample.showThreads != screen.threads) ||
+      (sample.smaps != screen.smaps)) {
+    werase(screen.processes);
+    box(screen.processes, 0, 0);
+    screen.processFields.Clear();
+    screen.grouping = sample.grouping;
+    screen.threads = sample.showThreads;
+    screen.smaps = sample.smaps;
+  }
+  if (sample.showThreads) {
+    NCursesDisplay::DisplayThreads(sample, screen.processes,
+                                   screen.processFields);
+  } else if (sample.grouping == kNumGroupings_) {
+    NCursesDisplay::DisplayProcesses(sample, screen.processes,
+                                     screen.processFields);
+  } else {
+    NCursesDisplay::DisplayGroups(sample, screen.processes,
+                                  screen.processFields, cursor);
+  }
+  wnoutrefresh(screen.system);
+  wnoutrefresh(screen.processes);
+  if (screen.profile != nullptr) {
+    NCursesDisplay::DisplayProfile(screen.profile);
+  }
+
+  // Keep the cursor in the top left corner
+  wmove(stdscr, 0, 0);
+  wnoutrefresh(stdscr);
+  doupdate();
+}
+
+// Show or hide the profile overlay; the windows it covered are drawn again
+static void ToggleProfile(NCursesDisplay::Screen& screen) {
+  if (screen.profile != nullptr) {
+    delwin(screen.profile);
+    screen.profile = nullptr;
+    touchwin(screen.system);
+    touchwin(screen.processes);
+    wnoutrefresh(screen.system);
+    wnoutrefresh(screen.processes);
+  } else {
+    screen.profile = NewProfileWindow();
+    Profiler::Enable(true);
+    NCursesDisplay::DisplayProfile(screen.profile);
+  }
+  doupdate();
+}
+
+// Columns of a snapshot's processes, reused to sort them for display
+struct Selection {
+  std::vector<float> cpu;
+  std::vector<int> ram;
+  std::vector<int> pid;
+  std::vector<Row> rows;
+  std::vector<ProcessSample> processes;
+};
+
+// Copy a sampler snapshot into 'view', keeping its top 'n' processes in
+// 'order' (see System::FillSampleInAllOrders())
+static void SelectProcesses(const Sample& snapshot, ProcessOrder order,
+                            size_t n, Sample& view, Selection& selection) {
+  view = snapshot;
+  selection.cpu.clear();
+  selection.ram.clear();
+  selection.pid.clear();
+  for (const ProcessSample& process : view.processes) {
+    selection.cpu.push_back(process.cpuUtilization);
+    selection.ram.push_back(process.ram);
+    selection.pid.push_back(process.pid);
+  }
+
+  size_t size = view.processes.size();
+  n = std::min(n, size);
+  selection.rows.resize(size);
+  std::iota(selection.rows.begin(), selection.rows.end(), 0);
+  RowOrder compare{selection.cpu, selection.ram, selection.pid, order};
+  std::partial_sort(selection.rows.begin(), selection.rows.begin() + n,
+                    selection.rows.end(), compare);
+
+  selection.processes.resize(n);
+  for (size_t i = 0; i < n; ++i) {
+    std::swap(selection.processes[i], view.processes[selection.rows[i]]);
+  }
+  view.processes.swap(selection.processes);
+}
+
+// Strict weak ordering of groups for a GroupOrder, ties broken on name
+static bool GroupBefore(const GroupSample& a, const GroupSample& b,
+                        GroupOrder order) {
+  switch (order) {
+    case kGroupCpuAsc_:
+      if (a.cpuUtilization != b.cpuUtilization)
+        return a.cpuUtilization < b.cpuUtilization;
+      break;
+    case kGroupCpuDsc_:
+      if (a.cpuUtilization != b.cpuUtilization)
+        return a.cpuUtilization > b.cpuUtilization;
+      break;
+    case kGroupMemoryAsc_:
+      if (a.ram != b.ram) return a.ram < b.ram;
+      break;
+    case kGroupMemoryDsc_:
+      if (a.ram != b.ram) return a.ram > b.ram;
+      break;
+    case kGroupSizeAsc_:
+      if (a.processes != b.processes) return a.processes < b.processes;
+      break;
+    case kGroupSizeDsc_:
+      if (a.processes != b.processes) return a.processes > b.processes;
+      break;
+  }
+  return a.name < b.name;
+}
+
+// Copy a sampler snapshot into 'view', keeping its top 'n' groups in
+// 'order'
+static void SelectGroups(const Sample& snapshot, GroupOrder order, size_t n,
+                         Sample& view) {
+  view = snapshot;
+  n = std::min(n, view.groups.size());
+  std::partial_sort(view.groups.begin(), view.groups.begin() + n,
+                    view.groups.end(),
+                    [order](const GroupSample& a, const GroupSample& b) {
+                      return GroupBefore(a, b, order);
+                    });
+  view.groups.resize(n);
+}
+
+// Copy a sampler snapshot into 'view', keeping its top 'n' threads by CPU,
+// in ascending order for kCpuAsc_ (and descending otherwise). Processes
+// are left as they are, for threads to point to.
+static void SelectThreads(const Sample& snapshot, ProcessOrder order,
+                          size_t n, Sample& view) {
+  view = snapshot;
+  n = std::min(n, view.threads.size());
+  bool ascending = (order == kCpuAsc_);
+  std::partial_sort(view.threads.begin(), view.threads.begin() + n,
+                    view.threads.end(),
+                    [ascending](const ThreadSample& a, const ThreadSample& b) {
+                      if (a.cpuUtilization != b.cpuUtilization) {
+                        return ascending
+                                   ? (a.cpuUtilization < b.cpuUtilization)
+                                   : (a.cpuUtilization > b.cpuUtilization);
+                      }
+                      return a.tid < b.tid;
+                    });
+  view.threads.resize(n);
+}
+
+// Title of the system window, e.g. " user root (backspace: back) "
+static string Title(const NCursesDisplay::Controls& controls,
+                    bool recording) {
+  string title{recording ? " Recording " : ""};
+  const ProcessView& view = controls.view;
+  if (view.threads) {
+    title += " threads of the top processes (t: processes) ";
+  } else if (view.grouping != kNumGroupings_) {
+    title += (view.grouping == kByUser_) ? " user" : " cgroup";
+    title += view.drillDown ? (" " + view.group + " (backspace: back) ")
+                            : " totals (enter: processes) ";
+  }
+  return title;
 }
 
-void NCursesDisplay::SleepAndCheckInput(System& system, size_t& n,
-                                        int millisecondsPerSleep,
-                                        int numberOfSleeps, bool& quit) {
-  int ch;
-  quit = false;
-
-  for (int sleep = 0; sleep < numberOfSleeps; ++sleep) {
-    std::this_thread::sleep_for(
-        std::chrono::milliseconds(millisecondsPerSleep));
-
-    ch = getch();
-    if (ch == KEY_UP) {
-      system.ToggleProcessOrderByCpu();
-    } else if (ch == KEY_DOWN) {
-      system.ToggleProcessOrderByMemory();
-    } else if (ch == '+') {
-      // Increase number of processes displayed (upper limit: # processes)
-      n = (n < system.Processes().size()) ? (n + 1) : n;
-    } else if (ch == '-') {
-      // Decrease number of processes displayed (lower limit: 1)
-      if (n > 1) {
-        --n;
+// Make the timerfd 'timer' expire every second, the first time straight
+// away if 'now', else a second from now
+static void StartTimer(int timer, bool now) {
+  itimerspec period{};
+  period.it_interval.tv_sec = 1;
+  if (now) {
+    period.it_value.tv_nsec = 1;
+  } else {
+    period.it_value.tv_sec = 1;
+  }
+  timerfd_settime(timer, 0, &period, nullptr);
+}
+
+// Consume the expirations of the timerfd 'timer', if any since the last call
+static bool TimerExpired(int timer) {
+  std::uint64_t expirations;
+  return read(timer, &expirations, sizeof(expirations)) > 0;
+}
+
+// Refreshing is left to a Sampler thread: this thread waits in poll() for
+// key presses, the sampling timer and new snapshots, so that input is
+// handled (and shown) straight away however long a refresh takes
+bool NCursesDisplay::Display(System& system, size_t n, Recorder* recorder) {
+  Sampler sampler(system, recorder);
+  int timer = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+  if ((timer < 0) || !sampler.Start()) {
+    int error = errno;
+    if (timer >= 0) {
+      close(timer);
+    }
+    errno = error;
+    return false;
+  }
+  // Sample every second, starting straight away
+  StartTimer(timer, true);
+  sampler.SetRows(n);
+
+  Screen screen;
+  Start(screen);
+  Sample view;
+  Selection selection;
+  Controls controls;
+  controls.n = n;
+  std::vector<int> visible;
+  bool sampled = false;
+  pollfd fds[] = {{STDIN_FILENO, POLLIN, 0},
+                  {timer, POLLIN, 0},
+                  {sampler.EventFd(), POLLIN, 0}};
+
+  while (!controls.quit) {
+    // Resizes interrupt poll(), and are then read as keys
+    if ((poll(fds, 3, -1) < 0) && (errno != EINTR)) {
+      break;
+    }
+    bool redraw = false;
+    if ((fds[1].revents & POLLIN) && TimerExpired(timer)) {
+      sampler.RequestRefresh();
+    }
+    if ((fds[2].revents & POLLIN) && sampler.Update()) {
+      sampled = true;
+      redraw = true;
+    }
+
+    size_t previous_n = controls.n;
+    ProcessView previous_view = controls.view;
+    int ch;
+    while ((ch = getch()) != ERR) {
+      redraw = HandleInput(ch, view, controls) || redraw;
+    }
+    if (controls.n != previous_n) {
+      sampler.SetRows(controls.n);
+    }
+    if ((controls.view.grouping != previous_view.grouping) ||
+        (controls.view.drillDown != previous_view.drillDown) ||
+        (controls.view.group != previous_view.group) ||
+        (controls.view.threads != previous_view.threads)) {
+      sampler.SetView(controls.view);
+    }
+    if (controls.profile != (screen.profile != nullptr)) {
+      ToggleProfile(screen);
+    }
+
+    if (redraw && sampled && !controls.quit) {
+      const Sample& snapshot = sampler.Snapshot();
+      if (snapshot.showThreads) {
+        SelectThreads(snapshot, controls.order, controls.n, view);
+      } else if (snapshot.grouping == kNumGroupings_) {
+        SelectProcesses(snapshot, controls.order, controls.n, view,
+                        selection);
+      } else {
+        SelectGroups(snapshot, controls.groupOrder, controls.n, view);
+        size_t last = std::max<size_t>(view.groups.size(), 1) - 1;
+        controls.cursor = std::min(controls.cursor, last);
       }
-    } else if (ch == 'q') {
-      quit = true;
+      Draw(view, screen, Title(controls, sampler.Recording()),
+           controls.cursor);
+
+      // Keep what is displayed up to date, however idle
+      visible.clear();
+      for (const ProcessSample& process : view.processes) {
+        visible.push_back(process.pid);
+      }
+      sampler.SetVisible(visible);
+    }
+  }
+  Stop(screen);
+  close(timer);
+  return true;
+}
+
+bool NCursesDisplay::HandleInput(int ch, const Sample& shown,
+                                 Controls& controls) {
+  ProcessView& view = controls.view;
+  bool groups = (shown.grouping != kNumGroupings_);
+  if ((ch == KEY_UP) && groups) {
+    controls.groupOrder = (controls.groupOrder == kGroupCpuDsc_)
+                              ? kGroupCpuAsc_
+                              : kGroupCpuDsc_;
+  } else if ((ch == KEY_DOWN) && groups) {
+    controls.groupOrder = (controls.groupOrder == kGroupMemoryDsc_)
+                              ? kGroupMemoryAsc_
+                              : kGroupMemoryDsc_;
+  } else if ((ch == 'n') && groups) {
+    controls.groupOrder = (controls.groupOrder == kGroupSizeDsc_)
+                              ? kGroupSizeAsc_
+                              : kGroupSizeDsc_;
+  } else if (ch == KEY_UP) {
+    controls.order = (controls.order == kCpuDsc_) ? kCpuAsc_ : kCpuDsc_;
+  } else if (ch == KEY_DOWN) {
+    controls.order =
+        (controls.order == kMemoryDsc_) ? kMemoryAsc_ : kMemoryDsc_;
+  } else if (ch == '+') {
+    // Increase number of processes displayed (upper limit: # processes)
+    controls.n = (controls.n < shown.numProcesses) ? (controls.n + 1)
+                                                   : controls.n;
+  } else if (ch == '-') {
+    // Decrease number of processes displayed (lower limit: 1)
+    if (controls.n > 1) {
+      --controls.n;
+    }
+  } else if (ch == 'g') {
+    // Processes, then their totals by cgroup, then by user
+    view.grouping = (Grouping)((view.grouping + 1) % (kNumGroupings_ + 1));
+    view.drillDown = false;
+    view.threads = false;
+    controls.cursor = 0;
+  } else if (ch == 't') {
+    // The threads of the top processes, instead of processes or groups
+    view.threads = !view.threads;
+    view.grouping = kNumGroupings_;
+    view.drillDown = false;
+    controls.cursor = 0;
+  } else if ((ch == 'j') && groups) {
+    controls.cursor += (controls.cursor + 1 < shown.groups.size()) ? 1 : 0;
+  } else if ((ch == 'k') && groups) {
+    controls.cursor -= (controls.cursor > 0) ? 1 : 0;
+  } else if (((ch == '\n') || (ch == '\r') || (ch == KEY_ENTER)) && groups &&
+             (controls.cursor < shown.groups.size())) {
+    view.drillDown = true;
+    view.group = shown.groups[controls.cursor].name;
+  } else if (((ch == KEY_BACKSPACE) || (ch == 127) || (ch == '\b')) &&
+             view.drillDown) {
+    view.drillDown = false;
+  } else if (ch == 'p') {
+    // Toggle the profile overlay (profiling starts with it)
+    controls.profile = !controls.profile;
+  } else if (ch == 'q') {
+    controls.quit = true;
+  } else if (ch != KEY_RESIZE) {
+    return false;  // Nothing to redraw
+  }
+  return true;
+}
+
+// The same loop as Display()'s, without a Sampler: waits in poll() for key
+// presses and the timer, which moves on to the next frame(s) every second
+bool NCursesDisplay::Replay(Replayer& replayer, size_t n) {
+  int timer = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+  if (timer < 0) {
+    return false;
+  }
+  // The first frame is shown straight away, the next one a second later
+  StartTimer(timer, false);
+
+  Screen screen;
+  Start(screen);
+  Sample sample;
+  ReplayControls controls;
+  controls.n = n;
+  bool ok = replayer.Seek(0);
+  bool redraw = true;
+  pollfd fds[] = {{STDIN_FILENO, POLLIN, 0}, {timer, POLLIN, 0}};
+
+  while (ok && !controls.quit) {
+    if (redraw) {
+      replayer.FillSample(sample, controls.n);
+      string title{" Replay " +
+                   Format::ElapsedTime(replayer.ElapsedMs() / 1000) + " (" +
+                   to_string(replayer.Position() + 1) + "/" +
+                   to_string(replayer.NumFrames()) + ") "};
+      if (controls.paused) {
+        title += "paused ";
+      } else if (controls.speed > 1) {
+        title += "x" + to_string(controls.speed) + " ";
+      }
+      Draw(sample, screen, title);
+    }
+
+    // Resizes interrupt poll(), and are then read as keys
+    if ((poll(fds, 2, -1) < 0) && (errno != EINTR)) {
       break;
     }
+    redraw = false;
+    if ((fds[1].revents & POLLIN) && TimerExpired(timer) &&
+        !controls.paused) {
+      ok = replayer.Seek(replayer.Position() + controls.speed);
+      // Stop at the end of the recording
+      controls.paused = (replayer.Position() + 1 == replayer.NumFrames());
+      redraw = true;
+    }
+
+    size_t position = replayer.Position();
+    int ch;
+    while ((ch = getch()) != ERR) {
+      redraw = HandleReplayInput(ch, replayer, sample.numProcesses,
+                                 controls) ||
+               redraw;
+    }
+    if (replayer.Position() != position) {
+      // Seeked: show the new position for a whole second
+      StartTimer(timer, false);
+    }
+  }
+  Stop(screen);
+  close(timer);
+  return true;
+}
+
+// Up/down arrows toggle the order by CPU/memory, '+'/'-' show more/fewer
+// of the 'numProcesses' processes, left/right arrows seek 10 frames
+// backwards/forwards, 'f' toggles fast forward, space pauses and 'q' quits
+bool NCursesDisplay::HandleReplayInput(int ch, Replayer& replayer,
+                                       size_t numProcesses,
+                                       ReplayControls& controls) {
+  const size_t kSeekFrames{10};
+  const size_t kFastForwardSpeed{10};
+  if (ch == KEY_UP) {
+    replayer.ToggleProcessOrderByCpu();
+  } else if (ch == KEY_DOWN) {
+    replayer.ToggleProcessOrderByMemory();
+  } else if (ch == '+') {
+    controls.n = (controls.n < numProcesses) ? (controls.n + 1) : controls.n;
+  } else if (ch == '-') {
+    if (controls.n > 1) {
+      --controls.n;
+    }
+  } else if (ch == KEY_LEFT) {
+    size_t position = replayer.Position();
+    replayer.Seek(position - std::min(position, kSeekFrames));
+  } else if (ch == KEY_RIGHT) {
+    replayer.Seek(replayer.Position() + kSeekFrames);
+  } else if (ch == 'f') {
+    controls.speed = (controls.speed == 1) ? kFastForwardSpeed : 1;
+    controls.paused = false;
+  } else if (ch == ' ') {
+    controls.paused = !controls.paused;
+  } else if (ch == 'q') {
+    controls.quit = true;
+  } else if (ch != KEY_RESIZE) {
+    return false;  // Nothing to redraw
   }
+  return true;
 }
@@ -0,0 +1,161 @@
+#include "options.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "profiler.h"
+
+// Parse a strictly positive integer argument
+static bool ParseCount(const char* text, std::size_t& value) {
+  char* end;
+  long long parsed = std::strtoll(text, &end, 10);
+  if ((*text == '\0') || (*end != '\0') || (parsed <= 0)) {
+    return false;
+  }
+  value = parsed;
+  return true;
+}
+
+bool Options::Parse(int argc, char* argv[], Options& options) {
+  for (int i = 1; i < argc; ++i) {
+    const char* arg = argv[i];
+    const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+
+    if (std::strcmp(arg, "--threads") == 0) {
+      if ((value == nullptr) || !ParseCount(value, options.threads)) {
+        std::fprintf(stderr, "--threads expects a positive integer\n");
+        return false;
+      }
+      ++i;
+    } else if (std::strcmp(arg, "--nss") == 0) {
+      options.nss = true;
+    } else if (std::strcmp(arg, "--batch") == 0) {
+      options.batch = true;
+    } else if (std::strcmp(arg, "--interval") == 0) {
+      if ((value == nullptr) || !ParseCount(value, options.intervalMs)) {
+        std::fprintf(stderr, "--interval expects a positive integer (ms)\n");
+        return false;
+      }
+      ++i;
+    } else if (std::strcmp(arg, "--count") == 0) {
+      if ((value == nullptr) || !ParseCount(value, options.count)) {
+        std::fprintf(stderr, "--count expects a positive integer\n");
+        return false;
+      }
+      ++i;
+    } else if (std::strcmp(arg, "--format") == 0) {
+      if ((value != nullptr) && (std::strcmp(value, "csv") == 0)) {
+        options.format = kCsv_;
+      } else if ((value != nullptr) && (std::strcmp(value, "json") == 0)) {
+        options.format = kJson_;
+      } else {
+        std::fprintf(stderr, "--format expects csv or json\n");
+        return false;
+      }
+      ++i;
+    } else if (std::strcmp(arg, "--record") == 0) {
+      if ((value == nullptr) || (*value == '\0')) {
+        std::fprintf(stderr, "--record expects a file name\n");
+        return false;
+      }
+      options.record = value;
+      ++i;
+    } else if (std::strcmp(arg, "--replay") == 0) {
+      if ((value == nullptr) || (*value == '\0')) {
+        std::fprintf(stderr, "--replay expects a file name\n");
+        return false;
+      }
+      options.replay = value;
+      ++i;
+    } else if (std::strcmp(arg, "--root") == 0) {
+      if ((value == nullptr) || (*value == '\0')) {
+        std::fprintf(stderr, "--root expects a directory\n");
+        return false;
+      }
+      options.root = value;
+      ++i;
+    } else if (std::strcmp(arg, "--cgroup") == 0) {
+      if ((value == nullptr) || (*value != '/')) {
+        std::fprintf(stderr,
+                     "--cgroup expects a cgroup path (e.g. /system.slice)\n");
+        return false;
+      }
+      options.cgroup = value;
+      ++i;
+    } else if (std::strcmp(arg, "--no-tiers") == 0) {
+      options.tiers = false;
+    } else if (std::strcmp(arg, "--budget") == 0) {
+      if ((value == nullptr) || !ParseCount(value, options.budget)) {
+        std::fprintf(stderr, "--budget expects a positive integer\n");
+        return false;
+      }
+      ++i;
+    } else if (std::strcmp(arg, "--thread-scope") == 0) {
+      if ((value == nullptr) || !ParseCount(value, options.threadScope)) {
+        std::fprintf(stderr, "--thread-scope expects a positive integer\n");
+        return false;
+      }
+      ++i;
+    } else if (std::strcmp(arg, "--smaps") == 0) {
+      if ((value == nullptr) || !ParseCount(value, options.smapsMs)) {
+        std::fprintf(stderr, "--smaps expects a number of milliseconds\n");
+        return false;
+      }
+      ++i;
+    } else if (std::strcmp(arg, "--profile") == 0) {
+      if (!Profiler::kBuiltIn) {
+        std::fprintf(stderr, "--profile needs a MONITOR_PROFILING build\n");
+        return false;
+      }
+      options.profile = true;
+    } else {
+      std::fprintf(stderr, "Unknown option: %s\n", arg);
+      return false;
+    }
+  }
+  if (!options.record.empty() && !options.replay.empty()) {
+    std::fprintf(stderr, "--record and --replay are mutually exclusive\n");
+    return false;
+  }
+  return true;
+}
+
+void Options::PrintUsage(const char* program) {
+  std::fprintf(stderr,
+               "Usage: %s [options]\n"
+               "  --threads N    refresh processes using N threads "
+               "(default: 1)\n"
+               "  --nss          resolve users missing from /etc/passwd "
+               "(e.g. LDAP) via NSS\n"
+               "  --batch        stream samples to stdout instead of "
+               "running the UI\n"
+               "  --interval MS  batch mode: sample every MS milliseconds "
+               "(default: 1000)\n"
+               "  --count N      batch mode: stop after N samples "
+               "(default: run until killed)\n"
+               "  --format F     batch mode: csv (default) or json "
+               "(one object per line)\n"
+               "  --record FILE  record each tick to FILE\n"
+               "  --replay FILE  replay a recording (arrows: seek, f: fast "
+               "forward, space: pause)\n"
+               "  --root DIR     read DIR/proc and DIR/etc instead of /proc "
+               "and /etc\n"
+               "  --cgroup PATH  only monitor the processes of cgroup v2 "
+               "PATH and its\n"
+               "                 descendants, and show its totals\n"
+               "  --profile      time each refresh phase, and print the "
+               "timings on exit\n"
+               "  --no-tiers     refresh every process on every tick, even "
+               "idle ones\n"
+               "  --budget N     spend at most N syscalls per tick "
+               "refreshing processes\n"
+               "  --thread-scope N  t key: show the threads of the top N "
+               "processes by CPU\n"
+               "                 (default: as many as are shown)\n"
+               "  --smaps MS     read PSS and USS (smaps_rollup) for up to "
+               "MS ms per tick,\n"
+               "                 shown processes first, then the largest "
+               "(default: off)\n",
+               program);
+}
@@ -0,0 +1,152 @@
+#include "output_buffer.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+
+using std::size_t;
+using std::string;
+
+namespace {
+// Command lines read from /proc use NULs to separate arguments: show those
+// as spaces, and drop the trailing one(s)
+size_t TrimmedLength(const string& value) {
+  size_t length = value.size();
+  while ((length > 0) && (value[length - 1] == '\0')) {
+    --length;
+  }
+  return length;
+}
+}  // namespace
+
+OutputBuffer::OutputBuffer(size_t capacity) : data_(capacity) {}
+
+size_t OutputBuffer::Size() const { return size_; }
+
+const char* OutputBuffer::Data() const { return data_.data(); }
+
+// Make room for (at least) 'length' more characters and return a pointer
+// to where they go. Grows geometrically, keeping the capacity afterwards.
+char* OutputBuffer::Reserve(size_t length) {
+  if (size_ + length > data_.size()) {
+    data_.resize(std::max(2 * data_.size(), size_ + length));
+  }
+  return data_.data() + size_;
+}
+
+void OutputBuffer::Append(char c) {
+  *Reserve(1) = c;
+  ++size_;
+}
+
+void OutputBuffer::Append(const char* text) { Append(text, std::strlen(text)); }
+
+void OutputBuffer::Append(const char* text, size_t length) {
+  std::memcpy(Reserve(length), text, length);
+  size_ += length;
+}
+
+void OutputBuffer::AppendUnsigned(unsigned long long value) {
+  char digits[20];
+  int count{0};
+  do {
+    digits[count++] = '0' + (value % 10);
+    value /= 10;
+  } while (value > 0);
+
+  char* out = Reserve(count);
+  while (count > 0) {
+    *out++ = digits[--count];
+    ++size_;
+  }
+}
+
+void OutputBuffer::AppendSigned(long long value) {
+  if (value < 0) {
+    Append('-');
+    AppendUnsigned(0ULL - (unsigned long long)value);
+  } else {
+    AppendUnsigned(value);
+  }
+}
+
+void OutputBuffer::AppendFixed(double value, int decimals) {
+  if (!std::isfinite(value)) {
+    Append("0");
+    return;
+  }
+  if (value < 0) {
+    Append('-');
+    value = -value;
+  }
+
+  unsigned long long scale{1};
+  for (int i = 0; i < decimals; ++i) {
+    scale *= 10;
+  }
+  auto scaled = (unsigned long long)std::llround(value * scale);
+  AppendUnsigned(scaled / scale);
+  if (decimals > 0) {
+    Append('.');
+    unsigned long long fraction = scaled % scale;
+    for (unsigned long long digit = scale / 10; digit > 0; digit /= 10) {
+      Append((char)('0' + (fraction / digit) % 10));
+    }
+  }
+}
+
+void OutputBuffer::AppendCsvString(const string& value) {
+  size_t length = TrimmedLength(value);
+  Append('"');
+  for (size_t i = 0; i < length; ++i) {
+    char c = value[i];
+    if (c == '"') {
+      Append("\"\"", 2);
+    } else {
+      Append((c == '\0') ? ' ' : c);
+    }
+  }
+  Append('"');
+}
+
+void OutputBuffer::AppendJsonString(const string& value) {
+  static const char kHex[] = "0123456789abcdef";
+
+  size_t length = TrimmedLength(value);
+  Append('"');
+  for (size_t i = 0; i < length; ++i) {
+    unsigned char c = value[i];
+    if ((c == '"') || (c == '\\')) {
+      Append('\\');
+      Append((char)c);
+    } else if (c == '\0') {
+      Append(' ');
+    } else if (c < 0x20) {
+      char escape[6] = {'\\', 'u', '0', '0', kHex[c >> 4], kHex[c & 0xF]};
+      Append(escape, sizeof(escape));
+    } else {
+      Append((char)c);
+    }
+  }
+  Append('"');
+}
+
+bool OutputBuffer::Flush(int fd) {
+  size_t written{0};
+  while (written < size_) {
+    ssize_t n = write(fd, data_.data() + written, size_ - written);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      size_ = 0;
+      return false;
+    }
+    written += n;
+  }
+  size_ = 0;
+  return true;
+}
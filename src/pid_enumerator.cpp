@@ -0,0 +1,187 @@
+#include "pid_enumerator.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "linux_parser.h"
+
+using std::string;
+using std::vector;
+
+namespace {
+// Layout of the records returned by getdents64(2)
+struct LinuxDirent64 {
+  std::uint64_t d_ino;
+  std::int64_t d_off;
+  unsigned short d_reclen;
+  unsigned char d_type;
+  char d_name[];
+};
+
+// Large enough to list a few thousand entries per syscall
+const std::size_t kBufferSize{64 * 1024};
+
+// Parse a NUL terminated, all-digits name. Returns -1 if it's not one.
+int ParsePid(const char* name) {
+  if (*name == '\0') {
+    return -1;
+  }
+  int pid{0};
+  for (; *name != '\0'; ++name) {
+    if ((*name < '0') || (*name > '9')) {
+      return -1;
+    }
+    pid = (pid * 10) + (*name - '0');
+  }
+  return pid;
+}
+}  // namespace
+
+PidEnumerator::PidEnumerator(const string& directory)
+    : fd_(open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC)),
+      buffer_(kBufferSize) {}
+
+PidEnumerator::~PidEnumerator() {
+  if (fd_ >= 0) {
+    close(fd_);
+  }
+}
+
+bool PidEnumerator::Enumerate(vector<int>& pids) {
+  pids.clear();
+  if ((fd_ < 0) || (lseek(fd_, 0, SEEK_SET) < 0)) {
+    return false;
+  }
+  return List(fd_, pids);
+}
+
+bool PidEnumerator::EnumerateAt(int dirFd, const char* path,
+                                vector<int>& pids) {
+  pids.clear();
+  int fd = openat(dirFd, path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (fd < 0) {
+    return false;
+  }
+  bool ok = List(fd, pids);
+  close(fd);
+  return ok;
+}
+
+// Append the numeric entries of the directory 'fd' to 'pids', from its
+// current offset
+bool PidEnumerator::List(int fd, vector<int>& pids) {
+  while (true) {
+    long n = syscall(SYS_getdents64, fd, buffer_.data(), buffer_.size());
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    if (n == 0) {
+      return true;
+    }
+
+    for (long offset = 0; offset < n;) {
+      const auto* entry =
+          reinterpret_cast<const LinuxDirent64*>(buffer_.data() + offset);
+      offset += entry->d_reclen;
+
+      // procfs always fills in d_type; other file systems may not
+      if ((entry->d_type == DT_DIR) || (entry->d_type == DT_UNKNOWN)) {
+        int pid = ParsePid(entry->d_name);
+        if (pid > 0) {
+          pids.push_back(pid);
+        }
+      }
+    }
+  }
+}
+
+CgroupEnumerator::CgroupEnumerator(const string& directory)
+    : fd_(directory.empty() ? -1
+                            : open(directory.c_str(),
+                                   O_RDONLY | O_DIRECTORY | O_CLOEXEC)),
+      buffer_(kBufferSize) {}
+
+CgroupEnumerator::~CgroupEnumerator() {
+  if (fd_ >= 0) {
+    close(fd_);
+  }
+}
+
+bool CgroupEnumerator::IsOpen() const { return fd_ >= 0; }
+
+// Visit the cgroup, then its descendants breadth first. A descendant
+// removed while we walk the tree is skipped (its processes have moved, or
+// ended): only failing to read the cgroup itself is an error.
+bool CgroupEnumerator::Enumerate(vector<int>& pids) {
+  pids.clear();
+  if (fd_ < 0) {
+    return false;
+  }
+
+  std::size_t numPending{1};
+  if (pending_.empty()) {
+    pending_.emplace_back();
+  }
+  pending_[0] = ".";
+  for (std::size_t next = 0; next < numPending; ++next) {
+    int fd = openat(fd_, pending_[next].c_str(),
+                    O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+      if (next == 0) {
+        return false;
+      }
+      continue;
+    }
+
+    int procs = openat(fd, LinuxParser::kCgroupProcsName, O_RDONLY | O_CLOEXEC);
+    if (procs >= 0) {
+      if (LinuxParser::ReadFdIntoVector(procs, procs_)) {
+        LinuxParser::ParseCgroupProcs(procs_.data(), procs_.size(), pids);
+      }
+      close(procs);
+    } else if (next == 0) {
+      close(fd);
+      return false;
+    }
+
+    while (true) {
+      long n = syscall(SYS_getdents64, fd, buffer_.data(), buffer_.size());
+      if ((n < 0) && (errno == EINTR)) {
+        continue;
+      }
+      if (n <= 0) {
+        break;
+      }
+
+      for (long offset = 0; offset < n;) {
+        const auto* entry =
+            reinterpret_cast<const LinuxDirent64*>(buffer_.data() + offset);
+        offset += entry->d_reclen;
+        if (((entry->d_type != DT_DIR) && (entry->d_type != DT_UNKNOWN)) ||
+            (std::strcmp(entry->d_name, ".") == 0) ||
+            (std::strcmp(entry->d_name, "..") == 0)) {
+          continue;
+        }
+        if (numPending == pending_.size()) {
+          pending_.emplace_back();
+        }
+        string& path = pending_[numPending++];
+        path = pending_[next];
+        path += '/';
+        path += entry->d_name;
+      }
+    }
+    close(fd);
+  }
+  return true;
+}
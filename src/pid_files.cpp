@@ -0,0 +1,196 @@
+#include "pid_files.h"
+
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <iterator>
+
+using std::size_t;
+
+namespace {
+const char* const kPidFileNames[kNumPidFiles_] = {"stat"};
+
+// Descriptors left for everything else (terminal, /proc/stat, etc.)
+const size_t kReservedDescriptors{64};
+
+// Errors (or results) that mean the process has gone away
+bool ProcessGone(ssize_t result) {
+  return (result == 0) || ((result < 0) && ((errno == ESRCH) ||
+                                            (errno == ENOENT)));
+}
+}  // namespace
+
+const char* PidFileName(PidFile file) { return kPidFileNames[file]; }
+
+std::atomic<size_t> PidFiles::inUse_{0};
+
+PidFiles::PidFiles(int pid) : pid_(pid) {
+  std::fill(std::begin(fds_), std::end(fds_), -1);
+}
+
+PidFiles::~PidFiles() { Close(); }
+
+PidFiles::PidFiles(PidFiles&& other) noexcept
+    : pid_(other.pid_), dirFd_(other.dirFd_), lastUsed_(other.lastUsed_) {
+  for (int file = 0; file < kNumPidFiles_; ++file) {
+    fds_[file] = other.fds_[file];
+    other.fds_[file] = -1;
+  }
+  other.dirFd_ = -1;
+}
+
+PidFiles& PidFiles::operator=(PidFiles&& other) noexcept {
+  if (this != &other) {
+    Close();
+    pid_ = other.pid_;
+    dirFd_ = other.dirFd_;
+    lastUsed_ = other.lastUsed_;
+    for (int file = 0; file < kNumPidFiles_; ++file) {
+      fds_[file] = other.fds_[file];
+      other.fds_[file] = -1;
+    }
+    other.dirFd_ = -1;
+  }
+  return *this;
+}
+
+int PidFiles::Pid() const { return pid_; }
+
+long PidFiles::LastUsed() const { return lastUsed_; }
+
+int PidFiles::OpenCount() const {
+  int count = (dirFd_ >= 0) ? 1 : 0;
+  for (int fd : fds_) {
+    count += (fd >= 0) ? 1 : 0;
+  }
+  return count;
+}
+
+void PidFiles::Close() {
+  for (int& fd : fds_) {
+    CloseFd(fd);
+  }
+  CloseFd(dirFd_);
+}
+
+ssize_t PidFiles::Read(int procFd, PidFile file, char* buffer, size_t size,
+                       long tick) {
+  lastUsed_ = tick;
+
+  int fd = OpenFile(procFd, file);
+  if (fd < 0) {
+    if (ProcessGone(fd)) {
+      return 0;
+    }
+    // Out of budget (or descriptors): read without caching
+    return ReadUncached(procFd, file, buffer, size);
+  }
+
+  ssize_t n;
+  do {
+    n = pread(fd, buffer, size, 0);
+  } while ((n < 0) && (errno == EINTR));
+
+  return ProcessGone(n) ? 0 : n;
+}
+
+// Open <procFd>/<pid> (if not already open). Returns the descriptor, or a
+// negative value with errno set.
+int PidFiles::OpenDirectory(int procFd) {
+  if (dirFd_ < 0) {
+    if (!Reserve(1)) {
+      errno = EMFILE;
+      return -1;
+    }
+    char name[16];
+    std::snprintf(name, sizeof(name), "%d", pid_);
+    dirFd_ = openat(procFd, name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dirFd_ < 0) {
+      int error = errno;
+      inUse_.fetch_sub(1, std::memory_order_relaxed);
+      errno = error;
+    }
+  }
+  return dirFd_;
+}
+
+// Open <procFd>/<pid>/<file> (if not already open). Returns the descriptor,
+// or a negative value with errno set.
+int PidFiles::OpenFile(int procFd, PidFile file) {
+  int& fd = fds_[file];
+  if ((fd < 0) && (OpenDirectory(procFd) >= 0)) {
+    if (!Reserve(1)) {
+      errno = EMFILE;
+      return -1;
+    }
+    fd = openat(dirFd_, kPidFileNames[file], O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+      int error = errno;
+      inUse_.fetch_sub(1, std::memory_order_relaxed);
+      errno = error;
+    }
+  }
+  return (dirFd_ < 0) ? dirFd_ : fd;
+}
+
+ssize_t PidFiles::ReadUncached(int procFd, PidFile file, char* buffer,
+                               size_t size) const {
+  char name[32];
+  std::snprintf(name, sizeof(name), "%d/%s", pid_, kPidFileNames[file]);
+  int fd = openat(procFd, name, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return ProcessGone(fd) ? 0 : -1;
+  }
+
+  ssize_t n;
+  do {
+    n = read(fd, buffer, size);
+  } while ((n < 0) && (errno == EINTR));
+  bool gone = ProcessGone(n);
+  close(fd);
+
+  return gone ? 0 : n;
+}
+
+// Maximum number of descriptors all PidFiles may hold at once
+size_t PidFiles::DescriptorBudget() {
+  static const size_t budget = []() -> size_t {
+    struct rlimit limit;
+    if ((getrlimit(RLIMIT_NOFILE, &limit) != 0) ||
+        (limit.rlim_cur <= 2 * kReservedDescriptors)) {
+      return 0;
+    }
+    if (limit.rlim_cur == RLIM_INFINITY) {
+      return 1U << 20;
+    }
+    return limit.rlim_cur - kReservedDescriptors;
+  }();
+  return budget;
+}
+
+size_t PidFiles::DescriptorsInUse() {
+  return inUse_.load(std::memory_order_relaxed);
+}
+
+bool PidFiles::Reserve(int count) {
+  size_t current = inUse_.load(std::memory_order_relaxed);
+  do {
+    if (current + count > DescriptorBudget()) {
+      return false;
+    }
+  } while (!inUse_.compare_exchange_weak(current, current + count,
+                                         std::memory_order_relaxed));
+  return true;
+}
+
+void PidFiles::CloseFd(int& fd) {
+  if (fd >= 0) {
+    close(fd);
+    fd = -1;
+    inUse_.fetch_sub(1, std::memory_order_relaxed);
+  }
+}
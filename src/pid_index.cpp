@@ -0,0 +1,85 @@
+#include "pid_index.h"
+
+using std::size_t;
+using std::uint32_t;
+
+PidIndex::PidIndex() { Rehash(1024); }
+
+// Fibonacci hashing: consecutive PIDs are spread over the whole table
+size_t PidIndex::Home(int pid) const {
+  return (static_cast<uint32_t>(pid) * 2654435769U) & mask_;
+}
+
+uint32_t PidIndex::Find(int pid) const {
+  for (size_t i = Home(pid);; i = (i + 1) & mask_) {
+    if (slots_[i].pid == pid) {
+      return slots_[i].row;
+    }
+    if (slots_[i].pid == 0) {
+      return kNotFound_;
+    }
+  }
+}
+
+void PidIndex::Insert(int pid, uint32_t row) {
+  if (2 * (size_ + 1) > slots_.size()) {
+    Rehash(2 * slots_.size());
+  }
+
+  size_t i = Home(pid);
+  while ((slots_[i].pid != 0) && (slots_[i].pid != pid)) {
+    i = (i + 1) & mask_;
+  }
+  if (slots_[i].pid == 0) {
+    ++size_;
+  }
+  slots_[i] = {pid, row};
+}
+
+void PidIndex::Erase(int pid) {
+  size_t i = Home(pid);
+  while (slots_[i].pid != pid) {
+    if (slots_[i].pid == 0) {
+      return;  // Not present
+    }
+    i = (i + 1) & mask_;
+  }
+
+  // Backward shift deletion: move later entries of the probe sequence into
+  // the hole if that doesn't put them before their home slot
+  for (size_t j = (i + 1) & mask_; slots_[j].pid != 0; j = (j + 1) & mask_) {
+    size_t home = Home(slots_[j].pid);
+    bool canMove = (i <= j) ? ((home <= i) || (home > j))
+                            : ((home <= i) && (home > j));
+    if (canMove) {
+      slots_[i] = slots_[j];
+      i = j;
+    }
+  }
+  slots_[i] = {0, 0};
+  --size_;
+}
+
+size_t PidIndex::Size() const { return size_; }
+
+void PidIndex::Reserve(size_t count) {
+  size_t capacity = slots_.size();
+  while (capacity < 2 * count) {
+    capacity *= 2;
+  }
+  if (capacity != slots_.size()) {
+    Rehash(capacity);
+  }
+}
+
+void PidIndex::Rehash(size_t capacity) {
+  std::vector<Slot> old(capacity, Slot{0, 0});
+  old.swap(slots_);
+  mask_ = capacity - 1;
+  size_ = 0;
+  for (const Slot& slot : old) {
+    if (slot.pid != 0) {
+      Insert(slot.pid, slot.row);
+    }
+  }
+}
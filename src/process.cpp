@@ -1,81 +1,30 @@
 #include "process.h"
 
-#include <cassert>
 #include <string>
-#include <vector>
-
-#include "linux_parser.h"
-#include "users.h"
 
 using std::string;
 using std::to_string;
-using std::vector;
-
-Process::Process(int pid)
-    : pid_(pid),
-      user_(""),
-      cmd_(""),
-      startTimeAfterBoot_(-1),
-      ram_(-1),
-      upTime_(-1),
-      prevActiveJiffies_(0),
-      cpu_utilization_(-1.0) {
-  int uid = LinuxParser::Uid(pid);
-  user_ = Users::LookUpUserName(uid);
-  cmd_ = LinuxParser::Command(pid);
-  startTimeAfterBoot_ = LinuxParser::StartTimeAfterBoot(pid);
 
-  // Note: Refresh() method is called to populate/refresh the
-  // remaining members
-}
+Process::Process(const ProcessTable& table, Row row)
+    : table_(table), row_(row) {}
 
 // Return this process's ID
-int Process::Pid() const { return pid_; }
+int Process::Pid() const { return table_.Pid(row_); }
 
 // Return this process's CPU utilization
-float Process::CpuUtilization() const { return cpu_utilization_; }
+float Process::CpuUtilization() const { return table_.CpuUtilization(row_); }
 
 // Return the command that generated this process
-string Process::Command() const { return cmd_; }
+string Process::Command() const { return table_.Command(row_); }
 
 // Return this process's memory utilization
-string Process::Ram() const { return to_string(ram_); }
+string Process::Ram() const { return to_string(table_.Ram(row_)); }
 
 // Return this process's memory utilization (as int)
-int Process::RamAsInt() const { return ram_; }
+int Process::RamAsInt() const { return table_.Ram(row_); }
 
 // Return the user (name) that generated this process
-string Process::User() const { return user_; }
+string Process::User() const { return table_.User(row_); }
 
 // Return the age of this process (in seconds)
-long Process::UpTime() const { return upTime_; }
-
-// Returns 'true' if the process has ended
-bool Process::HasEnded() const { return LinuxParser::ProcessHasEnded(pid_); }
-
-// Refresh process data
-void Process::Refresh(long systemUpTime, long systemActiveJiffiesDelta) {
-  // Refresh RAM
-  ram_ = std::stoi(LinuxParser::Ram(pid_));
-
-  // Refresh uptime
-  assert(systemUpTime >= startTimeAfterBoot_);
-  upTime_ = systemUpTime - startTimeAfterBoot_;
-
-  // Refresh CPU utilisation information
-  unsigned long long activeJiffies = LinuxParser::ActiveJiffies(pid_);
-
-  if (activeJiffies == 0U) {
-    cpu_utilization_ = 0.0;
-  } else {
-    assert(activeJiffies >= prevActiveJiffies_);
-    unsigned long long activeJiffiesDelta = activeJiffies - prevActiveJiffies_;
-
-    cpu_utilization_ =
-        (systemActiveJiffiesDelta == 0)
-            ? 0.0
-            : ((float)activeJiffiesDelta / systemActiveJiffiesDelta);
-  }
-
-  prevActiveJiffies_ = activeJiffies;
-}
+long Process::UpTime() const { return table_.UpTime(row_); }
@@ -0,0 +1,554 @@
+#include "process_table.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+#include "linux_parser.h"
+#include "users.h"
+
+using std::size_t;
+using std::string;
+
+// Process start times in /proc are in clock ticks
+static const long kClockTicksPerSecond{sysconf(_SC_CLK_TCK)};
+// RSS in /proc/<pid>/stat is in pages
+static const long kPageKb{sysconf(_SC_PAGESIZE) / 1024};
+
+ProcessTable::ProcessTable(DataSource& source) : source_(source) {}
+
+size_t ProcessTable::Size() const { return pid_.size(); }
+
+void ProcessTable::Reserve(size_t capacity) {
+  pid_.reserve(capacity);
+  startTime_.reserve(capacity);
+  seen_.reserve(capacity);
+  state_.reserve(capacity);
+  materialized_.reserve(capacity);
+  uid_.reserve(capacity);
+  user_.reserve(capacity);
+  cmd_.reserve(capacity);
+  rss_.reserve(capacity);
+  pss_.reserve(capacity);
+  uss_.reserve(capacity);
+  nextSmapsRefresh_.reserve(capacity);
+  upTime_.reserve(capacity);
+  prevActiveJiffies_.reserve(capacity);
+  prevSystemJiffies_.reserve(capacity);
+  cpuUtilization_.reserve(capacity);
+  tier_.reserve(capacity);
+  nextRefresh_.reserve(capacity);
+  files_.reserve(capacity);
+  for (auto& column : groupOf_) {
+    column.reserve(capacity);
+  }
+  groupedCpu_.reserve(capacity);
+  groupedRam_.reserve(capacity);
+  nextRejoin_.reserve(capacity);
+  rejoinShift_.reserve(capacity);
+  index_.Reserve(capacity);
+}
+
+Row ProcessTable::Find(int pid) const { return index_.Find(pid); }
+
+bool ProcessTable::Add(int pid, long tick, long systemUpTime,
+                       unsigned long long systemActiveJiffies) {
+  PidFiles files(pid);
+  LinuxParser::ProcStatRecord stat;
+  if (!LinuxParser::ReadProcStat(source_, files, stat, tick)) {
+    return false;  // Already gone
+  }
+
+  Row row = Size();
+  pid_.push_back(pid);
+  startTime_.push_back(0);
+  seen_.push_back(tick);
+  state_.push_back(kAlive_);
+  materialized_.push_back(false);
+  uid_.push_back(-1);
+  user_.push_back(StringPool::kEmpty_);
+  cmd_.push_back(StringPool::kEmpty_);
+  rss_.push_back(-1);
+  pss_.push_back(-1);
+  uss_.push_back(-1);
+  nextSmapsRefresh_.push_back(0);
+  upTime_.push_back(-1);
+  prevActiveJiffies_.push_back(0);
+  prevSystemJiffies_.push_back(0);
+  cpuUtilization_.push_back(-1.0);
+  tier_.push_back(0);
+  nextRefresh_.push_back(0);
+  files_.push_back(std::move(files));
+  for (auto& column : groupOf_) {
+    column.push_back(GroupTable::kNoGroup_);
+  }
+  groupedCpu_.push_back(0);
+  groupedRam_.push_back(0);
+  nextRejoin_.push_back(0);
+  rejoinShift_.push_back(0);
+  index_.Insert(pid, row);
+
+  // The same read populates the dynamic columns
+  Initialize(row, stat, systemActiveJiffies);
+  Update(row, stat, systemUpTime, systemActiveJiffies, tick);
+  JoinGroups(row);
+  return true;
+}
+
+void ProcessTable::MarkSeen(Row row, unsigned long generation) {
+  seen_[row] = generation;
+}
+
+void ProcessTable::MarkUnseenAsEnded(unsigned long generation) {
+  for (Row row = 0; row < Size(); ++row) {
+    if (seen_[row] != generation) {
+      state_[row] = kEnded_;
+    }
+  }
+}
+
+void ProcessTable::Refresh(Row row, long systemUpTime,
+                           unsigned long long systemActiveJiffies,
+                           long tick) {
+  if (state_[row] != kAlive_) {
+    return;
+  }
+
+  // A single read of /proc/<pid>/stat provides everything refreshed below.
+  // Failing to read it (ESRCH or an empty read) means either the process
+  // ended since it was enumerated, or its PID now belongs to a new process
+  // and our descriptors still refer to the old one: retry with new ones.
+  LinuxParser::ProcStatRecord stat;
+  if (!LinuxParser::ReadProcStat(source_, files_[row], stat, tick)) {
+    files_[row].Close();
+    if (!LinuxParser::ReadProcStat(source_, files_[row], stat, tick)) {
+      state_[row] = kEnded_;
+      files_[row].Close();
+      return;
+    }
+  }
+
+  if (stat.startTime != startTime_[row]) {
+    // Same PID, different process: start over from this read, leaving
+    // what can't be done concurrently to ResetReused()
+    Initialize(row, stat, systemActiveJiffies);
+    state_[row] = kReused_;
+  }
+
+  Update(row, stat, systemUpTime, systemActiveJiffies, tick);
+}
+
+// Refresh() has already read the new process's stat: what's left is
+// forgetting the old process's display-only attributes and groups
+size_t ProcessTable::ResetReused() {
+  size_t count{0};
+  for (Row row = 0; row < Size(); ++row) {
+    if (state_[row] != kReused_) {
+      continue;
+    }
+
+    avoidedReads_ += PendingReads(row);  // Of the old process
+    LeaveGroups(row);
+    strings_.Release(user_[row]);
+    strings_.Release(cmd_[row]);
+    materialized_[row] = false;
+    uid_[row] = -1;
+    user_[row] = StringPool::kEmpty_;
+    cmd_[row] = StringPool::kEmpty_;
+    state_[row] = kAlive_;
+    JoinGroups(row);
+    RegroupRow(row);
+    ++count;
+  }
+  return count;
+}
+
+// Set the static attributes of a row from its process's first stat read.
+// Only writes to the row's own columns, so that Refresh() may call it; the
+// display-only attributes are left to Materialize().
+void ProcessTable::Initialize(Row row,
+                              const LinuxParser::ProcStatRecord& stat,
+                              unsigned long long systemActiveJiffies) {
+  startTime_[row] = stat.startTime;
+  pss_[row] = -1;
+  uss_[row] = -1;
+  nextSmapsRefresh_[row] = 0;
+
+  // CPU utilization is measured from now on, rather than since the
+  // process started
+  prevActiveJiffies_[row] = stat.ActiveJiffies();
+  prevSystemJiffies_[row] = systemActiveJiffies;
+  cpuUtilization_[row] = 0.0;
+  tier_[row] = 0;
+}
+
+// Set the dynamic attributes of a row from a new stat read
+void ProcessTable::Update(Row row, const LinuxParser::ProcStatRecord& stat,
+                          long systemUpTime,
+                          unsigned long long systemActiveJiffies, long tick) {
+  // Refresh RAM: the resident set, as statm's second field would give,
+  // without reading another file
+  rss_[row] = stat.rss * kPageKb;
+
+  // Refresh uptime (the system uptime is rounded, hence the clamping)
+  long startTimeAfterBoot = startTime_[row] / kClockTicksPerSecond;
+  upTime_[row] = std::max(systemUpTime - startTimeAfterBoot, 0L);
+
+  // Refresh CPU utilisation information
+  unsigned long long activeJiffies = stat.ActiveJiffies();
+  unsigned long long activeJiffiesDelta =
+      (activeJiffies > prevActiveJiffies_[row])
+          ? (activeJiffies - prevActiveJiffies_[row])
+          : 0U;
+
+  // Over the ticks since the row's last refresh, however many there were
+  unsigned long long systemActiveJiffiesDelta =
+      (systemActiveJiffies > prevSystemJiffies_[row])
+          ? (systemActiveJiffies - prevSystemJiffies_[row])
+          : 0U;
+  cpuUtilization_[row] =
+      (systemActiveJiffiesDelta == 0)
+          ? 0.0
+          : ((float)activeJiffiesDelta / systemActiveJiffiesDelta);
+
+  prevActiveJiffies_[row] = activeJiffies;
+  prevSystemJiffies_[row] = systemActiveJiffies;
+
+  // Busy processes go to the hottest tier, idle ones cool down
+  if (activeJiffiesDelta > 0) {
+    tier_[row] = 0;
+  } else if (tier_[row] < kMaxTier_) {
+    ++tier_[row];
+  }
+  nextRefresh_[row] = tick + (1L << tier_[row]);
+}
+
+void ProcessTable::RefreshUpTimes(long systemUpTime) {
+  for (Row row = 0; row < Size(); ++row) {
+    long startTimeAfterBoot = startTime_[row] / kClockTicksPerSecond;
+    upTime_[row] = std::max(systemUpTime - startTimeAfterBoot, 0L);
+  }
+}
+
+void ProcessTable::Materialize(Row row) {
+  if (materialized_[row]) {
+    return;
+  }
+
+  // A process which has ended since leaves the attributes empty. The owner
+  // may already be known (see JoinGroups()).
+  materialized_[row] = true;
+  if (uid_[row] < 0) {
+    uid_[row] = LinuxParser::Uid(source_, pid_[row]);
+  }
+  user_[row] = strings_.Intern(Users::LookUpUserName(uid_[row]));
+  cmd_[row] = strings_.Intern(LinuxParser::Command(source_, pid_[row]));
+}
+
+unsigned long long ProcessTable::AvoidedReads() const {
+  return avoidedReads_;
+}
+
+// Reads Materialize() would still have to do
+size_t ProcessTable::PendingReads(Row row) const {
+  if (materialized_[row]) {
+    return 0;
+  }
+  return (uid_[row] < 0) ? 2 : 1;  // Owner and command line
+}
+
+void ProcessTable::RemoveEnded() {
+  // Iterate backwards so that the row moved into a removed row's place
+  // has already been visited
+  for (Row row = Size(); row-- > 0;) {
+    if (state_[row] == kEnded_) {
+      Remove(row);
+    }
+  }
+}
+
+// Remove a row by moving the last row into its place
+void ProcessTable::Remove(Row row) {
+  avoidedReads_ += PendingReads(row);
+  LeaveGroups(row);
+  strings_.Release(user_[row]);
+  strings_.Release(cmd_[row]);
+  index_.Erase(pid_[row]);
+
+  Row last = Size() - 1;
+  if (row != last) {
+    pid_[row] = pid_[last];
+    startTime_[row] = startTime_[last];
+    seen_[row] = seen_[last];
+    state_[row] = state_[last];
+    materialized_[row] = materialized_[last];
+    uid_[row] = uid_[last];
+    user_[row] = user_[last];
+    cmd_[row] = cmd_[last];
+    rss_[row] = rss_[last];
+    pss_[row] = pss_[last];
+    uss_[row] = uss_[last];
+    nextSmapsRefresh_[row] = nextSmapsRefresh_[last];
+    upTime_[row] = upTime_[last];
+    prevActiveJiffies_[row] = prevActiveJiffies_[last];
+    prevSystemJiffies_[row] = prevSystemJiffies_[last];
+    cpuUtilization_[row] = cpuUtilization_[last];
+    tier_[row] = tier_[last];
+    nextRefresh_[row] = nextRefresh_[last];
+    files_[row] = std::move(files_[last]);
+    for (auto& column : groupOf_) {
+      column[row] = column[last];
+    }
+    groupedCpu_[row] = groupedCpu_[last];
+    groupedRam_[row] = groupedRam_[last];
+    nextRejoin_[row] = nextRejoin_[last];
+    rejoinShift_[row] = rejoinShift_[last];
+    index_.Insert(pid_[row], row);
+  }
+
+  pid_.pop_back();
+  startTime_.pop_back();
+  seen_.pop_back();
+  state_.pop_back();
+  materialized_.pop_back();
+  uid_.pop_back();
+  user_.pop_back();
+  cmd_.pop_back();
+  rss_.pop_back();
+  pss_.pop_back();
+  uss_.pop_back();
+  nextSmapsRefresh_.pop_back();
+  upTime_.pop_back();
+  prevActiveJiffies_.pop_back();
+  prevSystemJiffies_.pop_back();
+  cpuUtilization_.pop_back();
+  tier_.pop_back();
+  nextRefresh_.pop_back();
+  files_.pop_back();
+  for (auto& column : groupOf_) {
+    column.pop_back();
+  }
+  groupedCpu_.pop_back();
+  groupedRam_.pop_back();
+  nextRejoin_.pop_back();
+  rejoinShift_.pop_back();
+}
+
+void ProcessTable::EnableGroups(bool enable) {
+  if (enable == grouped_) {
+    return;
+  }
+  grouped_ = enable;
+  for (Row row = 0; row < Size(); ++row) {
+    if (enable) {
+      JoinGroups(row);
+      RegroupRow(row);
+    } else {
+      for (auto& column : groupOf_) {
+        column[row] = GroupTable::kNoGroup_;
+      }
+    }
+  }
+  if (!enable) {
+    for (GroupTable& groups : groups_) {
+      groups.Clear();
+    }
+  }
+}
+
+bool ProcessTable::GroupsEnabled() const { return grouped_; }
+
+// Rows whose groups are due to be re-read (see Rejoin()) first move to
+// their new groups, if any
+size_t ProcessTable::Regroup(const std::vector<Row>& rows, long tick) {
+  size_t rejoined{0};
+  for (Row row : rows) {
+    if (grouped_ && (state_[row] == kAlive_) && (nextRejoin_[row] <= tick)) {
+      Rejoin(row);
+      nextRejoin_[row] = tick + (1L << rejoinShift_[row]);
+      if (rejoinShift_[row] < kMaxRejoinShift_) {
+        ++rejoinShift_[row];
+      }
+      ++rejoined;
+    }
+    RegroupRow(row);
+  }
+  return rejoined;
+}
+
+void ProcessTable::Regroup(Row begin, Row end) {
+  for (Row row = begin; row < end; ++row) {
+    RegroupRow(row);
+  }
+}
+
+const GroupTable& ProcessTable::Groups(Grouping grouping) const {
+  return groups_[grouping];
+}
+
+GroupTable::Group ProcessTable::GroupOf(Row row, Grouping grouping) const {
+  return groupOf_[grouping][row];
+}
+
+// A failed read (the process ended, or is a kernel thread, which has no
+// mappings) leaves the row as it was, but still waits 'interval' ticks
+bool ProcessTable::RefreshSmaps(Row row, long tick, long interval) {
+  nextSmapsRefresh_[row] = tick + interval;
+  LinuxParser::SmapsRollupSnapshot smaps;
+  if ((state_[row] != kAlive_) ||
+      !LinuxParser::ReadSmapsRollup(source_, pid_[row], smaps)) {
+    return false;
+  }
+  pss_[row] = smaps.pss;
+  uss_[row] = smaps.Uss();
+  return true;
+}
+
+// Read the process's cgroup and owner, and add it to their groups as it
+// stands (it's only counted once refreshed, for a new process)
+void ProcessTable::JoinGroups(Row row) {
+  if (!grouped_) {
+    return;
+  }
+  if (uid_[row] < 0) {
+    uid_[row] = LinuxParser::Uid(source_, pid_[row]);
+  }
+  groupOf_[kByCgroup_][row] = groups_[kByCgroup_].Intern(
+      LinuxParser::Cgroup(source_, pid_[row]));
+  groupOf_[kByUser_][row] =
+      groups_[kByUser_].Intern(Users::LookUpUserName(uid_[row]));
+
+  groupedCpu_[row] = 0;
+  groupedRam_[row] = 0;
+  for (int grouping = 0; grouping < kNumGroupings_; ++grouping) {
+    groups_[grouping].Join(groupOf_[grouping][row], 0, 0);
+  }
+  nextRejoin_[row] = 0;  // At its next refresh
+  rejoinShift_[row] = 0;
+}
+
+// Read the process's cgroup and owner again, and move what it counts for
+// to its new groups if either changed: container runtimes and systemd-run
+// start processes in their own cgroup and then migrate them, and a
+// process may change its UID. Returns false if it has ended.
+bool ProcessTable::Rejoin(Row row) {
+  int uid = LinuxParser::Uid(source_, pid_[row]);
+  string cgroup = LinuxParser::Cgroup(source_, pid_[row]);
+  if ((uid < 0) || cgroup.empty()) {
+    return false;
+  }
+  string user = Users::LookUpUserName(uid);
+  if (uid != uid_[row]) {
+    uid_[row] = uid;
+    if (materialized_[row]) {
+      strings_.Release(user_[row]);
+      user_[row] = strings_.Intern(user);
+    }
+  }
+
+  GroupTable::Group groups[kNumGroupings_];
+  groups[kByCgroup_] = groups_[kByCgroup_].Intern(cgroup);
+  groups[kByUser_] = groups_[kByUser_].Intern(user);
+  for (int grouping = 0; grouping < kNumGroupings_; ++grouping) {
+    GroupTable::Group& group = groupOf_[grouping][row];
+    if (groups[grouping] != group) {
+      groups_[grouping].Leave(group, groupedCpu_[row], groupedRam_[row]);
+      groups_[grouping].Join(groups[grouping], groupedCpu_[row],
+                             groupedRam_[row]);
+      group = groups[grouping];
+    }
+  }
+  return true;
+}
+
+void ProcessTable::LeaveGroups(Row row) {
+  for (int grouping = 0; grouping < kNumGroupings_; ++grouping) {
+    GroupTable::Group& group = groupOf_[grouping][row];
+    if (group != GroupTable::kNoGroup_) {
+      groups_[grouping].Leave(group, groupedCpu_[row], groupedRam_[row]);
+      group = GroupTable::kNoGroup_;
+    }
+  }
+}
+
+// Apply the change in the row's CPU and RAM since they were last counted
+void ProcessTable::RegroupRow(Row row) {
+  if (!grouped_) {
+    return;
+  }
+  long long cpu = std::llround(std::max(cpuUtilization_[row], 0.0f) *
+                               GroupTable::kCpuScale_);
+  long long ram = std::max(rss_[row], 0);
+  if ((cpu == groupedCpu_[row]) && (ram == groupedRam_[row])) {
+    return;
+  }
+  for (int grouping = 0; grouping < kNumGroupings_; ++grouping) {
+    groups_[grouping].Change(groupOf_[grouping][row], cpu - groupedCpu_[row],
+                             ram - groupedRam_[row]);
+  }
+  groupedCpu_[row] = cpu;
+  groupedRam_[row] = ram;
+}
+
+int ProcessTable::Pid(Row row) const { return pid_[row]; }
+
+float ProcessTable::CpuUtilization(Row row) const {
+  return cpuUtilization_[row];
+}
+
+// In MB, rounded (-1 until refreshed)
+int ProcessTable::Ram(Row row) const {
+  return (rss_[row] < 0) ? -1 : (rss_[row] + 512) / 1024;
+}
+
+int ProcessTable::Rss(Row row) const { return rss_[row]; }
+
+int ProcessTable::Pss(Row row) const { return pss_[row]; }
+
+int ProcessTable::Uss(Row row) const { return uss_[row]; }
+
+long ProcessTable::NextSmapsRefresh(Row row) const {
+  return nextSmapsRefresh_[row];
+}
+
+long ProcessTable::UpTime(Row row) const { return upTime_[row]; }
+
+unsigned long long ProcessTable::StartTime(Row row) const {
+  return startTime_[row];
+}
+
+unsigned long long ProcessTable::ActiveJiffies(Row row) const {
+  return prevActiveJiffies_[row];
+}
+
+int ProcessTable::Uid(Row row) const { return uid_[row]; }
+
+const string& ProcessTable::User(Row row) const {
+  return strings_.Get(user_[row]);
+}
+
+const string& ProcessTable::Command(Row row) const {
+  return strings_.Get(cmd_[row]);
+}
+
+bool ProcessTable::HasEnded(Row row) const { return state_[row] == kEnded_; }
+
+int ProcessTable::Tier(Row row) const { return tier_[row]; }
+
+long ProcessTable::NextRefresh(Row row) const { return nextRefresh_[row]; }
+
+PidFiles& ProcessTable::Files(Row row) { return files_[row]; }
+
+const std::vector<int>& ProcessTable::Pids() const { return pid_; }
+
+const std::vector<float>& ProcessTable::CpuUtilizations() const {
+  return cpuUtilization_;
+}
+
+long ProcessTable::LastRefresh(Row row) const {
+  return nextRefresh_[row] - (1L << tier_[row]);
+}
+
+const std::vector<int>& ProcessTable::Rams() const { return rss_; }
@@ -1,14 +1,29 @@
 #include "processor.h"
 
+#include "cpu_set.h"
 #include "linux_parser.h"
 
+Processor::Processor(const LinuxParser::StatSnapshot& stat) : stat_(stat) {}
+
 float Processor::Utilization() const { return utilization_; }
 
-unsigned long long Processor::ActiveJiffiesDelta() { return actvJiffiesDelta_; }
+unsigned long long Processor::ActiveJiffiesDelta() const {
+  return actvJiffiesDelta_;
+}
+
+unsigned long long Processor::JiffiesDelta() const { return jiffiesDelta_; }
+
+unsigned long long Processor::ActiveJiffies() const { return actvJiffiesPrev_; }
+
+const AlignedVector<float>& Processor::CoreUtilizations() const {
+  return cores_.Utilizations();
+}
+
+const CpuSet& Processor::Cores() const { return cores_; }
 
 void Processor::Refresh() {
-  unsigned long long actvJiffies = LinuxParser::ActiveJiffies();
-  unsigned long long idleJiffies = LinuxParser::IdleJiffies();
+  unsigned long long actvJiffies = stat_.total.Active();
+  unsigned long long idleJiffies = stat_.total.Idle();
 
   unsigned long long idleDelta = idleJiffies - idleJiffiesPrev_;
   unsigned long long actvDelta = actvJiffies - actvJiffiesPrev_;
@@ -19,4 +34,8 @@ void Processor::Refresh() {
   idleJiffiesPrev_ = idleJiffies;
   actvJiffiesPrev_ = actvJiffies;
   actvJiffiesDelta_ = actvDelta;
+  jiffiesDelta_ = totalDelta;
+
+  // Per-core utilization, over the same jiffy window
+  cores_.Update(stat_.cores);
 }
@@ -0,0 +1,132 @@
+#include "procfs_data_source.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+
+#include "linux_parser.h"
+
+using std::string;
+using std::vector;
+
+// The directory of the cgroup v2 'cgroup' under 'root', or "" for none
+static string FindCgroupDirectory(const string& root, const string& cgroup) {
+  if (cgroup.empty()) {
+    return string();
+  }
+  for (const string* mount : {&LinuxParser::kCgroupDirectory,
+                              &LinuxParser::kCgroupUnifiedDirectory}) {
+    string controllers =
+        root + *mount + LinuxParser::kCgroupControllersFilename;
+    if (access(controllers.c_str(), F_OK) == 0) {
+      return root + *mount + cgroup;
+    }
+  }
+  return root + LinuxParser::kCgroupDirectory + cgroup;
+}
+
+ProcfsDataSource::ProcfsDataSource(const string& root, const string& cgroup)
+    : procFd_(open((root + LinuxParser::kProcDirectory).c_str(),
+                   O_RDONLY | O_DIRECTORY | O_CLOEXEC)),
+      cgroupDirectory_(FindCgroupDirectory(root, cgroup)),
+      enumerator_(root + LinuxParser::kProcDirectory),
+      cgroupEnumerator_(cgroupDirectory_) {
+  const string proc{root + LinuxParser::kProcDirectory};
+  paths_[kProcStat_] = proc + LinuxParser::kStatFilename;
+  paths_[kProcMeminfo_] = proc + LinuxParser::kMeminfoFilename;
+  paths_[kProcUptime_] = proc + LinuxParser::kUptimeFilename;
+  paths_[kProcVersion_] = proc + LinuxParser::kVersionFilename;
+  paths_[kPidMax_] = proc + LinuxParser::kPidMaxFilename;
+  paths_[kOsRelease_] = root + LinuxParser::kOSPath;
+  paths_[kPasswd_] = root + LinuxParser::kPasswordPath;
+  if (!cgroupDirectory_.empty()) {
+    paths_[kCgroupCpuStat_] = cgroupDirectory_ + LinuxParser::kCpuStatFilename;
+    paths_[kCgroupMemoryCurrent_] =
+        cgroupDirectory_ + LinuxParser::kMemoryCurrentFilename;
+    paths_[kCgroupMemoryStat_] =
+        cgroupDirectory_ + LinuxParser::kMemoryStatFilename;
+    paths_[kCgroupIoStat_] = cgroupDirectory_ + LinuxParser::kIoStatFilename;
+  }
+}
+
+ProcfsDataSource::~ProcfsDataSource() {
+  if (procFd_ >= 0) {
+    close(procFd_);
+  }
+}
+
+bool ProcfsDataSource::IsOpen() const {
+  return (procFd_ >= 0) &&
+         (cgroupDirectory_.empty() || cgroupEnumerator_.IsOpen());
+}
+
+const string& ProcfsDataSource::CgroupDirectory() const {
+  return cgroupDirectory_;
+}
+
+// Files without a path (i.e. the cgroup's, when not scoped) don't exist
+bool ProcfsDataSource::ReadFile(SystemFile file, vector<char>& buffer) {
+  if (paths_[file].empty()) {
+    buffer.clear();
+    return false;
+  }
+  return LinuxParser::ReadFileIntoVector(paths_[file], buffer);
+}
+
+bool ProcfsDataSource::Stat(SystemFile file, struct stat& st) {
+  return stat(paths_[file].c_str(), &st) == 0;
+}
+
+bool ProcfsDataSource::Pids(vector<int>& pids) {
+  if (!cgroupDirectory_.empty()) {
+    return cgroupEnumerator_.Enumerate(pids);
+  }
+  return enumerator_.Enumerate(pids);
+}
+
+ssize_t ProcfsDataSource::ReadPidFile(PidFiles& files, PidFile file,
+                                      char* buffer, std::size_t size,
+                                      long tick) {
+  return files.Read(procFd_, file, buffer, size, tick);
+}
+
+bool ProcfsDataSource::ReadPidFile(int pid, const char* name,
+                                   vector<char>& buffer) {
+  char path[64];
+  std::snprintf(path, sizeof(path), "%d/%s", pid, name);
+  int fd = openat(procFd_, path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return false;
+  }
+  bool ok = LinuxParser::ReadFdIntoVector(fd, buffer);
+  close(fd);
+  return ok;
+}
+
+bool ProcfsDataSource::Tids(int pid, vector<int>& tids) {
+  char path[32];
+  std::snprintf(path, sizeof(path), "%d/task", pid);
+  return enumerator_.EnumerateAt(procFd_, path, tids);
+}
+
+// A thread which is gone reads as empty, as a process does
+ssize_t ProcfsDataSource::ReadTaskStat(int pid, int tid, char* buffer,
+                                       std::size_t size) {
+  char path[64];
+  std::snprintf(path, sizeof(path), "%d/task/%d/stat", pid, tid);
+  int fd = openat(procFd_, path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return ((errno == ENOENT) || (errno == ESRCH)) ? 0 : -1;
+  }
+  ssize_t n;
+  do {
+    n = read(fd, buffer, size);
+  } while ((n < 0) && (errno == EINTR));
+  if ((n < 0) && (errno == ESRCH)) {
+    n = 0;
+  }
+  close(fd);
+  return n;
+}
@@ -0,0 +1,168 @@
+#include "profiler.h"
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+
+using std::size_t;
+using std::string;
+
+namespace {
+const char* const kPhaseNames[kNumProfilePhases_] = {
+    "refresh", "system files", "enumerate", "parse",  "sweep",
+    "add new", "group",        "threads",   "smaps",  "sort",
+    "sample",  "draw"};
+
+// Counters of one phase; each is updated atomically, so a snapshot taken
+// while timers run may be off by the phase's last few samples
+struct Phase {
+  std::atomic<unsigned long long> count{0};
+  std::atomic<unsigned long long> totalNs{0};
+  std::atomic<unsigned long long> maxNs{0};
+  std::atomic<unsigned long long> userNs{0};
+  std::atomic<unsigned long long> systemNs{0};
+  std::atomic<unsigned long long> buckets[Profiler::kNumBuckets] = {};
+};
+
+Phase phases[kNumProfilePhases_];
+
+unsigned long long Nanoseconds(const timeval& time) {
+  return time.tv_sec * 1000000000ULL + time.tv_usec * 1000ULL;
+}
+
+// Return the CPU time used by all threads so far
+void CpuTime(unsigned long long& userNs, unsigned long long& systemNs) {
+  rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  userNs = Nanoseconds(usage.ru_utime);
+  systemNs = Nanoseconds(usage.ru_stime);
+}
+
+// Return the bucket of a 'ns' duration: its number of significant bits
+size_t Bucket(unsigned long long ns) {
+  size_t bucket = (ns == 0) ? 0 : 64 - __builtin_clzll(ns);
+  return std::min(bucket, Profiler::kNumBuckets - 1);
+}
+
+double Milliseconds(unsigned long long ns) { return ns / 1e6; }
+}  // namespace
+
+namespace Profiler {
+std::atomic<bool> enabled{false};
+
+void Enable(bool enable) { enabled.store(enable, std::memory_order_relaxed); }
+
+void Reset() {
+  for (Phase& phase : phases) {
+    phase.count = 0;
+    phase.totalNs = 0;
+    phase.maxNs = 0;
+    phase.userNs = 0;
+    phase.systemNs = 0;
+    for (auto& bucket : phase.buckets) {
+      bucket = 0;
+    }
+  }
+}
+
+const char* PhaseName(ProfilePhase phase) { return kPhaseNames[phase]; }
+
+void Record(ProfilePhase phase, unsigned long long ns,
+            unsigned long long userNs, unsigned long long systemNs) {
+  const auto relaxed = std::memory_order_relaxed;
+  Phase& counters = phases[phase];
+  counters.count.fetch_add(1, relaxed);
+  counters.totalNs.fetch_add(ns, relaxed);
+  counters.userNs.fetch_add(userNs, relaxed);
+  counters.systemNs.fetch_add(systemNs, relaxed);
+  counters.buckets[Bucket(ns)].fetch_add(1, relaxed);
+
+  unsigned long long max = counters.maxNs.load(relaxed);
+  while ((ns > max) && !counters.maxNs.compare_exchange_weak(max, ns)) {
+  }
+}
+
+void Snapshot(ProfilePhase phase, PhaseStats& stats) {
+  const Phase& counters = phases[phase];
+  stats.count = counters.count;
+  stats.totalNs = counters.totalNs;
+  stats.maxNs = counters.maxNs;
+  stats.userNs = counters.userNs;
+  stats.systemNs = counters.systemNs;
+  for (size_t bucket = 0; bucket < kNumBuckets; ++bucket) {
+    stats.buckets[bucket] = counters.buckets[bucket];
+  }
+}
+
+unsigned long long Percentile(const PhaseStats& stats, double fraction) {
+  unsigned long long rank = fraction * stats.count;
+  unsigned long long seen{0};
+  for (size_t bucket = 0; bucket < kNumBuckets; ++bucket) {
+    seen += stats.buckets[bucket];
+    if (seen > rank) {
+      return std::min(1ULL << bucket, stats.maxNs);
+    }
+  }
+  return stats.maxNs;
+}
+
+string Header() {
+  char line[128];
+  std::snprintf(line, sizeof(line), "%-12s %7s %9s %9s %9s %9s %9s %9s",
+                "phase", "count", "mean ms", "p50 ms", "p99 ms", "max ms",
+                "user ms", "sys ms");
+  return line;
+}
+
+// All times are per call, in milliseconds
+string FormatPhase(ProfilePhase phase, const PhaseStats& stats) {
+  char line[128];
+  unsigned long long count = std::max(stats.count, 1ULL);
+  std::snprintf(line, sizeof(line),
+                "%-12s %7llu %9.3f %9.3f %9.3f %9.3f %9.3f %9.3f",
+                PhaseName(phase), stats.count,
+                Milliseconds(stats.totalNs / count),
+                Milliseconds(Percentile(stats, 0.5)),
+                Milliseconds(Percentile(stats, 0.99)),
+                Milliseconds(stats.maxNs), Milliseconds(stats.userNs / count),
+                Milliseconds(stats.systemNs / count));
+  return line;
+}
+
+void Dump(std::FILE* file) {
+  std::fprintf(file, "%s\n", Header().c_str());
+  PhaseStats stats;
+  for (int phase = 0; phase < kNumProfilePhases_; ++phase) {
+    Snapshot((ProfilePhase)phase, stats);
+    if (stats.count > 0) {
+      std::fprintf(file, "%s\n",
+                   FormatPhase((ProfilePhase)phase, stats).c_str());
+    }
+  }
+}
+
+ScopedTimer::ScopedTimer(ProfilePhase phase)
+    : phase_(phase), active_(Enabled()) {
+  if (active_) {
+    CpuTime(userNs_, systemNs_);
+    clock_gettime(CLOCK_MONOTONIC, &start_);
+  }
+}
+
+ScopedTimer::~ScopedTimer() {
+  if (!active_) {
+    return;
+  }
+  timespec end;
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  unsigned long long userNs;
+  unsigned long long systemNs;
+  CpuTime(userNs, systemNs);
+
+  long long ns = (end.tv_sec - start_.tv_sec) * 1000000000LL +
+                 (end.tv_nsec - start_.tv_nsec);
+  Record(phase_, std::max(ns, 0LL), userNs - userNs_, systemNs - systemNs_);
+}
+}  // namespace Profiler
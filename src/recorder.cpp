@@ -0,0 +1,345 @@
+#include "recorder.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+
+using Recording::PutSigned;
+using Recording::PutVarint;
+using std::size_t;
+using std::uint32_t;
+using std::uint8_t;
+
+// The file is grown (at least) this much at a time
+static const size_t kInitialCapacity{16 << 20};
+
+static const long kClockTicksPerSecond{sysconf(_SC_CLK_TCK)};
+
+static std::uint64_t Fixed(float utilization) {
+  return (std::uint64_t)std::lround(
+      std::max(utilization, 0.0f) * Recording::kUtilizationScale);
+}
+
+Recorder::~Recorder() { Close(); }
+
+bool Recorder::Open(const std::string& path) {
+  Close();
+  fd_ = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd_ < 0) {
+    return false;
+  }
+  failed_ = false;
+  error_ = 0;
+  size_ = 0;
+  frames_ = 0;
+  strings_.clear();
+  pid_.clear();
+  startTime_.clear();
+  cpu_.clear();
+  ram_.clear();
+  seen_.clear();
+  index_ = PidIndex();
+
+  if (!Reserve(sizeof(Recording::kMagic))) {
+    int error = errno;
+    Close();
+    errno = error;
+    return false;
+  }
+  std::memcpy(map_, Recording::kMagic, sizeof(Recording::kMagic));
+  size_ = sizeof(Recording::kMagic);
+  return true;
+}
+
+bool Recorder::Close() {
+  bool ok{!failed_};
+  if (map_ != nullptr) {
+    munmap(map_, capacity_);
+    map_ = nullptr;
+  }
+  if (fd_ >= 0) {
+    // Drop the space reserved ahead of the contents
+    ok = (ftruncate(fd_, size_) == 0) && ok;
+    ok = (close(fd_) == 0) && ok;
+    fd_ = -1;
+  }
+  capacity_ = 0;
+  if (failed_) {
+    errno = error_;
+  }
+  return ok;
+}
+
+size_t Recorder::Bytes() const { return size_; }
+
+bool Recorder::Record(System& system) {
+  if ((fd_ < 0) || failed_) {
+    errno = EBADF;
+    return false;
+  }
+
+  bool keyframe = (frames_ % kKeyframeInterval) == 0;
+  system.FillSample(sample_, 0);
+  system.MaterializeProcesses();  // Births are recorded with their command
+  TrackProcesses(system.Processes(), keyframe);
+
+  // System columns
+  frame_.clear();
+  if (keyframe) {
+    PutVarint(frame_, sample_.timestampMs);
+  } else {
+    PutSigned(frame_, sample_.timestampMs - lastTimestampMs_);
+  }
+  lastTimestampMs_ = sample_.timestampMs;
+  PutSigned(frame_, sample_.upTime);
+  PutVarint(frame_, Fixed(sample_.cpuUtilization));
+  PutVarint(frame_, sample_.coreUtilizations.size());
+  for (float core : sample_.coreUtilizations) {
+    PutVarint(frame_, Fixed(core));
+  }
+  PutVarint(frame_, Fixed(sample_.memoryUtilization));
+  PutVarint(frame_, Fixed(sample_.swapUtilization));
+  PutVarint(frame_, sample_.memAvailable);
+  PutVarint(frame_, sample_.cached);
+  PutVarint(frame_, sample_.dirty);
+  PutVarint(frame_, sample_.slab);
+  PutSigned(frame_, sample_.totalProcesses);
+  PutSigned(frame_, sample_.runningProcesses);
+  PutSigned(frame_, sample_.blockedProcesses);
+  PutVarint(frame_, Intern(sample_.os));
+  PutVarint(frame_, Intern(sample_.kernel));
+
+  EncodeFrame(system.Processes());
+
+  ++frames_;
+  if (!Append(keyframe ? Recording::kKeyframe_ : Recording::kFrame_,
+              frame_.data(), frame_.size())) {
+    if (!failed_) {
+      failed_ = true;
+      error_ = errno;
+    }
+    Close();
+    errno = error_;
+    return false;
+  }
+  return true;
+}
+
+// Compare the table with what was recorded so far: collect the births and
+// changes in changes_ and the deaths in deaths_ (both sorted by PID), and
+// bring the recorded state up to date. For a keyframe, every process is
+// collected as a change.
+void Recorder::TrackProcesses(const ProcessTable& table, bool keyframe) {
+  changes_.clear();
+  deaths_.clear();
+
+  for (Row row = 0; row < table.Size(); ++row) {
+    if (table.HasEnded(row)) {
+      continue;
+    }
+    int pid = table.Pid(row);
+    unsigned long long startTime = table.StartTime(row);
+    std::uint64_t cpu = Fixed(table.CpuUtilization(row));
+    int ram = table.Ram(row);
+
+    uint32_t index = index_.Find(pid);
+    if (index == PidIndex::kNotFound_) {
+      index = pid_.size();
+      pid_.push_back(pid);
+      startTime_.push_back(startTime);
+      cpu_.push_back(cpu);
+      ram_.push_back(ram);
+      seen_.push_back(frames_);
+      index_.Insert(pid, index);
+      changes_.push_back({pid, row, true, 0, 0});
+      continue;
+    }
+
+    seen_[index] = frames_;
+    if (startTime_[index] != startTime) {
+      // The PID was reused: the old process ended, and a new one started
+      deaths_.push_back(pid);
+      startTime_[index] = startTime;
+      cpu_[index] = cpu;
+      ram_[index] = ram;
+      changes_.push_back({pid, row, true, 0, 0});
+      continue;
+    }
+
+    long long cpuDelta = (long long)cpu - (long long)cpu_[index];
+    int ramDelta = ram - ram_[index];
+    cpu_[index] = cpu;
+    ram_[index] = ram;
+    if (keyframe || (cpuDelta != 0) || (ramDelta != 0)) {
+      changes_.push_back({pid, row, false, cpuDelta, ramDelta});
+    }
+  }
+
+  // Iterating backwards, RemoveState() only moves entries already visited
+  for (uint32_t index = pid_.size(); index-- > 0;) {
+    if (seen_[index] != frames_) {
+      deaths_.push_back(pid_[index]);
+      RemoveState(index);
+    }
+  }
+
+  std::sort(changes_.begin(), changes_.end(),
+            [](const Change& a, const Change& b) { return a.pid < b.pid; });
+  std::sort(deaths_.begin(), deaths_.end());
+}
+
+// Append the death, birth and update columns to frame_
+void Recorder::EncodeFrame(const ProcessTable& table) {
+  bool keyframe = (frames_ % kKeyframeInterval) == 0;
+  auto isBirth = [keyframe](const Change& change) {
+    return keyframe || change.birth;
+  };
+
+  // A keyframe replaces all the replayed processes: no deaths needed
+  if (keyframe) {
+    deaths_.clear();
+  }
+  PutVarint(frame_, deaths_.size());
+  int previous{0};
+  for (int pid : deaths_) {
+    PutVarint(frame_, pid - previous);
+    previous = pid;
+  }
+
+  size_t births = std::count_if(changes_.begin(), changes_.end(), isBirth);
+  PutVarint(frame_, births);
+  previous = 0;
+  for (const Change& change : changes_) {
+    if (isBirth(change)) {
+      PutVarint(frame_, change.pid - previous);
+      previous = change.pid;
+    }
+  }
+  for (const Change& change : changes_) {
+    if (isBirth(change)) {
+      PutVarint(frame_, table.StartTime(change.row) / kClockTicksPerSecond);
+    }
+  }
+  for (const Change& change : changes_) {
+    if (isBirth(change)) {
+      PutVarint(frame_, Intern(table.User(change.row)));
+    }
+  }
+  for (const Change& change : changes_) {
+    if (isBirth(change)) {
+      PutVarint(frame_, Intern(table.Command(change.row)));
+    }
+  }
+  for (const Change& change : changes_) {
+    if (isBirth(change)) {
+      PutSigned(frame_, table.Ram(change.row));
+    }
+  }
+  for (const Change& change : changes_) {
+    if (isBirth(change)) {
+      PutVarint(frame_, Fixed(table.CpuUtilization(change.row)));
+    }
+  }
+
+  PutVarint(frame_, changes_.size() - births);
+  previous = 0;
+  for (const Change& change : changes_) {
+    if (!isBirth(change)) {
+      PutVarint(frame_, change.pid - previous);
+      previous = change.pid;
+    }
+  }
+  for (const Change& change : changes_) {
+    if (!isBirth(change)) {
+      PutSigned(frame_, change.cpuDelta);
+    }
+  }
+  for (const Change& change : changes_) {
+    if (!isBirth(change)) {
+      PutSigned(frame_, change.ramDelta);
+    }
+  }
+}
+
+// Remove an entry of the recorded state, moving the last one in its place
+void Recorder::RemoveState(uint32_t index) {
+  uint32_t last = pid_.size() - 1;
+  index_.Erase(pid_[index]);
+  if (index != last) {
+    pid_[index] = pid_[last];
+    startTime_[index] = startTime_[last];
+    cpu_[index] = cpu_[last];
+    ram_[index] = ram_[last];
+    seen_[index] = seen_[last];
+    index_.Insert(pid_[index], index);
+  }
+  pid_.pop_back();
+  startTime_.pop_back();
+  cpu_.pop_back();
+  ram_.pop_back();
+  seen_.pop_back();
+}
+
+// Id of 'text' in the recording, writing a string record the first time
+uint32_t Recorder::Intern(const std::string& text) {
+  if (text.empty()) {
+    return 0;
+  }
+  auto found = strings_.find(text);
+  if (found != strings_.end()) {
+    return found->second;
+  }
+  uint32_t id = strings_.size() + 1;
+  strings_.emplace(text, id);
+  if (!Append(Recording::kString_, (const uint8_t*)text.data(),
+              text.size()) &&
+      !failed_) {
+    failed_ = true;
+    error_ = errno;
+  }
+  return id;
+}
+
+bool Recorder::Append(Recording::RecordType type, const uint8_t* data,
+                      size_t length) {
+  if (failed_ || !Reserve(5 + length)) {
+    return false;
+  }
+  uint8_t* out = map_ + size_;
+  for (int byte = 0; byte < 4; ++byte) {
+    out[byte] = (uint8_t)(length >> (8 * byte));
+  }
+  out[4] = type;
+  std::memcpy(out + 5, data, length);
+  size_ += 5 + length;
+  return true;
+}
+
+// Make room for 'length' more bytes, growing the file and its mapping
+bool Recorder::Reserve(size_t length) {
+  if (size_ + length <= capacity_) {
+    return true;
+  }
+  size_t capacity = std::max(capacity_, kInitialCapacity);
+  while (capacity < size_ + length) {
+    capacity *= 2;
+  }
+  if (ftruncate(fd_, capacity) != 0) {
+    return false;
+  }
+  void* map = (map_ == nullptr)
+                  ? mmap(nullptr, capacity, PROT_READ | PROT_WRITE,
+                         MAP_SHARED, fd_, 0)
+                  : mremap(map_, capacity_, capacity, MREMAP_MAYMOVE);
+  if (map == MAP_FAILED) {
+    return false;
+  }
+  map_ = (uint8_t*)map;
+  capacity_ = capacity;
+  return true;
+}
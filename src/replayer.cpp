@@ -0,0 +1,309 @@
+#include "replayer.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <numeric>
+
+using Recording::Cursor;
+using std::size_t;
+using std::string;
+using std::uint32_t;
+using std::uint8_t;
+
+Replayer::~Replayer() {
+  if (map_ != nullptr) {
+    munmap(map_, mapSize_);
+  }
+}
+
+bool Replayer::Open(const string& path) {
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    error_ = path + ": " + std::strerror(errno);
+    return false;
+  }
+  struct stat status;
+  if (fstat(fd, &status) != 0) {
+    error_ = path + ": " + std::strerror(errno);
+    close(fd);
+    return false;
+  }
+  size_t size = status.st_size;
+  if ((size < sizeof(Recording::kMagic))) {
+    error_ = path + ": not a recording";
+    close(fd);
+    return false;
+  }
+  void* map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    error_ = path + ": " + std::strerror(errno);
+    return false;
+  }
+  map_ = (uint8_t*)map;
+  mapSize_ = size;
+  if (std::memcmp(map_, Recording::kMagic, sizeof(Recording::kMagic)) != 0) {
+    error_ = path + ": not a recording";
+    return false;
+  }
+
+  // Index the records; stop at the end marker or at a truncated record
+  strings_.assign(1, string());
+  frames_.clear();
+  size_t offset = sizeof(Recording::kMagic);
+  while (offset + 5 <= size) {
+    const uint8_t* header = map_ + offset;
+    size_t length = header[0] | (header[1] << 8) | (header[2] << 16) |
+                    ((size_t)header[3] << 24);
+    if ((length == 0) || (offset + 5 + length > size)) {
+      break;
+    }
+    const uint8_t* data = header + 5;
+    if (header[4] == Recording::kString_) {
+      strings_.emplace_back((const char*)data, length);
+    } else if ((header[4] == Recording::kFrame_) ||
+               (header[4] == Recording::kKeyframe_)) {
+      frames_.push_back(
+          {data, length, header[4] == Recording::kKeyframe_});
+    }
+    offset += 5 + length;
+  }
+  if (frames_.empty() || !frames_[0].keyframe) {
+    error_ = path + ": no frames recorded";
+    return false;
+  }
+
+  Cursor first{frames_[0].data, frames_[0].data + frames_[0].length};
+  firstTimestampMs_ = first.Varint();
+  return true;
+}
+
+const string& Replayer::Error() const { return error_; }
+
+size_t Replayer::NumFrames() const { return frames_.size(); }
+
+size_t Replayer::Position() const { return position_; }
+
+long long Replayer::ElapsedMs() const {
+  return sample_.timestampMs - firstTimestampMs_;
+}
+
+bool Replayer::Seek(size_t frame) {
+  if (frames_.empty()) {
+    return false;
+  }
+  frame = std::min(frame, frames_.size() - 1);
+  if (positioned_ && (frame == position_)) {
+    return true;
+  }
+
+  // Decode from the last keyframe at or before 'frame', unless the frame
+  // replayed is already past it
+  size_t start = frame;
+  while (!frames_[start].keyframe) {
+    --start;
+  }
+  if (positioned_ && (position_ < frame) && (position_ >= start)) {
+    start = position_ + 1;
+  }
+
+  for (size_t i = start; i <= frame; ++i) {
+    if (!Apply(frames_[i])) {
+      error_ = "corrupt frame " + std::to_string(i);
+      positioned_ = false;
+      Clear();
+      return false;
+    }
+  }
+  position_ = frame;
+  positioned_ = true;
+  return true;
+}
+
+// Decode one frame on top of the previous one (or, for a keyframe, from
+// scratch)
+bool Replayer::Apply(const FrameRef& frame) {
+  Cursor in{frame.data, frame.data + frame.length};
+  // Each varint takes at least one byte, which bounds counts and ids
+  auto count = [&in]() {
+    size_t value = in.Varint();
+    in.ok = in.ok && (value <= (size_t)(in.end - in.next));
+    return in.ok ? value : 0;
+  };
+  auto text = [&in, this]() -> const string& {
+    size_t id = in.Varint();
+    in.ok = in.ok && (id < strings_.size());
+    return strings_[in.ok ? id : 0];
+  };
+
+  if (frame.keyframe) {
+    Clear();
+    sample_.timestampMs = in.Varint();
+  } else {
+    sample_.timestampMs += in.Signed();
+  }
+  sample_.upTime = in.Signed();
+  sample_.cpuUtilization = in.Varint() / Recording::kUtilizationScale;
+  sample_.coreUtilizations.resize(count());
+  for (float& core : sample_.coreUtilizations) {
+    core = in.Varint() / Recording::kUtilizationScale;
+  }
+  sample_.memoryUtilization = in.Varint() / Recording::kUtilizationScale;
+  sample_.swapUtilization = in.Varint() / Recording::kUtilizationScale;
+  sample_.memAvailable = in.Varint();
+  sample_.cached = in.Varint();
+  sample_.dirty = in.Varint();
+  sample_.slab = in.Varint();
+  sample_.totalProcesses = in.Signed();
+  sample_.runningProcesses = in.Signed();
+  sample_.blockedProcesses = in.Signed();
+  sample_.os = text();
+  sample_.kernel = text();
+
+  // Deaths
+  int pid{0};
+  for (size_t i = count(); i > 0; --i) {
+    pid += in.Varint();
+    uint32_t row = index_.Find(pid);
+    if (row != PidIndex::kNotFound_) {
+      RemoveRow(row);
+    }
+  }
+
+  // Births, appended as rows [first, first + births)
+  size_t births = count();
+  size_t first = pid_.size();
+  pid = 0;
+  for (size_t i = 0; i < births; ++i) {
+    pid += in.Varint();
+    if (index_.Find(pid) != PidIndex::kNotFound_) {
+      return false;
+    }
+    index_.Insert(pid, pid_.size());
+    pid_.push_back(pid);
+  }
+  startTime_.resize(pid_.size());
+  user_.resize(pid_.size());
+  command_.resize(pid_.size());
+  ram_.resize(pid_.size());
+  fixedCpu_.resize(pid_.size());
+  cpu_.resize(pid_.size());
+  for (size_t row = first; row < pid_.size(); ++row) {
+    startTime_[row] = in.Varint();
+  }
+  for (size_t row = first; row < pid_.size(); ++row) {
+    user_[row] = in.Varint();
+    in.ok = in.ok && (user_[row] < strings_.size());
+  }
+  for (size_t row = first; row < pid_.size(); ++row) {
+    command_[row] = in.Varint();
+    in.ok = in.ok && (command_[row] < strings_.size());
+  }
+  for (size_t row = first; row < pid_.size(); ++row) {
+    ram_[row] = in.Signed();
+  }
+  for (size_t row = first; row < pid_.size(); ++row) {
+    fixedCpu_[row] = in.Varint();
+  }
+
+  // Updates
+  rows_.resize(count());
+  pid = 0;
+  for (uint32_t& row : rows_) {
+    pid += in.Varint();
+    row = index_.Find(pid);
+    if (row == PidIndex::kNotFound_) {
+      return false;
+    }
+  }
+  for (uint32_t row : rows_) {
+    fixedCpu_[row] += in.Signed();
+  }
+  for (uint32_t row : rows_) {
+    ram_[row] += in.Signed();
+  }
+
+  // Processes left out of this frame keep their CPU utilization
+  for (size_t row = 0; row < pid_.size(); ++row) {
+    cpu_[row] = fixedCpu_[row] / Recording::kUtilizationScale;
+  }
+  return in.ok;
+}
+
+void Replayer::FillSample(Sample& sample, size_t n) {
+  std::vector<ProcessSample> processes;
+  processes.swap(sample.processes);
+  sample = sample_;
+  sample.processes.swap(processes);
+  sample.numProcesses = pid_.size();
+
+  size_t size = pid_.size();
+  n = std::min(n, size);
+  rows_.resize(size);
+  std::iota(rows_.begin(), rows_.end(), 0);
+  RowOrder compare{cpu_, ram_, pid_, order_};
+  if (n < size) {
+    std::nth_element(rows_.begin(), rows_.begin() + n, rows_.end(), compare);
+  }
+  std::sort(rows_.begin(), rows_.begin() + n, compare);
+
+  sample.processes.resize(n);
+  for (size_t i = 0; i < n; ++i) {
+    uint32_t row = rows_[i];
+    ProcessSample& out = sample.processes[i];
+    out.pid = pid_[row];
+    out.user = strings_[user_[row]];
+    out.command = strings_[command_[row]];
+    out.cpuUtilization = cpu_[row];
+    out.ram = ram_[row];
+    out.upTime = std::max(sample_.upTime - startTime_[row], 0L);
+  }
+}
+
+void Replayer::ToggleProcessOrderByCpu() {
+  order_ = (order_ == kCpuDsc_) ? kCpuAsc_ : kCpuDsc_;
+}
+
+void Replayer::ToggleProcessOrderByMemory() {
+  order_ = (order_ == kMemoryDsc_) ? kMemoryAsc_ : kMemoryDsc_;
+}
+
+// Remove a row, moving the last row in its place
+void Replayer::RemoveRow(uint32_t row) {
+  uint32_t last = pid_.size() - 1;
+  index_.Erase(pid_[row]);
+  if (row != last) {
+    pid_[row] = pid_[last];
+    startTime_[row] = startTime_[last];
+    user_[row] = user_[last];
+    command_[row] = command_[last];
+    ram_[row] = ram_[last];
+    fixedCpu_[row] = fixedCpu_[last];
+    cpu_[row] = cpu_[last];
+    index_.Insert(pid_[row], row);
+  }
+  pid_.pop_back();
+  startTime_.pop_back();
+  user_.pop_back();
+  command_.pop_back();
+  ram_.pop_back();
+  fixedCpu_.pop_back();
+  cpu_.pop_back();
+}
+
+void Replayer::Clear() {
+  pid_.clear();
+  startTime_.clear();
+  user_.clear();
+  command_.clear();
+  ram_.clear();
+  fixedCpu_.clear();
+  cpu_.clear();
+  index_ = PidIndex();
+}
@@ -0,0 +1,132 @@
+#include "sampler.h"
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <system_error>
+
+using std::size_t;
+
+Sampler::Sampler(System& system, Recorder* recorder)
+    : system_(system), recorder_(recorder), recording_(recorder != nullptr) {}
+
+Sampler::~Sampler() {
+  if (thread_.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    wake_.notify_one();
+    thread_.join();
+  }
+  if (eventFd_ >= 0) {
+    close(eventFd_);
+  }
+}
+
+bool Sampler::Start() {
+  eventFd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (eventFd_ < 0) {
+    return false;
+  }
+  try {
+    thread_ = std::thread(&Sampler::Run, this);
+  } catch (const std::system_error& error) {
+    errno = error.code().value();
+    return false;
+  }
+  return true;
+}
+
+void Sampler::RequestRefresh() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    refresh_ = true;
+  }
+  wake_.notify_one();
+}
+
+void Sampler::SetRows(size_t n) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    publish_ = publish_ || (n > rows_);
+    rows_ = n;
+  }
+  wake_.notify_one();
+}
+
+void Sampler::SetVisible(const std::vector<int>& pids) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  visible_ = pids;
+}
+
+void Sampler::SetView(const ProcessView& view) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    view_ = view;
+    publish_ = true;
+  }
+  wake_.notify_one();
+}
+
+int Sampler::EventFd() const { return eventFd_; }
+
+bool Sampler::Update() {
+  std::uint64_t count;
+  while (read(eventFd_, &count, sizeof(count)) < 0 && errno == EINTR) {
+  }
+  return snapshots_.Update();
+}
+
+const Sample& Sampler::Snapshot() const { return snapshots_.Front(); }
+
+bool Sampler::Recording() const { return recording_.load(); }
+
+void Sampler::Run() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    wake_.wait(lock, [this] { return stop_ || refresh_ || publish_; });
+    if (stop_) {
+      break;
+    }
+    bool refresh = refresh_;
+    refresh_ = false;
+    publish_ = false;
+    if (refresh) {
+      system_.PinProcesses(visible_);
+    }
+    lock.unlock();
+
+    if (refresh) {
+      system_.Refresh();
+      refreshed_ = true;
+      if ((recorder_ != nullptr) && !recorder_->Record(system_)) {
+        recorder_ = nullptr;  // The recorder's owner reports the error
+        recording_ = false;
+      }
+    }
+    if (refreshed_) {
+      Publish();
+    }
+    lock.lock();
+  }
+}
+
+// Fill in and hand over a snapshot, then wake up the reader
+void Sampler::Publish() {
+  size_t rows;
+  ProcessView view;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    rows = rows_;
+    view = view_;
+  }
+  system_.FillSampleInAllOrders(snapshots_.Back(), rows, view);
+  snapshots_.Publish();
+
+  const std::uint64_t one{1};
+  while (write(eventFd_, &one, sizeof(one)) < 0 && errno == EINTR) {
+  }
+}
@@ -0,0 +1,53 @@
+#include "string_pool.h"
+
+#include <cassert>
+
+using std::string;
+
+StringPool::StringPool() : strings_{string()}, refCounts_{1} {}
+
+StringHandle StringPool::Intern(const string& value) {
+  if (value.empty()) {
+    return kEmpty_;
+  }
+
+  auto it = index_.find(value);
+  if (it != index_.end()) {
+    ++refCounts_[it->second];
+    return it->second;
+  }
+
+  StringHandle handle;
+  if (!free_.empty()) {
+    handle = free_.back();
+    free_.pop_back();
+    strings_[handle] = value;
+    refCounts_[handle] = 1;
+  } else {
+    handle = strings_.size();
+    strings_.push_back(value);
+    refCounts_.push_back(1);
+  }
+  index_.emplace(value, handle);
+  return handle;
+}
+
+void StringPool::Release(StringHandle handle) {
+  if (handle == kEmpty_) {
+    return;
+  }
+
+  assert(refCounts_[handle] > 0);
+  if (--refCounts_[handle] == 0) {
+    index_.erase(strings_[handle]);
+    strings_[handle].clear();
+    free_.push_back(handle);
+  }
+}
+
+const string& StringPool::Get(StringHandle handle) const {
+  return strings_[handle];
+}
+
+// Number of distinct strings currently interned (including the empty one)
+std::size_t StringPool::Size() const { return strings_.size() - free_.size(); }
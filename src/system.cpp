@@ -3,33 +3,313 @@
 #include <unistd.h>
 
 #include <algorithm>
-#include <cassert>
+#include <chrono>
 #include <cstddef>
+#include <limits>
+#include <numeric>
 #include <string>
 #include <vector>
 
 #include "linux_parser.h"
 #include "process.h"
 #include "processor.h"
+#include "profiler.h"
 
 using std::size_t;
 using std::sort;
 using std::string;
 using std::vector;
 
+// Processes are refreshed in chunks of (at least) this many, so that
+// threads spend their time refreshing rather than stealing work
+static const size_t kMinProcessesPerChunk{16};
+
+// PSS is read for (at most) this many of the largest processes, each at
+// most once every kSmapsInterval ticks (displayed ones on every tick)
+static const size_t kSmapsCandidates{256};
+static const long kSmapsInterval{8};
+
+// Syscalls reading a file without a cached descriptor takes: open, read
+// and close
+static const size_t kUncachedReadCost{3};
+
+// PIDs below this aren't allocated again once the kernel wraps around
+// (RESERVED_PIDS), and the PID space assumed if pid_max can't be read
+static const unsigned long long kReservedPids{300};
+static const long kDefaultPidMax{32768};
+// Ticks of fork counts kept by ReuseHorizon(), beyond the longest time
+// between two refreshes of a row within its tier
+static const size_t kForkHistory{4 << ProcessTable::kMaxTier_};
+
+System::System(DataSource& source, size_t numThreads)
+    : source_(source), pool_(numThreads) {}
+
 // Return the system's CPU
 Processor& System::Cpu() { return cpu_; }
 
 // Return the system's memory
 Memory& System::MemoryInfo() { return memory_; }
 
-// Return a container composed of the system's processes
-vector<Process>& System::Processes() { return processes_; }
+// Return the usage of the cgroup the source is scoped to
+CgroupUsage& System::CgroupInfo() { return cgroup_; }
+
+void System::SetCgroupName(const string& name) { cgroupName_ = name; }
+
+// Return the table holding the system's processes
+const ProcessTable& System::Processes() { return processes_; }
+
+// Return the rows of the 'n' first processes (or all, if there are fewer)
+// according to 'order'. Only those are sorted: the cost is O(P + n log n)
+// for P processes. The result is valid until the next call.
+const vector<Row>& System::TopProcesses(size_t n, ProcessOrder order) {
+  selected_rows_.resize(processes_.Size());
+  std::iota(selected_rows_.begin(), selected_rows_.end(), 0);
+  SelectTop(selected_rows_, n, order);
+  return selected_rows_;
+}
+
+// Keep the 'n' first of 'rows' according to 'order', sorted
+void System::SelectTop(vector<Row>& rows, size_t n, ProcessOrder order) {
+  PROFILE_SCOPE(kSort_);
+  n = std::min(n, rows.size());
+  RowOrder compare{processes_.CpuUtilizations(), processes_.Rams(),
+                   processes_.Pids(), order};
+  if (n < rows.size()) {
+    std::nth_element(rows.begin(), rows.begin() + n, rows.end(), compare);
+  }
+  sort(rows.begin(), rows.begin() + n, compare);
+  rows.resize(n);
+}
+
+// As above, using the current (user selected) order
+const vector<Row>& System::TopProcesses(size_t n) {
+  return TopProcesses(n, proc_order_);
+}
+
+// Return the rows of all processes, fully sorted according to 'order'
+const vector<Row>& System::SortedProcesses(ProcessOrder order) {
+  return TopProcesses(processes_.Size(), order);
+}
+
+// Copy the latest refresh into 'sample', keeping only the top 'n' processes
+// in the current order. Strings are assigned, so as to reuse the sample's
+// capacity from one tick to the next.
+void System::FillSample(Sample& sample, size_t n) {
+  PROFILE_SCOPE(kSample_);
+  FillSystemSample(sample);
+  FillProcessSamples(sample, TopProcesses(n));
+}
+
+// As above, keeping the top 'n' processes in every order (in no particular
+// order), so that the display can change order without a new sample. The
+// view may instead ask for every group, or only for the processes of one.
+// Groups are totalled from the first view which needs them on.
+void System::FillSampleInAllOrders(Sample& sample, size_t n,
+                                   const ProcessView& view) {
+  PROFILE_SCOPE(kSample_);
+  FillSystemSample(sample);
+  bool grouped = (view.grouping != kNumGroupings_);
+  if (grouped && !processes_.GroupsEnabled()) {
+    PROFILE_SCOPE(kGroup_);
+    processes_.EnableGroups(true);
+  }
+  if (grouped && !view.drillDown) {
+    FillGroupSamples(sample, view.grouping);
+    FillProcessSamples(sample, {});
+    sample.showThreads = false;
+    sample.threads.clear();
+    return;
+  }
+
+  sample.grouping = kNumGroupings_;
+  sample.groups.clear();
+  if (!grouped && view.threads) {
+    RefreshThreads(n);
+    FillProcessSamples(sample, threadRows_);
+    FillThreadSamples(sample);
+    return;
+  }
+  sample.showThreads = false;
+  sample.threads.clear();
+  if (threadsTick_ >= 0) {
+    threads_.Clear();  // Out of view: stale by the time it's back
+    threadsTick_ = -1;
+  }
+
+  groupRows_.clear();
+  if (grouped) {
+    GroupTable::Group group =
+        processes_.Groups(view.grouping).Find(view.group);
+    for (Row row = 0; row < processes_.Size(); ++row) {
+      if (processes_.GroupOf(row, view.grouping) == group) {
+        groupRows_.push_back(row);
+      }
+    }
+  }
+
+  candidateRows_.clear();
+  for (ProcessOrder order : {kCpuAsc_, kCpuDsc_, kMemoryAsc_, kMemoryDsc_}) {
+    if (grouped) {
+      selected_rows_ = groupRows_;
+      SelectTop(selected_rows_, n, order);
+    } else {
+      TopProcesses(n, order);
+    }
+    candidateRows_.insert(candidateRows_.end(), selected_rows_.begin(),
+                          selected_rows_.end());
+  }
+  sort(candidateRows_.begin(), candidateRows_.end());
+  candidateRows_.erase(
+      std::unique(candidateRows_.begin(), candidateRows_.end()),
+      candidateRows_.end());
+  FillProcessSamples(sample, candidateRows_);
+}
+
+void System::FillSystemSample(Sample& sample) {
+  using std::chrono::milliseconds;
+  using std::chrono::system_clock;
+  sample.timestampMs = std::chrono::duration_cast<milliseconds>(
+                           system_clock::now().time_since_epoch())
+                           .count();
+  sample.os = OperatingSystem();
+  sample.kernel = Kernel();
+  sample.cpuUtilization = cpu_.Utilization();
+  const AlignedVector<float>& cores = cpu_.CoreUtilizations();
+  sample.coreUtilizations.assign(cores.begin(), cores.end());
+  sample.memoryUtilization = memory_.Utilization();
+  sample.swapUtilization = memory_.SwapUtilization();
+  const LinuxParser::MeminfoSnapshot& meminfo = memory_.Snapshot();
+  sample.memAvailable = meminfo.memAvailable;
+  sample.cached = meminfo.cached;
+  sample.dirty = meminfo.dirty;
+  sample.slab = meminfo.slab;
+  FillCgroupSample(sample.cgroup);
+  sample.upTime = upTime_;
+  sample.totalProcesses = TotalProcesses();
+  sample.runningProcesses = RunningProcesses();
+  sample.blockedProcesses = BlockedProcesses();
+  sample.numProcesses = processes_.Size();
+  sample.smaps = (smapsBudgetMs_ > 0);
+}
+
+// Memory is in kB, as in /proc/meminfo
+void System::FillCgroupSample(CgroupSample& sample) {
+  sample.present = cgroup_.Present();
+  if (!sample.present) {
+    return;
+  }
+  const LinuxParser::CgroupSnapshot& cgroup = cgroup_.Snapshot();
+  sample.name = cgroupName_;
+  sample.cpuUtilization = cgroup_.Utilization();
+  sample.throttledPeriods = cgroup_.ThrottledPeriods();
+  sample.hasMemory = cgroup.hasMemory;
+  sample.memory = cgroup.memoryCurrent / 1024;
+  sample.anon = cgroup.anon / 1024;
+  sample.file = cgroup.file / 1024;
+  sample.hasIo = cgroup.hasIo;
+  sample.readRate = cgroup_.ReadRate() / 1024;
+  sample.writeRate = cgroup_.WriteRate() / 1024;
+}
+
+// Read the threads of the top processes by CPU, once per tick however
+// many samples are filled in it. Threads get a syscall budget of their own,
+// as large as processes', and the busiest processes' threads come first.
+void System::RefreshThreads(size_t n) {
+  if (threadsTick_ == tick_) {
+    return;
+  }
+  PROFILE_SCOPE(kThreads_);
+  threadRows_ = TopProcesses((threadScope_ > 0) ? threadScope_ : n, kCpuDsc_);
+  threadPids_.clear();
+  threadProcesses_.clear();
+  for (Row row : threadRows_) {
+    threadProcesses_.emplace_back(processes_.Pid(row), threadPids_.size());
+    threadPids_.push_back(processes_.Pid(row));
+  }
+  sort(threadProcesses_.begin(), threadProcesses_.end());
+  threads_.Refresh(threadPids_, cpu_.ActiveJiffies(), syscallBudget_);
+  threadsTick_ = tick_;
+}
+
+// The threads of the processes in the sample, each pointing to its
+// process (names are assigned, as in FillSample())
+void System::FillThreadSamples(Sample& sample) {
+  sample.showThreads = true;
+  size_t count{0};
+  for (Row row = 0; row < threads_.Size(); ++row) {
+    auto process = std::lower_bound(
+        threadProcesses_.begin(), threadProcesses_.end(),
+        std::make_pair(threads_.Pid(row), size_t{0}));
+    if ((process == threadProcesses_.end()) ||
+        (process->first != threads_.Pid(row))) {
+      continue;  // Not one of this tick's processes (not expected)
+    }
+    if (count == sample.threads.size()) {
+      sample.threads.emplace_back();
+    }
+    ThreadSample& out = sample.threads[count++];
+    out.tid = threads_.Tid(row);
+    out.process = process->second;
+    out.name = threads_.Name(row);
+    out.state = threads_.State(row);
+    out.cpuUtilization = threads_.CpuUtilization(row);
+    out.stale = !threads_.Current(row);
+  }
+  sample.threads.resize(count);
+}
+
+void System::SetThreadScope(size_t scope) { threadScope_ = scope; }
+
+void System::SetSmapsBudget(size_t budgetMs) { smapsBudgetMs_ = budgetMs; }
+
+// Every group with processes, as totalled so far (names are assigned, as
+// in FillSample())
+void System::FillGroupSamples(Sample& sample, Grouping grouping) {
+  const GroupTable& groups = processes_.Groups(grouping);
+  sample.grouping = grouping;
+  size_t count{0};
+  for (GroupTable::Group group = 0; group < groups.Size(); ++group) {
+    if (groups.IsEmpty(group)) {
+      continue;
+    }
+    if (count == sample.groups.size()) {
+      sample.groups.emplace_back();
+    }
+    GroupSample& out = sample.groups[count++];
+    out.name = groups.Name(group);
+    out.processes = groups.Processes(group);
+    out.cpuUtilization = (float)groups.Cpu(group) / GroupTable::kCpuScale_;
+    out.ram = (groups.Ram(group) + 512) / 1024;
+  }
+  sample.groups.resize(count);
+}
+
+// Only the processes copied into the sample have their user and command
+// read
+void System::FillProcessSamples(Sample& sample, const vector<Row>& rows) {
+  MaterializeProcesses(rows);
+  sample.readsAvoided = processes_.AvoidedReads();
+  sample.processes.resize(rows.size());
+  for (size_t i = 0; i < rows.size(); ++i) {
+    Process process(processes_, rows[i]);
+    ProcessSample& out = sample.processes[i];
+    out.pid = process.Pid();
+    out.user = processes_.User(rows[i]);
+    out.command = processes_.Command(rows[i]);
+    out.cpuUtilization = process.CpuUtilization();
+    out.ram = process.RamAsInt();
+    int pss = processes_.Pss(rows[i]);
+    int uss = processes_.Uss(rows[i]);
+    out.pss = (pss < 0) ? -1 : (pss + 512) / 1024;
+    out.uss = (uss < 0) ? -1 : (uss + 512) / 1024;
+    out.upTime = process.UpTime();
+  }
+}
 
 // Return the system's kernel identifier (string)
 std::string System::Kernel() {
   if (kernel_.length() == 0U) {
-    kernel_ = LinuxParser::Kernel();
+    kernel_ = LinuxParser::Kernel(source_);
   }
   return kernel_;
 }
@@ -37,98 +317,359 @@ std::string System::Kernel() {
 // Return the operating system name
 std::string System::OperatingSystem() {
   if (os_.length() == 0U) {
-    os_ = LinuxParser::OperatingSystem();
+    os_ = LinuxParser::OperatingSystem(source_);
   }
   return os_;
 }
 
 // Return the number of processes actively running on the system
-int System::RunningProcesses() { return proc_running_; }
+int System::RunningProcesses() { return stat_.procsRunning; }
+
+// Return the number of processes blocked waiting for I/O
+int System::BlockedProcesses() { return stat_.procsBlocked; }
 
 // Return the total number of processes on the system
-int System::TotalProcesses() { return proc_total_; }
+int System::TotalProcesses() { return stat_.forks; }
+
+// Return the number of context switches since boot
+unsigned long long System::ContextSwitches() { return stat_.ctxt; }
+
+// Return the number of interrupts serviced since boot
+unsigned long long System::Interrupts() { return stat_.intr; }
 
 // Return the number of seconds since the system started running
 long System::UpTime() { return upTime_; }
 
 void System::Refresh() {
-  // System up time
-  upTime_ = LinuxParser::UpTime();
+  PROFILE_SCOPE(kRefresh_);
+  ++tick_;
+
+  {
+    PROFILE_SCOPE(kSystemFiles_);
+
+    // System up time
+    upTime_ = LinuxParser::UpTime(source_);
+
+    // Pick up any changes to the password file before resolving user names
+    Users::Revalidate(source_);
+
+    // Read /proc/stat once; the CPU and process counters all come from it
+    LinuxParser::ReadStat(source_, stat_);
 
-  // Refresh cached CPU & memory data
-  cpu_.Refresh();
-  memory_.Refresh();
+    // Refresh cached CPU & memory data
+    cpu_.Refresh();
+    memory_.Refresh();
 
-  // Refress processes data
-  proc_running_ = LinuxParser::RunningProcesses();
-  proc_total_ = LinuxParser::TotalProcesses();
+    // The scoped cgroup's totals, from its own files
+    cgroup_.Refresh();
+  }
+
+  // Refresh processes data (sorting is left to TopProcesses(), since only
+  // the rows being displayed need to be ordered)
   RefreshProcesses();
-  SortProcesses();
+  RefreshSmaps();
 }
 
 void System::RefreshProcesses() {
-  // Purge any processes that have ended
-  processes_.erase(std::remove_if(processes_.begin(), processes_.end(),
-                                  [](Process& p) { return p.HasEnded(); }),
-                   processes_.end());
+  // Find out which processes were born or have died since the last tick
+  ReconcilePids();
 
-  // Get new PIDs and add processes for those
-  PopulateNewProcesses();
+  // Refresh data for the cached processes which are due. This also finds
+  // the processes that ended since the enumeration, and PIDs that have
+  // been reused by new processes.
+  ScheduleRefreshes();
+  RefreshProcessRows(dueRows_);
+  {
+    PROFILE_SCOPE(kGroup_);
+    size_t rejoined = processes_.Regroup(dueRows_, tick_);
+    addBudget_ -= std::min(addBudget_, rejoined * JoinCost());
+  }
+  processes_.RefreshUpTimes(upTime_);
+  {
+    PROFILE_SCOPE(kSweep_);
+    size_t reused = processes_.ResetReused();
+    addBudget_ -= std::min(addBudget_, reused * JoinCost());
 
-  unsigned long long systemActiveJiffiesDelta = cpu_.ActiveJiffiesDelta();
+    // Purge any processes that have ended
+    processes_.RemoveEnded();
+  }
 
-  // Refresh data for all active processes
-  for (auto& p : processes_) {
-    p.Refresh(upTime_, systemActiveJiffiesDelta);
+  // Add processes for the new PIDs
+  {
+    PROFILE_SCOPE(kAddNew_);
+    size_t numCached = processes_.Size();
+    AddNewProcesses();
+    processes_.Regroup(numCached, processes_.Size());
   }
+
+  EnforceDescriptorBudget();
 }
 
-void System::PopulateNewProcesses() {
-  vector<int> activePids = GetSortedActiveProcessPids();
-  vector<int> cachedPids = GetSortedCachedProcessPids();
+// Read PSS and USS within the time budget: smaps_rollup walks every
+// mapping of the process, and a large one can take milliseconds. The
+// displayed processes come first, then the largest resident sets that are
+// due; whatever doesn't fit waits for the next tick.
+void System::RefreshSmaps() {
+  if (smapsBudgetMs_ == 0) {
+    return;
+  }
+  PROFILE_SCOPE(kSmaps_);
+  using Clock = std::chrono::steady_clock;
+  Clock::time_point deadline =
+      Clock::now() + std::chrono::milliseconds(smapsBudgetMs_);
 
-  vector<int> newPids;
-  std::set_difference(activePids.begin(), activePids.end(), cachedPids.begin(),
-                      cachedPids.end(),
-                      std::inserter(newPids, newPids.begin()));
+  smapsRows_.clear();
+  for (int pid : pinnedPids_) {
+    Row row = processes_.Find(pid);
+    if ((row != PidIndex::kNotFound_) && !processes_.HasEnded(row)) {
+      smapsRows_.push_back(row);
+    }
+  }
+  size_t numPinned = smapsRows_.size();
+  for (Row row : TopProcesses(kSmapsCandidates, kMemoryDsc_)) {
+    if ((processes_.NextSmapsRefresh(row) <= tick_) &&
+        (std::find(smapsRows_.begin(), smapsRows_.begin() + numPinned,
+                   row) == smapsRows_.begin() + numPinned)) {
+      smapsRows_.push_back(row);
+    }
+  }
 
-  for (auto pid : newPids) {
-    processes_.push_back(Process(pid));
+  for (Row row : smapsRows_) {
+    if (Clock::now() >= deadline) {
+      break;
+    }
+    processes_.RefreshSmaps(row, tick_, kSmapsInterval);
   }
 }
 
-vector<int> System::GetSortedCachedProcessPids() {
-  vector<int> pids;
-  for (auto p : processes_) {
-    pids.push_back(p.Pid());
+// A single pass over the PIDs in /proc: PIDs found in the process table are
+// marked as seen in this tick's generation, the rest are new. Rows that
+// were not seen belong to processes that have ended.
+void System::ReconcilePids() {
+  PROFILE_SCOPE(kEnumerate_);
+  source_.Pids(activePids_);
+
+  newPids_.clear();
+  for (int pid : activePids_) {
+    Row row = processes_.Find(pid);
+    if (row == PidIndex::kNotFound_) {
+      newPids_.push_back(pid);
+    } else {
+      processes_.MarkSeen(row, tick_);
+    }
   }
-  sort(pids.begin(), pids.end());
-  return pids;
+  processes_.MarkUnseenAsEnded(tick_);
 }
 
-vector<int> System::GetSortedActiveProcessPids() {
-  vector<int> pids = LinuxParser::Pids();
-  sort(pids.begin(), pids.end());
-  return pids;
+// Pick the cached processes to refresh this tick into dueRows_, within the
+// syscall budget: pinned (i.e. displayed) processes always, then the rows
+// which are due, the longest overdue first whatever their tier, so that
+// rows left over come earlier next time. Rows whose PID may have been
+// reused since their last refresh (see ReuseHorizon()) are due too.
+// Adding new processes also comes out of the budget, and gets up to half
+// of what the pinned rows leave (see AddNewProcesses()).
+void System::ScheduleRefreshes() {
+  dueRows_.clear();
+  addBudget_ = std::numeric_limits<size_t>::max();
+  if (!tiered_) {
+    dueRows_.resize(processes_.Size());
+    std::iota(dueRows_.begin(), dueRows_.end(), 0);
+    return;
+  }
+
+  size_t spent{0};
+  for (int pid : pinnedPids_) {
+    Row row = processes_.Find(pid);
+    if ((row != PidIndex::kNotFound_) && !processes_.HasEnded(row)) {
+      dueRows_.push_back(row);
+      spent += RefreshCost(row);
+    }
+  }
+  sort(dueRows_.begin(), dueRows_.end());
+  dueRows_.erase(std::unique(dueRows_.begin(), dueRows_.end()),
+                 dueRows_.end());
+  size_t numPinned = dueRows_.size();
+
+  long horizon = ReuseHorizon();
+  overdueRows_.clear();
+  size_t cost{0};
+  for (Row row = 0; row < processes_.Size(); ++row) {
+    if (((processes_.NextRefresh(row) <= tick_) ||
+         (processes_.LastRefresh(row) <= horizon)) &&
+        !processes_.HasEnded(row) &&
+        !std::binary_search(dueRows_.begin(), dueRows_.begin() + numPinned,
+                            row)) {
+      overdueRows_.push_back(row);
+      cost += RefreshCost(row);
+    }
+  }
+
+  size_t left = (spent < syscallBudget_) ? (syscallBudget_ - spent) : 0;
+  size_t addCost = newPids_.size() * AddCost();
+  if ((syscallBudget_ == 0) || (cost + addCost <= left)) {
+    dueRows_.insert(dueRows_.end(), overdueRows_.begin(), overdueRows_.end());
+    if (syscallBudget_ > 0) {
+      addBudget_ = left - cost;
+    }
+    return;
+  }
+
+  // Over budget: the longest overdue first (hotter tiers first among
+  // equals), once new processes have had their share
+  addBudget_ =
+      std::min(addCost, std::max(left / 2, left - std::min(cost, left)));
+  left -= addBudget_;
+  sort(overdueRows_.begin(), overdueRows_.end(), [this](Row a, Row b) {
+    if (processes_.NextRefresh(a) != processes_.NextRefresh(b)) {
+      return processes_.NextRefresh(a) < processes_.NextRefresh(b);
+    }
+    return processes_.Tier(a) < processes_.Tier(b);
+  });
+  for (Row row : overdueRows_) {
+    if (RefreshCost(row) > left) {
+      break;
+    }
+    dueRows_.push_back(row);
+    left -= RefreshCost(row);
+  }
+  addBudget_ += left;
 }
 
-void System::SortProcesses() {
-  if (proc_order_ == ProcessOrder::kCpuAsc_) {
-    sort(processes_.begin(), processes_.end(), [](Process& a, Process& b) {
-      return a.CpuUtilization() < b.CpuUtilization();
-    });
-  } else if (proc_order_ == ProcessOrder::kCpuDsc_) {
-    sort(processes_.begin(), processes_.end(), [](Process& a, Process& b) {
-      return a.CpuUtilization() > b.CpuUtilization();
-    });
-  } else if (proc_order_ == ProcessOrder::kMemoryAsc_) {
-    sort(processes_.begin(), processes_.end(),
-         [](Process& a, Process& b) { return a.RamAsInt() < b.RamAsInt(); });
-  } else {
-    assert(proc_order_ == ProcessOrder::kMemoryDsc_);
-    sort(processes_.begin(), processes_.end(),
-         [](Process& a, Process& b) { return a.RamAsInt() > b.RamAsInt(); });
+// A PID is only reused once the kernel's allocator has wrapped around,
+// which takes at least as many forks as there are free PIDs: returns the
+// latest tick since which that many processes (or threads) were forked, so
+// that a row last refreshed then or earlier may now hold another process
+// than it shows. -1 if there's no such tick.
+long System::ReuseHorizon() {
+  if (pidMax_ == 0) {
+    pidMax_ = LinuxParser::PidMax(source_);
+    if (pidMax_ == 0) {
+      pidMax_ = kDefaultPidMax;
+    }
+  }
+  unsigned long long used = kReservedPids + activePids_.size();
+  unsigned long long wrap =
+      ((unsigned long long)pidMax_ > used) ? (pidMax_ - used) : 1;
+
+  unsigned long long forks = stat_.forks;
+  forkHistory_.emplace_back(tick_, forks);
+  long horizon{-1};
+  size_t crossed{0};
+  while ((crossed < forkHistory_.size()) &&
+         (forks - forkHistory_[crossed].second >= wrap)) {
+    horizon = forkHistory_[crossed].first;
+    ++crossed;
+  }
+  // Only the latest tick of those matters from now on
+  if (crossed > 1) {
+    forkHistory_.erase(forkHistory_.begin(),
+                       forkHistory_.begin() + (crossed - 1));
   }
+  if (forkHistory_.size() > kForkHistory) {
+    forkHistory_.erase(forkHistory_.begin());
+  }
+  return horizon;
+}
+
+// Syscalls a refresh of the row takes: a pread() of its cached stat
+// descriptor or, without one, opening and closing it too
+size_t System::RefreshCost(Row row) {
+  return (processes_.Files(row).OpenCount() > 0) ? 1 : kUncachedReadCost;
+}
+
+// Syscalls adding a process takes: opening its directory and stat file,
+// and reading it, plus reading its cgroup and owner if grouped
+size_t System::AddCost() const {
+  return kUncachedReadCost + JoinCost();
+}
+
+// Syscalls reading a process's cgroup and owner takes, if grouped (when a
+// PID is reused, or its groups are re-read)
+size_t System::JoinCost() const {
+  return processes_.GroupsEnabled() ? 2 * kUncachedReadCost : 0;
+}
+
+// Refresh the given rows concurrently on the thread pool
+void System::RefreshProcessRows(const vector<Row>& rows) {
+  PROFILE_SCOPE(kParse_);
+  unsigned long long systemActiveJiffies = cpu_.ActiveJiffies();
+  size_t grain =
+      std::max(kMinProcessesPerChunk, rows.size() / (8 * pool_.Size()) + 1);
+
+  pool_.ParallelFor(rows.size(), grain, [&](size_t first, size_t last) {
+    for (size_t i = first; i < last; ++i) {
+      processes_.Refresh(rows[i], upTime_, systemActiveJiffies, tick_);
+    }
+  });
+  refreshedRows_ = rows.size();
+}
+
+// Close the cached descriptors of the least recently used processes once
+// we get close to the descriptor budget, so that there's room to cache the
+// files of newly started processes
+void System::EnforceDescriptorBudget() {
+  const size_t budget = PidFiles::DescriptorBudget();
+  size_t inUse = PidFiles::DescriptorsInUse();
+  if (10 * inUse <= 9 * budget) {
+    return;
+  }
+
+  lruRows_.clear();
+  for (Row row = 0; row < processes_.Size(); ++row) {
+    if (processes_.Files(row).OpenCount() > 0) {
+      lruRows_.push_back(row);
+    }
+  }
+  sort(lruRows_.begin(), lruRows_.end(), [this](Row a, Row b) {
+    return processes_.Files(a).LastUsed() < processes_.Files(b).LastUsed();
+  });
+
+  for (auto it = lruRows_.begin();
+       (it != lruRows_.end()) && (4 * inUse > 3 * budget); ++it) {
+    PidFiles& files = processes_.Files(*it);
+    inUse -= files.OpenCount();
+    files.Close();
+  }
+}
+
+// Add the processes of the new PIDs, as many as addBudget_ allows: the
+// others are found again by the next enumeration
+void System::AddNewProcesses() {
+  processes_.Reserve(processes_.Size() + newPids_.size());
+  for (auto pid : newPids_) {
+    if (AddCost() > addBudget_) {
+      break;
+    }
+    addBudget_ -= AddCost();
+    // No-op if it has already ended
+    if (processes_.Add(pid, tick_, upTime_, cpu_.ActiveJiffies())) {
+      ++refreshedRows_;
+    }
+  }
+}
+
+void System::EnableTiers(bool enable) { tiered_ = enable; }
+
+void System::SetSyscallBudget(size_t budget) { syscallBudget_ = budget; }
+
+void System::PinProcesses(const vector<int>& pids) { pinnedPids_ = pids; }
+
+size_t System::RefreshedProcesses() const { return refreshedRows_; }
+
+void System::MaterializeProcesses(const vector<Row>& rows) {
+  for (Row row : rows) {
+    processes_.Materialize(row);
+  }
+}
+
+void System::MaterializeProcesses() {
+  for (Row row = 0; row < processes_.Size(); ++row) {
+    processes_.Materialize(row);
+  }
+}
+
+unsigned long long System::LazyReadsAvoided() const {
+  return processes_.AvoidedReads();
 }
 
 void System::ToggleProcessOrderByCpu() {
@@ -148,3 +689,5 @@ void System::ToggleProcessOrderByMemory() {
     proc_order_ = kMemoryDsc_;
   }
 }
+
+ProcessOrder System::GetProcessOrder() const { return proc_order_; }
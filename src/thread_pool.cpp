@@ -0,0 +1,116 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+
+using std::size_t;
+
+ThreadPool::ThreadPool(size_t numThreads) {
+  numThreads = std::max<size_t>(numThreads, 1);
+  for (size_t i = 0; i < numThreads; ++i) {
+    queues_.push_back(std::make_unique<Queue>());
+  }
+  // Queue 0 belongs to the thread calling ParallelFor()
+  for (size_t i = 1; i < numThreads; ++i) {
+    workers_.emplace_back(&ThreadPool::WorkerLoop, this, i);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  wake_.notify_all();
+  for (auto& worker : workers_) {
+    worker.join();
+  }
+}
+
+size_t ThreadPool::Size() const { return queues_.size(); }
+
+void ThreadPool::ParallelFor(size_t count, size_t grain,
+                             const RangeFunction& body) {
+  if (count == 0) {
+    return;
+  }
+  grain = std::max<size_t>(grain, 1);
+  if (workers_.empty() || (count <= grain)) {
+    body(0, count);
+    return;
+  }
+
+  // Deal the chunks out to all queues
+  size_t numChunks = (count + grain - 1) / grain;
+  body_ = &body;
+  pending_.store(numChunks);
+  for (size_t chunk = 0; chunk < numChunks; ++chunk) {
+    Queue& queue = *queues_[chunk % queues_.size()];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    queue.ranges.push_back(
+        {chunk * grain, std::min(count, (chunk + 1) * grain)});
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++generation_;
+  }
+  wake_.notify_all();
+
+  RunTasks(0);
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  done_.wait(lock, [this]() { return pending_.load() == 0; });
+  body_ = nullptr;
+}
+
+void ThreadPool::WorkerLoop(size_t self) {
+  unsigned long seen{0};
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      wake_.wait(lock,
+                 [this, seen]() { return stop_ || (generation_ != seen); });
+      if (stop_) {
+        return;
+      }
+      seen = generation_;
+    }
+    RunTasks(self);
+  }
+}
+
+void ThreadPool::RunTasks(size_t self) {
+  Range range;
+  while (PopLocal(self, range) || Steal(self, range)) {
+    (*body_)(range.begin, range.end);
+    if (pending_.fetch_sub(1) == 1) {
+      // Last chunk: wake up the thread waiting in ParallelFor()
+      std::lock_guard<std::mutex> lock(mutex_);
+      done_.notify_all();
+    }
+  }
+}
+
+bool ThreadPool::PopLocal(size_t self, Range& range) {
+  Queue& queue = *queues_[self];
+  std::lock_guard<std::mutex> lock(queue.mutex);
+  if (queue.ranges.empty()) {
+    return false;
+  }
+  range = queue.ranges.back();
+  queue.ranges.pop_back();
+  return true;
+}
+
+bool ThreadPool::Steal(size_t self, Range& range) {
+  for (size_t i = 1; i < queues_.size(); ++i) {
+    Queue& victim = *queues_[(self + i) % queues_.size()];
+    std::lock_guard<std::mutex> lock(victim.mutex);
+    if (!victim.ranges.empty()) {
+      range = victim.ranges.front();
+      victim.ranges.pop_front();
+      return true;
+    }
+  }
+  return false;
+}
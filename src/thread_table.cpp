@@ -0,0 +1,184 @@
+#include "thread_table.h"
+
+#include <algorithm>
+
+using std::size_t;
+using std::vector;
+
+// Listing a process's threads takes an open, two getdents64() and a close;
+// reading a thread, an open, a read and a close
+static const size_t kListCost{4};
+static const size_t kReadCost{3};
+
+ThreadTable::ThreadTable(DataSource& source) : source_(source) {}
+
+// Processes are read in turn, from where the previous Refresh() ran out of
+// budget (possibly halfway through a process's threads), so that with too
+// small a budget every thread still gets read eventually. At least one
+// thread is read, however small the budget.
+size_t ThreadTable::Refresh(const vector<int>& pids,
+                            unsigned long long systemActiveJiffies,
+                            size_t budget) {
+  ++generation_;
+  skipped_.clear();
+  size_t first{0};
+  size_t offset{0};  // Of the first process's first thread to read
+  auto resume = std::find(pids.begin(), pids.end(), resumePid_);
+  if (resume != pids.end()) {
+    first = resume - pids.begin();
+    offset = resumeOffset_;
+  }
+  resumePid_ = 0;
+  resumeOffset_ = 0;
+  if (offset > 0) {
+    skipped_.push_back(pids[first]);  // Its first threads were read before
+  }
+
+  size_t spent{0};
+  size_t count{0};
+  auto affordable = [&](size_t cost) {
+    return (budget == 0) || (count == 0) || (spent + cost <= budget);
+  };
+  for (size_t n = 0; n < pids.size(); ++n) {
+    int pid = pids[(first + n) % pids.size()];
+    size_t thread = (n == 0) ? offset : 0;
+    bool done = affordable(kListCost);
+    if (done) {
+      spent += kListCost;
+      if (!source_.Tids(pid, tids_)) {
+        continue;  // The process has ended
+      }
+      for (; thread < tids_.size(); ++thread) {
+        if (!affordable(kReadCost)) {
+          done = false;
+          break;
+        }
+        spent += kReadCost;
+        LinuxParser::ProcStatRecord stat;
+        if (LinuxParser::ReadTaskStat(source_, pid, tids_[thread], stat)) {
+          Update(pid, tids_[thread], stat, systemActiveJiffies);
+          ++count;
+        }
+      }
+    }
+    if (!done) {
+      // Out of budget: this process's other threads, and the next
+      // processes', wait for the next Refresh()
+      resumePid_ = pid;
+      resumeOffset_ = thread;
+      for (; n < pids.size(); ++n) {
+        skipped_.push_back(pids[(first + n) % pids.size()]);
+      }
+      break;
+    }
+  }
+
+  // Drop the threads which ended, and those of processes no longer given.
+  // Iterating backwards, Remove() only moves rows already visited.
+  std::sort(skipped_.begin(), skipped_.end());
+  for (Row row = Size(); row-- > 0;) {
+    if ((seen_[row] != generation_) &&
+        !std::binary_search(skipped_.begin(), skipped_.end(), pid_[row])) {
+      Remove(row);
+    }
+  }
+  return count;
+}
+
+// As ProcessTable::Update(), from the thread's first read on
+void ThreadTable::Update(int pid, int tid,
+                         const LinuxParser::ProcStatRecord& stat,
+                         unsigned long long systemActiveJiffies) {
+  Row row = index_.Find(tid);
+  if ((row != PidIndex::kNotFound_) && (startTime_[row] != stat.startTime)) {
+    Remove(row);  // Same TID, different thread
+    row = PidIndex::kNotFound_;
+  }
+
+  unsigned long long activeJiffies = stat.ActiveJiffies();
+  if (row == PidIndex::kNotFound_) {
+    row = Size();
+    tid_.push_back(tid);
+    pid_.push_back(pid);
+    startTime_.push_back(stat.startTime);
+    name_.emplace_back();
+    state_.push_back('?');
+    prevActiveJiffies_.push_back(activeJiffies);
+    prevSystemJiffies_.push_back(systemActiveJiffies);
+    cpuUtilization_.push_back(0.0);
+    seen_.push_back(0);
+    index_.Insert(tid, row);
+  }
+
+  unsigned long long activeJiffiesDelta =
+      (activeJiffies > prevActiveJiffies_[row])
+          ? (activeJiffies - prevActiveJiffies_[row])
+          : 0U;
+  unsigned long long systemActiveJiffiesDelta =
+      (systemActiveJiffies > prevSystemJiffies_[row])
+          ? (systemActiveJiffies - prevSystemJiffies_[row])
+          : 0U;
+  if (systemActiveJiffiesDelta > 0) {
+    cpuUtilization_[row] =
+        (float)activeJiffiesDelta / systemActiveJiffiesDelta;
+    prevActiveJiffies_[row] = activeJiffies;
+    prevSystemJiffies_[row] = systemActiveJiffies;
+  }
+
+  // Threads may rename themselves (e.g. with prctl())
+  name_[row].assign(stat.comm);
+  state_[row] = stat.state;
+  seen_[row] = generation_;
+}
+
+void ThreadTable::Remove(Row row) {
+  index_.Erase(tid_[row]);
+
+  Row last = Size() - 1;
+  if (row != last) {
+    tid_[row] = tid_[last];
+    pid_[row] = pid_[last];
+    startTime_[row] = startTime_[last];
+    name_[row].swap(name_[last]);
+    state_[row] = state_[last];
+    prevActiveJiffies_[row] = prevActiveJiffies_[last];
+    prevSystemJiffies_[row] = prevSystemJiffies_[last];
+    cpuUtilization_[row] = cpuUtilization_[last];
+    seen_[row] = seen_[last];
+    index_.Insert(tid_[row], row);
+  }
+
+  tid_.pop_back();
+  pid_.pop_back();
+  startTime_.pop_back();
+  name_.pop_back();
+  state_.pop_back();
+  prevActiveJiffies_.pop_back();
+  prevSystemJiffies_.pop_back();
+  cpuUtilization_.pop_back();
+  seen_.pop_back();
+}
+
+void ThreadTable::Clear() {
+  for (Row row = Size(); row-- > 0;) {
+    Remove(row);
+  }
+}
+
+size_t ThreadTable::Size() const { return tid_.size(); }
+
+int ThreadTable::Tid(Row row) const { return tid_[row]; }
+
+int ThreadTable::Pid(Row row) const { return pid_[row]; }
+
+const std::string& ThreadTable::Name(Row row) const { return name_[row]; }
+
+char ThreadTable::State(Row row) const { return state_[row]; }
+
+float ThreadTable::CpuUtilization(Row row) const {
+  return cpuUtilization_[row];
+}
+
+bool ThreadTable::Current(Row row) const {
+  return seen_[row] == generation_;
+}
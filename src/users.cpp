@@ -1,32 +1,140 @@
 #include "users.h"
 
+#include <pwd.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
 #include "linux_parser.h"
 
 using std::string;
+using std::vector;
 
-string Users::LookUpUserName(int uid) {
+bool Users::FileStamp::operator==(const FileStamp& other) const {
+  return (valid == other.valid) && (source == other.source) &&
+         (device == other.device) &&
+         (inode == other.inode) && (mtime.tv_sec == other.mtime.tv_sec) &&
+         (mtime.tv_nsec == other.mtime.tv_nsec);
+}
+
+Users::Users() = default;
+
+Users& Users::Instance() {
   static Users instance_;  // Singleton instance
-  return instance_.GetNameFromUid(uid);
+  return instance_;
+}
+
+string Users::LookUpUserName(int uid) {
+  return Instance().GetNameFromUid(uid);
+}
+
+void Users::Revalidate(DataSource& source) {
+  Instance().ReloadIfChanged(source);
+}
+
+void Users::EnableNss(bool enable) {
+  Users& users = Instance();
+  std::unique_lock<std::shared_mutex> lock(users.mutex_);
+  users.use_nss_ = enable;
+  users.nss_map_.clear();
 }
 
 string Users::GetNameFromUid(int uid) {
-  string name;
+  if (uid < 0) {  // Negative user IDs not allowed/recognised
+    return string();
+  }
 
-  if (uid >= 0)  // Negative user IDs not allowed/recognised
   {
-    if (users_map_.find(uid) == users_map_.end()) {
-      // UID not found in the map, look up using LinuxParser
-      name = LinuxParser::UserFromUid(uid);
-
-      // Only add to the map if LinuxParser look up was successful
-      if (name.length() > 0U) {
-        users_map_[uid] = name;  // Add to the map
-      }
-    } else  // UID already in the map
-    {
-      name = users_map_[uid];
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    auto it = std::lower_bound(uids_.begin(), uids_.end(), uid);
+    if ((it != uids_.end()) && (*it == uid)) {
+      return names_[it - uids_.begin()];
+    }
+    if (!use_nss_) {
+      return string();  // The file is authoritative: unknown UID
+    }
+    auto nss = nss_map_.find(uid);
+    if (nss != nss_map_.end()) {
+      return nss->second;  // Cached result, possibly negative
     }
   }
 
+  // Not in the file: ask NSS, without holding the lock (this may involve
+  // a network round trip)
+  string name = GetNameFromNss(uid);
+
+  std::unique_lock<std::shared_mutex> lock(mutex_);
+  nss_map_.emplace(uid, name);  // No-op if another thread beat us to it
   return name;
 }
+
+string Users::GetNameFromNss(int uid) {
+  long size = sysconf(_SC_GETPW_R_SIZE_MAX);
+  vector<char> buffer((size > 0) ? size : 4096);
+
+  struct passwd pwd;
+  struct passwd* result = nullptr;
+  int error;
+  while ((error = getpwuid_r(uid, &pwd, buffer.data(), buffer.size(),
+                             &result)) == ERANGE) {
+    buffer.resize(2 * buffer.size());
+  }
+
+  return ((error == 0) && (result != nullptr)) ? string(result->pw_name)
+                                               : string();
+}
+
+Users::FileStamp Users::StampPasswordFile(DataSource& source) {
+  FileStamp stamp;
+  stamp.source = &source;
+  struct stat st;
+  if (source.Stat(kPasswd_, st)) {
+    stamp.device = st.st_dev;
+    stamp.inode = st.st_ino;
+    stamp.mtime = st.st_mtim;
+    stamp.valid = true;
+  }
+  return stamp;
+}
+
+// Reload the password file if it has been replaced (new inode, e.g. after
+// an atomic rename) or modified in place (new mtime) since the last load
+void Users::ReloadIfChanged(DataSource& source) {
+  FileStamp stamp = StampPasswordFile(source);
+  {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    if (loaded_stamp_.valid && (stamp == loaded_stamp_)) {
+      return;
+    }
+  }
+
+  vector<LinuxParser::PasswdEntry> entries;
+  LinuxParser::ReadPasswd(source, entries);
+
+  // Sort by UID; if a UID appears more than once, its first entry wins (as
+  // with getpwuid)
+  std::stable_sort(entries.begin(), entries.end(),
+                   [](const LinuxParser::PasswdEntry& a,
+                      const LinuxParser::PasswdEntry& b) {
+                     return a.uid < b.uid;
+                   });
+  vector<int> uids;
+  vector<string> names;
+  uids.reserve(entries.size());
+  names.reserve(entries.size());
+  for (auto& entry : entries) {
+    if (uids.empty() || (uids.back() != entry.uid)) {
+      uids.push_back(entry.uid);
+      names.push_back(std::move(entry.name));
+    }
+  }
+
+  std::unique_lock<std::shared_mutex> lock(mutex_);
+  uids_.swap(uids);
+  names_.swap(names);
+  nss_map_.clear();
+  loaded_stamp_ = stamp;
+}
@@ -0,0 +1,24 @@
+#ifndef CHECK_H
+#define CHECK_H
+
+#include <cstdio>
+
+// Minimal test support: a failed CHECK() prints where it failed and counts
+// towards the test's exit status (see Failures())
+namespace Check {
+inline int& Failures() {
+  static int failures{0};
+  return failures;
+}
+}  // namespace Check
+
+#define CHECK(condition)                                                \
+  do {                                                                  \
+    if (!(condition)) {                                                 \
+      std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__,       \
+                   __LINE__, #condition);                               \
+      ++Check::Failures();                                              \
+    }                                                                   \
+  } while (false)
+
+#endif
@@ -0,0 +1,48 @@
+#include <cstring>
+#include <string>
+
+#include "check.h"
+#include "linux_parser.h"
+
+using std::string;
+
+static const char kStat[] =
+    "42 (a b) c) R 1 42 42 0 -1 4194560 10 0 0 0 7 3 0 0 20 0 2 0 123 "
+    "4096 5 18446744073709551615\n";
+
+static void TestParsesProcStat() {
+  LinuxParser::ProcStatRecord record;
+  CHECK(LinuxParser::ParseProcStat(kStat, std::strlen(kStat), record));
+  CHECK(record.pid == 42);
+  CHECK(string(record.comm) == "a b) c");
+  CHECK(record.state == 'R');
+  CHECK(record.ppid == 1);
+  CHECK(record.utime == 7);
+  CHECK(record.stime == 3);
+  CHECK(record.numThreads == 2);
+  CHECK(record.startTime == 123);
+  CHECK(record.vsize == 4096);
+  CHECK(record.rss == 5);
+}
+
+// A line cut short anywhere is rejected, without reading past its end:
+// here the bytes after the cut would parse as the next fields
+static void TestRejectsTruncatedProcStat() {
+  const char* rparen = std::strrchr(kStat, ')');
+  for (size_t length = rparen + 1 - kStat; length < std::strlen(kStat) - 24;
+       ++length) {
+    LinuxParser::ProcStatRecord record;
+    CHECK(!LinuxParser::ParseProcStat(kStat, length, record));
+  }
+
+  LinuxParser::ProcStatRecord record;
+  size_t length = rparen + 2 - kStat;  // Up to the space after ')'
+  CHECK(!LinuxParser::ParseProcStat(kStat, length, record));
+  CHECK(record.state == '?');
+}
+
+int main() {
+  TestParsesProcStat();
+  TestRejectsTruncatedProcStat();
+  return (Check::Failures() == 0) ? 0 : 1;
+}
@@ -0,0 +1,92 @@
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "check.h"
+#include "in_memory_data_source.h"
+#include "recorder.h"
+#include "replayer.h"
+#include "system.h"
+
+using std::string;
+
+// A /proc/<pid>/stat with the given user time, started 1 s after boot
+static string ProcStat(int pid, unsigned long long utime) {
+  return std::to_string(pid) + " (test) S 1 1 1 0 -1 0 0 0 0 0 " +
+         std::to_string(utime) + " 0 0 0 20 0 1 0 100 1000000 100\n";
+}
+
+// Two CPUs' worth of /proc/stat, 'active' jiffies of which were busy
+static string Stat(unsigned long long active, unsigned long long idle) {
+  string times = std::to_string(active) + " 0 0 " + std::to_string(idle);
+  return "cpu  " + times + " 0 0 0 0 0 0\ncpu0 " + times +
+         " 0 0 0 0 0 0\nprocesses 2\nprocs_running 1\nprocs_blocked 0\n";
+}
+
+// A process that idles long enough to move down the tiers, then gets busy:
+// its CPU utilization is then measured over the several ticks since its
+// previous refresh, and the replay has to show the same as the live view
+static void TestTieredCpuReplaysAsLive() {
+  const int kIdle{10};
+  const int kBusy{11};
+  const int kTicks{40};
+  InMemoryDataSource source;
+  source.SetFile(kProcUptime_, "1000.00 1000.00\n");
+  source.SetFile(kProcMeminfo_,
+                 "MemTotal: 1000000 kB\nMemFree: 500000 kB\n"
+                 "MemAvailable: 600000 kB\n");
+  System system(source);
+
+  char path[] = "/tmp/recording_test.XXXXXX";
+  int fd = mkstemp(path);
+  CHECK(fd >= 0);
+  close(fd);
+  Recorder recorder;
+  CHECK(recorder.Open(path));
+
+  std::vector<float> live[2];
+  unsigned long long idleUtime{0};
+  for (int tick = 0; tick < kTicks; ++tick) {
+    if (tick >= kTicks / 2) {
+      idleUtime += 5;
+    }
+    source.SetFile(kProcStat_, Stat(100 * tick, 100 * tick));
+    source.SetProcessFile(kIdle, "stat", ProcStat(kIdle, idleUtime));
+    source.SetProcessFile(kBusy, "stat", ProcStat(kBusy, 20 * tick));
+    system.Refresh();
+    CHECK(recorder.Record(system));
+
+    const ProcessTable& table = system.Processes();
+    live[0].push_back(table.CpuUtilization(table.Find(kIdle)));
+    live[1].push_back(table.CpuUtilization(table.Find(kBusy)));
+  }
+  CHECK(recorder.Close());
+
+  Replayer replayer;
+  CHECK(replayer.Open(path));
+  CHECK(replayer.NumFrames() == kTicks);
+  Sample sample;
+  bool measuredOverTiers{false};
+  for (int frame = 0; frame < kTicks; ++frame) {
+    CHECK(replayer.Seek(frame));
+    replayer.FillSample(sample, 2);
+    CHECK(sample.processes.size() == 2);
+    for (const ProcessSample& process : sample.processes) {
+      float expected = live[(process.pid == kIdle) ? 0 : 1][frame];
+      CHECK(std::fabs(process.cpuUtilization - expected) < 1e-3);
+      CHECK(process.cpuUtilization <= 1.0);
+    }
+    measuredOverTiers = measuredOverTiers || (live[0][frame] > 0);
+  }
+  CHECK(measuredOverTiers);
+  unlink(path);
+}
+
+int main() {
+  TestTieredCpuReplaysAsLive();
+  return (Check::Failures() == 0) ? 0 : 1;
+}
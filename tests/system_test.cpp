@@ -0,0 +1,68 @@
+#include <string>
+
+#include "check.h"
+#include "in_memory_data_source.h"
+#include "system.h"
+
+using std::string;
+
+// An idle /proc/<pid>/stat, started 'startTime' clock ticks after boot
+static string ProcStat(int pid, unsigned long long startTime) {
+  return std::to_string(pid) + " (test) S 1 1 1 0 -1 0 0 0 0 0 0 0 0 0 " +
+         "20 0 1 0 " + std::to_string(startTime) + " 1000000 100\n";
+}
+
+// An idle /proc/stat, 'forks' processes having been forked since boot
+static string Stat(unsigned long long idle, unsigned long long forks) {
+  string times = "0 0 0 " + std::to_string(idle) + " 0 0 0 0 0 0\n";
+  return "cpu  " + times + "cpu0 " + times + "processes " +
+         std::to_string(forks) + "\nprocs_running 1\nprocs_blocked 0\n";
+}
+
+// An idle process sinks to the coldest tier; its PID is then reused by
+// another process after enough forks for the kernel to wrap around: the
+// row has to show the new process well before its next due refresh
+static void TestReusedPidRefreshedAfterWrap() {
+  const int kPid{10};
+  const int kPidMax{400};
+  InMemoryDataSource source;
+  source.SetFile(kProcUptime_, "1000.00 1000.00\n");
+  source.SetFile(kProcMeminfo_,
+                 "MemTotal: 1000000 kB\nMemFree: 500000 kB\n"
+                 "MemAvailable: 600000 kB\n");
+  source.SetFile(kPidMax_, std::to_string(kPidMax) + "\n");
+  source.SetProcessFile(kPid, "stat", ProcStat(kPid, 100));
+  System system(source);
+
+  unsigned long long forks{1000};
+  int tick{0};
+  for (; tick < 40; ++tick) {
+    source.SetFile(kProcStat_, Stat(100 * tick, forks));
+    system.Refresh();
+  }
+  const ProcessTable& table = system.Processes();
+  Row row = table.Find(kPid);
+  CHECK(table.Tier(row) == ProcessTable::kMaxTier_);
+  long nextRefresh = table.NextRefresh(row);
+
+  // Fewer forks than free PIDs (those above the 300 reserved ones, less
+  // the one in use): the PID can't have been reused yet
+  forks += kPidMax - 300 - 2;
+  source.SetFile(kProcStat_, Stat(100 * tick++, forks));
+  system.Refresh();
+  CHECK(table.NextRefresh(table.Find(kPid)) == nextRefresh);
+
+  forks += 1;
+  source.SetProcessFile(kPid, "stat", ProcStat(kPid, 5000));
+  source.SetFile(kProcStat_, Stat(100 * tick++, forks));
+  system.Refresh();
+  source.SetFile(kProcStat_, Stat(100 * tick++, forks));
+  system.Refresh();
+  CHECK(tick < nextRefresh);
+  CHECK(table.StartTime(table.Find(kPid)) == 5000);
+}
+
+int main() {
+  TestReusedPidRefreshedAfterWrap();
+  return (Check::Failures() == 0) ? 0 : 1;
+}
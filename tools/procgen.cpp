@@ -0,0 +1,911 @@
+// procgen: writes a synthetic procfs tree (DIR/proc and DIR/etc, and a
+// cgroup v2 hierarchy in DIR/sys/fs/cgroup) for scale testing, then keeps
+// it changing tick by tick as a busy host would: processes start and exit,
+// accumulate CPU time and grow or shrink.
+//
+//   procgen --dir /dev/shm/fakehost --processes 100000 &
+//   monitor --root /dev/shm/fakehost
+//   monitor --root /dev/shm/fakehost --cgroup /system.slice
+//
+// Only the files the monitor reads are generated. Each file takes (at
+// least) a page on tmpfs: 100k processes need ~1.6 GB (and a page per
+// thread more with --tasks).
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <experimental/filesystem>
+#include <map>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+namespace fs = std::experimental::filesystem;
+using std::size_t;
+using std::string;
+using std::vector;
+
+namespace {
+// Marks a directory as generated by procgen (and safe to overwrite)
+const char kMarker[] = "/.procgen";
+
+const int kPageSize{4096};
+const int kMaxPid{4194304};
+const int kFirstUserPid{300};
+
+struct Settings {
+  string directory;
+  size_t processes{1000};
+  double churn{0.01};  // Fraction of the processes replaced per tick
+  size_t cmdlineMin{16};
+  size_t cmdlineMax{256};
+  size_t users{50};
+  int cores{8};
+  size_t intervalMs{1000};
+  size_t ticks{0};  // 0: until killed
+  unsigned long seed{1};
+  bool once{false};
+  bool status{false};  // Rewrite /proc/<pid>/status on every tick
+  bool tasks{false};  // Write /proc/<pid>/task/<tid>/stat
+};
+
+struct FakeProcess {
+  int pid;
+  int ppid;
+  int uid;
+  char state;
+  string comm;
+  string cmdline;
+  double rate;   // CPU use, in jiffies per second
+  double carry;  // Fraction of a jiffy not accounted for yet
+  unsigned long long utime;
+  unsigned long long stime;
+  unsigned long long startTime;  // Clock ticks after boot
+  unsigned long long vsize;      // Bytes
+  unsigned long long rss;        // Pages
+  long threads;
+  size_t cgroup;     // Index in ProcGenerator::cgroups_
+  vector<int> tids;  // With --tasks: besides the main thread's (its PID)
+};
+
+// A cgroup's accounting, which (as in cgroup v2) includes its descendants'
+struct FakeCgroup {
+  string path;  // "/" for the root
+  size_t parent;
+  vector<int> pids;  // Its own processes only, rebuilt on each tick
+  unsigned long long usageUsec{0};
+  unsigned long long memory{0};  // Bytes, recomputed on each tick
+  unsigned long long rbytes{0};
+  unsigned long long wbytes{0};
+  unsigned long long ios{0};
+  bool written{false};
+};
+
+const char* const kCommands[] = {
+    "nginx",    "postgres", "java",     "python3",   "node",
+    "redis",    "sshd",     "bash",     "envoy",     "containerd",
+    "kubelet",  "gunicorn", "memcached", "ruby",     "haproxy",
+    "mysqld",   "php-fpm",  "dockerd",  "prometheus", "chrome"};
+const char* const kKernelThreads[] = {"kworker/0:1", "ksoftirqd/0",
+                                      "migration/0", "rcu_sched",
+                                      "kswapd0",     "jbd2/sda1-8"};
+const char* const kWords[] = {"--config", "/etc/app/config.yaml", "-v",
+                              "--port",   "8080",                 "--workers",
+                              "16",       "--log-level",          "info",
+                              "-Xmx4g",   "/opt/app/lib/app.jar", "serve"};
+
+class ProcGenerator {
+ public:
+  explicit ProcGenerator(const Settings& settings)
+      : settings_(settings),
+        random_(settings.seed),
+        clockTicks_(sysconf(_SC_CLK_TCK)),
+        proc_(settings.directory + "/proc"),
+        cgroupRoot_(settings.directory + "/sys/fs/cgroup") {}
+
+  // Both return false once a file couldn't be written (see Error())
+  bool Create();
+  bool Tick();
+  const string& Error() const { return error_; }
+
+ private:
+  FakeProcess Spawn(int ppid, bool kernelThread);
+  int NextPid();
+  void SpawnThreads(FakeProcess& process);
+  int PickUid();
+  string MakeCmdline(const string& command);
+  size_t FindCgroup(const string& path);
+  void ChargeCpu(size_t cgroup, unsigned long long jiffies);
+  int FormatStat(const FakeProcess& process, int pid, const string& comm,
+                 char state, unsigned long long utime,
+                 unsigned long long stime);
+  void WriteProcess(const FakeProcess& process, bool create);
+  void WriteThreads(const FakeProcess& process, bool create);
+  void WriteSystemFiles(bool create);
+  void WriteCgroups();
+  void RemoveProcess(size_t index);
+  bool WriteFile(const char* path, const char* data, size_t length,
+                 bool create);
+  bool MakeDirectory(const char* path);
+  void Fail(const char* path);
+  double Uniform() { return std::uniform_real_distribution<>()(random_); }
+
+ private:
+  Settings settings_;
+  std::mt19937_64 random_;
+  long clockTicks_;
+  string proc_;
+  string cgroupRoot_;
+  vector<FakeProcess> processes_;
+  vector<FakeCgroup> cgroups_;              // Parents before children
+  std::map<string, size_t> cgroupIndex_;  // By path
+  std::unordered_set<int> live_;
+  int nextPid_{kFirstUserPid};
+  double upTime_{0};
+  double idleTime_{0};
+  unsigned long long forks_{0};
+  unsigned long long contextSwitches_{0};
+  unsigned long long interrupts_{0};
+  vector<unsigned long long> coreActive_;
+  vector<unsigned long long> coreIdle_;
+  int running_{0};
+  double churnCarry_{0};
+  string error_;  // The first failure, e.g. "<path>: Permission denied"
+  char buffer_[8192];
+};
+
+bool ProcGenerator::Create() {
+  const string& directory = settings_.directory;
+  if (fs::exists(proc_) && !fs::exists(directory + kMarker)) {
+    std::fprintf(stderr, "%s exists and wasn't generated by procgen\n",
+                 proc_.c_str());
+    return false;
+  }
+  std::error_code error;
+  fs::remove_all(proc_, error);
+  fs::remove_all(directory + "/etc", error);
+  fs::remove_all(directory + "/sys", error);
+  fs::create_directories(proc_, error);
+  fs::create_directories(directory + "/etc", error);
+  fs::create_directories(cgroupRoot_, error);
+  if (error) {
+    std::fprintf(stderr, "%s: %s\n", directory.c_str(),
+                 error.message().c_str());
+    return false;
+  }
+  close(creat((directory + kMarker).c_str(), 0644));
+
+  // A long running host
+  upTime_ = 86400 + 3600 * Uniform();
+  idleTime_ = upTime_ * settings_.cores * 0.7;
+  coreActive_.assign(settings_.cores, upTime_ * clockTicks_ * 0.3);
+  coreIdle_.assign(settings_.cores, upTime_ * clockTicks_ * 0.7);
+  forks_ = 1000000;
+
+  // init, kthreadd and its kernel threads, then everything else
+  processes_.reserve(settings_.processes);
+  size_t kernelThreads = std::max<size_t>(settings_.processes / 20, 1);
+  for (size_t i = 0; i < settings_.processes; ++i) {
+    FakeProcess process = Spawn((i < 2 + kernelThreads) ? 2 : 1,
+                                (i >= 1) && (i < 2 + kernelThreads));
+    if (i < 2) {
+      process.pid = i + 1;
+      process.ppid = 0;
+      process.comm = (i == 0) ? "systemd" : "kthreadd";
+      process.cmdline = (i == 0) ? string("/sbin/init\0", 11) : "";
+      process.cgroup = FindCgroup((i == 0) ? "/init.scope" : "/");
+      live_.erase(nextPid_ - 1);
+      --nextPid_;
+      live_.insert(process.pid);
+    }
+    SpawnThreads(process);
+    // Spread start times over the uptime
+    process.startTime = (i < 2) ? clockTicks_
+                                : (unsigned long long)(Uniform() * upTime_ *
+                                                       clockTicks_);
+    ChargeCpu(process.cgroup, process.utime + process.stime);
+    processes_.push_back(process);
+    WriteProcess(process, true);
+  }
+
+  WriteSystemFiles(true);
+  const char controllers[] = "cpu io memory pids\n";
+  WriteFile((cgroupRoot_ + "/cgroup.controllers").c_str(), controllers,
+            sizeof(controllers) - 1, true);
+  WriteCgroups();
+  return error_.empty();
+}
+
+// Advance the simulated clock by one interval and update the tree
+bool ProcGenerator::Tick() {
+  double seconds = settings_.intervalMs / 1000.0;
+  upTime_ += seconds;
+
+  // Churn: replace some processes (never init or kthreadd)
+  churnCarry_ += settings_.churn * processes_.size();
+  size_t replaced = churnCarry_;
+  churnCarry_ -= replaced;
+  for (size_t i = 0; (i < replaced) && (processes_.size() > 2); ++i) {
+    size_t index = 2 + (random_() % (processes_.size() - 2));
+    RemoveProcess(index);
+    FakeProcess process = Spawn(1, false);
+    process.startTime = upTime_ * clockTicks_;
+    SpawnThreads(process);
+    processes_.push_back(process);
+    WriteProcess(process, true);
+    ++forks_;
+  }
+
+  // Progress: processes accumulate CPU time at their own rate; only the
+  // files of those which changed are rewritten
+  unsigned long long activeJiffies{0};
+  running_ = 0;
+  for (FakeProcess& process : processes_) {
+    process.carry += process.rate * seconds;
+    unsigned long long jiffies = process.carry;
+    if (jiffies == 0) {
+      continue;
+    }
+    process.carry -= jiffies;
+    unsigned long long system = jiffies / 5;
+    process.stime += system;
+    process.utime += jiffies - system;
+    activeJiffies += jiffies;
+    ChargeCpu(process.cgroup, jiffies);
+    process.state = (process.rate > 0.3 * clockTicks_) ? 'R' : 'S';
+    running_ += (process.state == 'R') ? 1 : 0;
+    if (Uniform() < 0.2) {
+      long pages = (long)process.rss + (long)(process.rss * 0.02 *
+                                              (Uniform() - 0.5));
+      process.rss = std::max(pages, 16L);
+    }
+    WriteProcess(process, false);
+  }
+
+  // Share the processes' CPU time among the cores
+  unsigned long long perCore = seconds * clockTicks_;
+  for (int core = 0; core < settings_.cores; ++core) {
+    unsigned long long active = std::min(
+        perCore, activeJiffies / settings_.cores + (random_() % 3));
+    coreActive_[core] += active;
+    coreIdle_[core] += perCore - active;
+  }
+  idleTime_ += seconds * settings_.cores -
+               (double)activeJiffies / clockTicks_;
+  contextSwitches_ += processes_.size() * 5 + (random_() % 1000);
+  interrupts_ += settings_.cores * 1000 * seconds + (random_() % 1000);
+
+  WriteSystemFiles(false);
+  WriteCgroups();
+  return error_.empty();
+}
+
+FakeProcess ProcGenerator::Spawn(int ppid, bool kernelThread) {
+  FakeProcess process{};
+  process.pid = NextPid();
+  process.ppid = ppid;
+  process.state = 'S';
+  if (kernelThread) {
+    process.uid = 0;
+    process.comm = kKernelThreads[random_() % std::size(kKernelThreads)];
+    process.vsize = 0;
+    process.rss = 0;
+    process.threads = 1;
+  } else {
+    string command = kCommands[random_() % std::size(kCommands)];
+    process.uid = PickUid();
+    process.comm = command.substr(0, 15);
+    process.cmdline = MakeCmdline(command);
+    // Log-uniform sizes, from 1 MB to 256 MB
+    process.vsize = (unsigned long long)(1e6 * std::pow(256.0, Uniform()));
+    process.rss = process.vsize / kPageSize * (0.05 + 0.2 * Uniform());
+    process.threads = 1 + (random_() % 32);
+  }
+
+  // Kernel threads stay in the root cgroup, services get one each, and
+  // users' processes go to their session
+  if (kernelThread) {
+    process.cgroup = FindCgroup("/");
+  } else if (process.uid >= 1000) {
+    process.cgroup = FindCgroup("/user.slice/user-" +
+                                std::to_string(process.uid) +
+                                ".slice/session-1.scope");
+  } else {
+    process.cgroup = FindCgroup("/system.slice/" + process.comm + ".service");
+  }
+
+  // Most processes sleep, a few are busy; the shares keep the total demand
+  // within the cores' capacity
+  double processes = settings_.processes;
+  double cores = settings_.cores;
+  double heavy = std::min(0.01, 0.4 * cores / (0.75 * processes));
+  double light = std::min(0.09, 0.2 * cores / (0.05 * processes));
+  double draw = kernelThread ? 1.0 : Uniform();
+  if (draw < heavy) {
+    process.rate = clockTicks_ * (0.5 + 0.5 * Uniform());
+  } else if (draw < heavy + light) {
+    process.rate = clockTicks_ * 0.1 * Uniform();
+  } else {
+    // The odd jiffy now and then
+    process.rate = std::min(0.05, 0.2 * cores * clockTicks_ / processes) *
+                   Uniform();
+  }
+  return process;
+}
+
+// PIDs are allocated in increasing order, wrapping around like the kernel
+int ProcGenerator::NextPid() {
+  while (live_.count(nextPid_) != 0) {
+    nextPid_ = (nextPid_ + 1 >= kMaxPid) ? kFirstUserPid : nextPid_ + 1;
+  }
+  int pid = nextPid_;
+  live_.insert(pid);
+  nextPid_ = (nextPid_ + 1 >= kMaxPid) ? kFirstUserPid : nextPid_ + 1;
+  return pid;
+}
+
+// With --tasks, the process's other threads get TIDs from the same space as
+// PIDs, as in the kernel
+void ProcGenerator::SpawnThreads(FakeProcess& process) {
+  if (!settings_.tasks) {
+    return;
+  }
+  for (long thread = 1; thread < process.threads; ++thread) {
+    process.tids.push_back(NextPid());
+  }
+}
+
+// A quarter of the processes belong to root; user i (of n) owns a share
+// proportional to 1/i (Zipf)
+int ProcGenerator::PickUid() {
+  if ((settings_.users == 0) || (Uniform() < 0.25)) {
+    return 0;
+  }
+  double harmonic{0};
+  for (size_t i = 1; i <= settings_.users; ++i) {
+    harmonic += 1.0 / i;
+  }
+  double draw = Uniform() * harmonic;
+  for (size_t i = 1; i <= settings_.users; ++i) {
+    draw -= 1.0 / i;
+    if (draw <= 0) {
+      return 1000 + i - 1;
+    }
+  }
+  return 1000 + settings_.users - 1;
+}
+
+// NUL separated arguments, with a length drawn from the configured range
+string ProcGenerator::MakeCmdline(const string& command) {
+  size_t length = settings_.cmdlineMin +
+                  random_() % (settings_.cmdlineMax - settings_.cmdlineMin + 1);
+  string cmdline = "/usr/bin/" + command;
+  while (cmdline.size() < length) {
+    cmdline += '\0';
+    cmdline += kWords[random_() % std::size(kWords)];
+  }
+  cmdline.resize(std::max<size_t>(length, 1));
+  cmdline += '\0';
+  return cmdline;
+}
+
+void ProcGenerator::WriteProcess(const FakeProcess& process, bool create) {
+  char path[4096];
+  int length;
+
+  if (create) {
+    std::snprintf(path, sizeof(path), "%s/%d", proc_.c_str(), process.pid);
+    MakeDirectory(path);
+
+    std::snprintf(path, sizeof(path), "%s/%d/cmdline", proc_.c_str(),
+                  process.pid);
+    WriteFile(path, process.cmdline.data(), process.cmdline.size(), true);
+
+    length = std::snprintf(buffer_, sizeof(buffer_), "0::%s\n",
+                           cgroups_[process.cgroup].path.c_str());
+    std::snprintf(path, sizeof(path), "%s/%d/cgroup", proc_.c_str(),
+                  process.pid);
+    WriteFile(path, buffer_, length, true);
+  }
+
+  length = FormatStat(process, process.pid, process.comm, process.state,
+                      process.utime, process.stime);
+  std::snprintf(path, sizeof(path), "%s/%d/stat", proc_.c_str(), process.pid);
+  WriteFile(path, buffer_, length, create);
+  WriteThreads(process, create);
+
+  // The owner comes from the Uid line, hence status is always created
+  if (create || settings_.status) {
+    length = std::snprintf(
+        buffer_, sizeof(buffer_),
+        "Name:\t%s\nUmask:\t0022\nState:\t%c (%s)\nTgid:\t%d\nNgid:\t0\n"
+        "Pid:\t%d\nPPid:\t%d\nTracerPid:\t0\nUid:\t%d\t%d\t%d\t%d\n"
+        "Gid:\t%d\t%d\t%d\t%d\nVmSize:\t%llu kB\nVmRSS:\t%llu kB\n"
+        "Threads:\t%ld\n",
+        process.comm.c_str(), process.state,
+        (process.state == 'R') ? "running" : "sleeping", process.pid,
+        process.pid, process.ppid, process.uid, process.uid, process.uid,
+        process.uid, process.uid, process.uid, process.uid, process.uid,
+        process.vsize / 1024, process.rss * (kPageSize / 1024),
+        process.threads);
+    std::snprintf(path, sizeof(path), "%s/%d/status", proc_.c_str(),
+                  process.pid);
+    WriteFile(path, buffer_, length, create);
+  }
+}
+
+// A stat file into buffer_, of the process or (with the TID as 'pid') one
+// of its threads; see proc(5) for the fields
+int ProcGenerator::FormatStat(const FakeProcess& process, int pid,
+                              const string& comm, char state,
+                              unsigned long long utime,
+                              unsigned long long stime) {
+  return std::snprintf(
+      buffer_, sizeof(buffer_),
+      "%d (%s) %c %d %d %d 0 -1 4194560 %llu 0 %llu 0 %llu %llu 0 0 20 0 "
+      "%ld 0 %llu %llu %llu 18446744073709551615 1 1 0 0 0 0 0 0 0 0 0 0 "
+      "17 %d 0 0 0 0 0 0 0 0 0 0 0 0 0\n",
+      pid, comm.c_str(), state, process.ppid, process.pid, process.pid,
+      utime * 7, utime / 100, utime, stime, process.threads,
+      process.startTime, process.vsize, process.rss,
+      pid % settings_.cores);
+}
+
+// With --tasks, the stat file of each of the process's threads. Thread i
+// gets a share of the process's CPU time weighted 1/(i+1), rounded down,
+// so that threads' times only grow, and add up to (at most) the process's
+// as they do in the kernel (whose process times include dead threads').
+void ProcGenerator::WriteThreads(const FakeProcess& process, bool create) {
+  if (!settings_.tasks) {
+    return;
+  }
+  char path[4096];
+  if (create) {
+    std::snprintf(path, sizeof(path), "%s/%d/task", proc_.c_str(),
+                  process.pid);
+    MakeDirectory(path);
+  }
+
+  double weights{0};
+  for (size_t i = 0; i <= process.tids.size(); ++i) {
+    weights += 1.0 / (i + 1);
+  }
+  for (size_t i = 0; i <= process.tids.size(); ++i) {
+    int tid = (i == 0) ? process.pid : process.tids[i - 1];
+    if (create) {
+      std::snprintf(path, sizeof(path), "%s/%d/task/%d", proc_.c_str(),
+                    process.pid, tid);
+      MakeDirectory(path);
+    }
+    // The main thread is named after the process, the others after it
+    string comm = process.comm;
+    if (i > 0) {
+      comm = comm.substr(0, 10) + "/" + std::to_string(i);
+    }
+    double share = 1.0 / (i + 1) / weights;
+    int length = FormatStat(
+        process, tid, comm, (i == 0) ? process.state : 'S',
+        (unsigned long long)(process.utime * share),
+        (unsigned long long)(process.stime * share));
+    std::snprintf(path, sizeof(path), "%s/%d/task/%d/stat", proc_.c_str(),
+                  process.pid, tid);
+    WriteFile(path, buffer_, length, create);
+  }
+}
+
+void ProcGenerator::WriteSystemFiles(bool create) {
+  char path[4096];
+  int length;
+
+  // /proc/stat
+  unsigned long long active{0};
+  unsigned long long idle{0};
+  for (int core = 0; core < settings_.cores; ++core) {
+    active += coreActive_[core];
+    idle += coreIdle_[core];
+  }
+  // Active time is split as user 70%, system 25%, softirq 5%
+  length = std::snprintf(buffer_, sizeof(buffer_),
+                         "cpu  %llu 0 %llu %llu 0 0 %llu 0 0 0\n",
+                         active * 7 / 10, active / 4, idle,
+                         active - active * 7 / 10 - active / 4);
+  string stat(buffer_, length);
+  for (int core = 0; core < settings_.cores; ++core) {
+    unsigned long long coreActive = coreActive_[core];
+    length = std::snprintf(
+        buffer_, sizeof(buffer_), "cpu%d %llu 0 %llu %llu 0 0 %llu 0 0 0\n",
+        core, coreActive * 7 / 10, coreActive / 4, coreIdle_[core],
+        coreActive - coreActive * 7 / 10 - coreActive / 4);
+    stat.append(buffer_, length);
+  }
+  long bootTime = std::time(nullptr) - (long)upTime_;
+  length = std::snprintf(
+      buffer_, sizeof(buffer_),
+      "intr %llu\nctxt %llu\nbtime %ld\nprocesses %llu\n"
+      "procs_running %d\nprocs_blocked %d\nsoftirq %llu\n",
+      interrupts_, contextSwitches_, bootTime, forks_,
+      std::max(running_, 1), (int)(random_() % 3), interrupts_ / 2);
+  stat.append(buffer_, length);
+  std::snprintf(path, sizeof(path), "%s/stat", proc_.c_str());
+  WriteFile(path, stat.data(), stat.size(), create);
+
+  // /proc/meminfo, consistent with the processes' resident sizes
+  unsigned long long residentKb{0};
+  for (const FakeProcess& process : processes_) {
+    residentKb += process.rss * (kPageSize / 1024);
+  }
+  unsigned long long totalKb =
+      std::max<unsigned long long>(64ULL << 20, residentKb * 3 / 2);
+  unsigned long long cachedKb = (totalKb - residentKb) / 3;
+  unsigned long long freeKb = totalKb - residentKb - cachedKb;
+  length = std::snprintf(
+      buffer_, sizeof(buffer_),
+      "MemTotal:       %llu kB\nMemFree:        %llu kB\n"
+      "MemAvailable:   %llu kB\nBuffers:        %llu kB\n"
+      "Cached:         %llu kB\nSwapCached:     0 kB\n"
+      "Active:         %llu kB\nInactive:       %llu kB\n"
+      "SwapTotal:      8388604 kB\nSwapFree:       8388604 kB\n"
+      "Dirty:          %llu kB\nWriteback:      0 kB\n"
+      "AnonPages:      %llu kB\nMapped:         %llu kB\n"
+      "Shmem:          %llu kB\nSlab:           %llu kB\n"
+      "SReclaimable:   %llu kB\nSUnreclaim:     %llu kB\n"
+      "PageTables:     %llu kB\nCommitted_AS:   %llu kB\n",
+      totalKb, freeKb, freeKb + cachedKb, cachedKb / 20, cachedKb,
+      residentKb / 2 + cachedKb / 2, residentKb / 2 + cachedKb / 2,
+      (unsigned long long)(random_() % 4096), residentKb, residentKb / 8,
+      cachedKb / 50, totalKb / 64, totalKb / 96, totalKb / 192,
+      residentKb / 200, residentKb * 2);
+  std::snprintf(path, sizeof(path), "%s/meminfo", proc_.c_str());
+  WriteFile(path, buffer_, length, create);
+
+  // /proc/uptime
+  length = std::snprintf(buffer_, sizeof(buffer_), "%.2f %.2f\n", upTime_,
+                         std::max(idleTime_, 0.0));
+  std::snprintf(path, sizeof(path), "%s/uptime", proc_.c_str());
+  WriteFile(path, buffer_, length, create);
+
+  if (!create) {
+    return;
+  }
+
+  // Static files
+  const char version[] =
+      "Linux version 6.1.0-procgen (procgen@localhost) (gcc 12.2.0) #1 SMP\n";
+  std::snprintf(path, sizeof(path), "%s/version", proc_.c_str());
+  WriteFile(path, version, sizeof(version) - 1, true);
+
+  std::snprintf(path, sizeof(path), "%s/sys", proc_.c_str());
+  MakeDirectory(path);
+  std::snprintf(path, sizeof(path), "%s/sys/kernel", proc_.c_str());
+  MakeDirectory(path);
+  length = std::snprintf(buffer_, sizeof(buffer_), "%d\n", kMaxPid);
+  std::snprintf(path, sizeof(path), "%s/sys/kernel/pid_max", proc_.c_str());
+  WriteFile(path, buffer_, length, true);
+
+  const char osRelease[] =
+      "PRETTY_NAME=\"procgen synthetic host\"\nNAME=\"procgen\"\nID=procgen\n";
+  std::snprintf(path, sizeof(path), "%s/etc/os-release",
+                settings_.directory.c_str());
+  WriteFile(path, osRelease, sizeof(osRelease) - 1, true);
+
+  string passwd{"root:x:0:0:root:/root:/bin/bash\n"};
+  for (size_t i = 0; i < settings_.users; ++i) {
+    length = std::snprintf(buffer_, sizeof(buffer_),
+                           "user%zu:x:%zu:%zu::/home/user%zu:/bin/sh\n", i,
+                           1000 + i, 1000 + i, i);
+    passwd.append(buffer_, length);
+  }
+  std::snprintf(path, sizeof(path), "%s/etc/passwd",
+                settings_.directory.c_str());
+  WriteFile(path, passwd.data(), passwd.size(), true);
+}
+
+// The cgroup at 'path' (created, with its ancestors, if it's new)
+size_t ProcGenerator::FindCgroup(const string& path) {
+  auto found = cgroupIndex_.find(path);
+  if (found != cgroupIndex_.end()) {
+    return found->second;
+  }
+
+  size_t parent{0};
+  if (path != "/") {
+    size_t slash = path.rfind('/');
+    parent = FindCgroup((slash == 0) ? "/" : path.substr(0, slash));
+    MakeDirectory((cgroupRoot_ + path).c_str());
+  }
+  FakeCgroup cgroup;
+  cgroup.path = path;
+  cgroup.parent = parent;
+  cgroups_.push_back(cgroup);
+  cgroupIndex_.emplace(path, cgroups_.size() - 1);
+  return cgroups_.size() - 1;
+}
+
+// Charge the CPU time to the cgroup and its ancestors: it stays there
+// after the process exits
+void ProcGenerator::ChargeCpu(size_t cgroup, unsigned long long jiffies) {
+  unsigned long long usec = jiffies * 1000000 / clockTicks_;
+  while (true) {
+    cgroups_[cgroup].usageUsec += usec;
+    if (cgroup == 0) {
+      return;
+    }
+    cgroup = cgroups_[cgroup].parent;
+  }
+}
+
+// Each cgroup's processes, memory (of its processes and descendants') and
+// I/O (a few reads and writes per process and tick)
+void ProcGenerator::WriteCgroups() {
+  for (FakeCgroup& cgroup : cgroups_) {
+    cgroup.pids.clear();
+    cgroup.memory = 0;
+  }
+  for (const FakeProcess& process : processes_) {
+    cgroups_[process.cgroup].pids.push_back(process.pid);
+    unsigned long long ios = random_() % 4;
+    for (size_t cgroup = process.cgroup;; cgroup = cgroups_[cgroup].parent) {
+      FakeCgroup& charged = cgroups_[cgroup];
+      charged.memory += process.rss * kPageSize;
+      charged.rbytes += ios * 16384;
+      charged.wbytes += ios * 4096;
+      charged.ios += ios;
+      if (cgroup == 0) {
+        break;
+      }
+    }
+  }
+
+  char path[4096];
+  int length;
+  for (FakeCgroup& cgroup : cgroups_) {
+    bool create = !cgroup.written;
+    cgroup.written = true;
+    string directory = cgroupRoot_ + ((cgroup.path == "/") ? "" : cgroup.path);
+
+    string procs;
+    for (int pid : cgroup.pids) {
+      procs += std::to_string(pid);
+      procs += '\n';
+    }
+    std::snprintf(path, sizeof(path), "%s/cgroup.procs", directory.c_str());
+    WriteFile(path, procs.data(), procs.size(), create);
+
+    // A tenth of the periods throttled
+    unsigned long long periods = upTime_ * 10;
+    length = std::snprintf(
+        buffer_, sizeof(buffer_),
+        "usage_usec %llu\nuser_usec %llu\nsystem_usec %llu\n"
+        "nr_periods %llu\nnr_throttled %llu\nthrottled_usec %llu\n",
+        cgroup.usageUsec, cgroup.usageUsec / 5 * 4, cgroup.usageUsec / 5,
+        periods, periods / 10, cgroup.usageUsec / 50);
+    std::snprintf(path, sizeof(path), "%s/cpu.stat", directory.c_str());
+    WriteFile(path, buffer_, length, create);
+
+    length = std::snprintf(buffer_, sizeof(buffer_), "%llu\n", cgroup.memory);
+    std::snprintf(path, sizeof(path), "%s/memory.current", directory.c_str());
+    WriteFile(path, buffer_, length, create);
+
+    length = std::snprintf(
+        buffer_, sizeof(buffer_),
+        "anon %llu\nfile %llu\nkernel %llu\nshmem %llu\nsock 0\n",
+        cgroup.memory / 10 * 7, cgroup.memory / 4, cgroup.memory / 20,
+        cgroup.memory / 100);
+    std::snprintf(path, sizeof(path), "%s/memory.stat", directory.c_str());
+    WriteFile(path, buffer_, length, create);
+
+    length = std::snprintf(
+        buffer_, sizeof(buffer_),
+        "8:0 rbytes=%llu wbytes=%llu rios=%llu wios=%llu dbytes=0 dios=0\n",
+        cgroup.rbytes, cgroup.wbytes, cgroup.ios, cgroup.ios);
+    std::snprintf(path, sizeof(path), "%s/io.stat", directory.c_str());
+    WriteFile(path, buffer_, length, create);
+  }
+}
+
+// The process exits: remove its directory, and its entry (moving the last
+// one in its place)
+void ProcGenerator::RemoveProcess(size_t index) {
+  char path[4096];
+  int pid = processes_[index].pid;
+  if (settings_.tasks) {
+    vector<int> tids = processes_[index].tids;
+    tids.push_back(pid);
+    for (int tid : tids) {
+      std::snprintf(path, sizeof(path), "%s/%d/task/%d/stat", proc_.c_str(),
+                    pid, tid);
+      unlink(path);
+      std::snprintf(path, sizeof(path), "%s/%d/task/%d", proc_.c_str(), pid,
+                    tid);
+      rmdir(path);
+      if (tid != pid) {
+        live_.erase(tid);
+      }
+    }
+    std::snprintf(path, sizeof(path), "%s/%d/task", proc_.c_str(), pid);
+    rmdir(path);
+  }
+  for (const char* name : {"stat", "status", "cmdline", "cgroup"}) {
+    std::snprintf(path, sizeof(path), "%s/%d/%s", proc_.c_str(), pid, name);
+    unlink(path);
+  }
+  std::snprintf(path, sizeof(path), "%s/%d", proc_.c_str(), pid);
+  rmdir(path);
+
+  live_.erase(pid);
+  processes_[index] = std::move(processes_.back());
+  processes_.pop_back();
+}
+
+// Create a file, or rewrite an existing one in place: its inode (and so any
+// descriptor the monitor holds on it) stays the same, as in a real procfs.
+// Files stay writable by their owner, so that this works without root.
+bool ProcGenerator::WriteFile(const char* path, const char* data,
+                              size_t length, bool create) {
+  int fd = open(path, O_WRONLY | O_CLOEXEC | (create ? O_CREAT | O_TRUNC : 0),
+                0644);
+  if (fd < 0) {
+    Fail(path);
+    return false;
+  }
+  bool ok = (pwrite(fd, data, length, 0) == (ssize_t)length) &&
+            (create || (ftruncate(fd, length) == 0));
+  if (!ok) {
+    Fail(path);
+  }
+  close(fd);
+  return ok;
+}
+
+// As WriteFile(), for a directory (which may already exist)
+bool ProcGenerator::MakeDirectory(const char* path) {
+  if ((mkdir(path, 0755) != 0) && (errno != EEXIST)) {
+    Fail(path);
+    return false;
+  }
+  return true;
+}
+
+// Keep the first failure, which Create() and Tick() report
+void ProcGenerator::Fail(const char* path) {
+  if (error_.empty()) {
+    error_ = string(path) + ": " + std::strerror(errno);
+  }
+}
+
+// Parse a non-negative integer argument
+bool ParseCount(const char* text, size_t& value) {
+  char* end;
+  long long parsed = std::strtoll(text, &end, 10);
+  if ((*text == '\0') || (*end != '\0') || (parsed < 0)) {
+    return false;
+  }
+  value = parsed;
+  return true;
+}
+
+void PrintUsage(const char* program) {
+  std::fprintf(
+      stderr,
+      "Usage: %s --dir DIR [options]\n"
+      "  --dir DIR           write DIR/proc, DIR/etc and DIR/sys/fs/cgroup "
+      "(e.g. under\n"
+      "                      /dev/shm)\n"
+      "  --processes N       number of processes (default: 1000)\n"
+      "  --churn F           fraction of processes replaced per tick "
+      "(default: 0.01)\n"
+      "  --cmdline MIN MAX   command line lengths (default: 16 256)\n"
+      "  --users N           number of users besides root (default: 50)\n"
+      "  --cores N           number of CPU cores (default: 8)\n"
+      "  --interval MS       time between ticks (default: 1000)\n"
+      "  --ticks N           stop after N ticks (default: run until "
+      "killed)\n"
+      "  --seed N            random seed (default: 1)\n"
+      "  --status            also rewrite /proc/<pid>/status on every tick\n"
+      "  --tasks             also write /proc/<pid>/task/<tid>/stat, for "
+      "each thread\n"
+      "  --once              write the tree and exit\n",
+      program);
+}
+
+bool ParseSettings(int argc, char* argv[], Settings& settings) {
+  for (int i = 1; i < argc; ++i) {
+    const char* arg = argv[i];
+    const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+    size_t count;
+
+    if ((std::strcmp(arg, "--dir") == 0) && (value != nullptr)) {
+      settings.directory = value;
+      ++i;
+    } else if ((std::strcmp(arg, "--processes") == 0) && value &&
+               ParseCount(value, count) && (count >= 2)) {
+      settings.processes = count;
+      ++i;
+    } else if ((std::strcmp(arg, "--churn") == 0) && value) {
+      settings.churn = std::strtod(value, nullptr);
+      if ((settings.churn < 0) || (settings.churn > 1)) {
+        return false;
+      }
+      ++i;
+    } else if ((std::strcmp(arg, "--cmdline") == 0) && (i + 2 < argc) &&
+               ParseCount(argv[i + 1], settings.cmdlineMin) &&
+               ParseCount(argv[i + 2], settings.cmdlineMax) &&
+               (settings.cmdlineMin <= settings.cmdlineMax)) {
+      i += 2;
+    } else if ((std::strcmp(arg, "--users") == 0) && value &&
+               ParseCount(value, settings.users)) {
+      ++i;
+    } else if ((std::strcmp(arg, "--cores") == 0) && value &&
+               ParseCount(value, count) && (count >= 1)) {
+      settings.cores = count;
+      ++i;
+    } else if ((std::strcmp(arg, "--interval") == 0) && value &&
+               ParseCount(value, settings.intervalMs) &&
+               (settings.intervalMs > 0)) {
+      ++i;
+    } else if ((std::strcmp(arg, "--ticks") == 0) && value &&
+               ParseCount(value, settings.ticks)) {
+      ++i;
+    } else if ((std::strcmp(arg, "--seed") == 0) && value &&
+               ParseCount(value, count)) {
+      settings.seed = count;
+      ++i;
+    } else if (std::strcmp(arg, "--status") == 0) {
+      settings.status = true;
+    } else if (std::strcmp(arg, "--tasks") == 0) {
+      settings.tasks = true;
+    } else if (std::strcmp(arg, "--once") == 0) {
+      settings.once = true;
+    } else {
+      std::fprintf(stderr, "Invalid option: %s\n", arg);
+      return false;
+    }
+  }
+  return !settings.directory.empty();
+}
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  Settings settings;
+  if (!ParseSettings(argc, argv, settings)) {
+    PrintUsage(argv[0]);
+    return 1;
+  }
+
+  ProcGenerator generator(settings);
+  if (!generator.Create()) {
+    if (!generator.Error().empty()) {
+      std::fprintf(stderr, "%s\n", generator.Error().c_str());
+    }
+    return 1;
+  }
+  std::fprintf(stderr, "%zu processes under %s (monitor --root %s)\n",
+               settings.processes, settings.directory.c_str(),
+               settings.directory.c_str());
+  if (settings.once) {
+    return 0;
+  }
+
+  using Clock = std::chrono::steady_clock;
+  const auto interval = std::chrono::milliseconds(settings.intervalMs);
+  auto next = Clock::now() + interval;
+  for (size_t tick = 1; (settings.ticks == 0) || (tick <= settings.ticks);
+       ++tick) {
+    std::this_thread::sleep_until(next);
+    if (!generator.Tick()) {
+      std::fprintf(stderr, "%s\n", generator.Error().c_str());
+      return 1;
+    }
+    next = std::max(next + interval, Clock::now());
+  }
+}